@@ -21,13 +21,15 @@
 #include "idt.h"
 #include "pic.h"
 #include "kbd.h"
+#include "pci.h"
+#include "ata.h"
+#include "virtio_blk.h"
 #include "vmem.h"
 #include "util.h"
 #include "mm/frame.h"
 #include "paging.h"
 #include "panic.h"
 #include "driver/ramdisk.h"
-#include "kmalloc.h"
 #include "kprintf.h"
 #include <string.h>
 #include <stdint.h>
@@ -68,9 +70,25 @@ struct multiboot_info {
     uint32_t vbe_interface_len;
 };
 
+/* Kernel image end, defined in the linker script */
+extern char kend;
+
 #define ZONE_LOW_TOP        0x400000
 #define MB_HIGH_MEM_START   0x100000
 
+/*
+ * Boot module (initrd) physical memory range.
+ * The module is used in place, thus its pages are never given to the
+ * frame allocator.
+ */
+static char *mod_start;
+static char *mod_end;
+
+static int mod_page(const char *addr)
+{
+    return (addr + PAGE_SIZE > mod_start && addr < mod_end);
+}
+
 /*
  * Moltiboot low mem zone (The first 1MB).
  * Instead of try to find out what parts of the low memory are
@@ -92,13 +110,13 @@ static void mm_init(const struct multiboot_info *mbi)
     if (ret < 0)
         panic("error adding low mem zone");
 
-    /* Hack to get the kernel brk */
-    addr = (char *)ALIGN_UP((uintptr_t)kmalloc(0,0), PAGE_SIZE);
-    addr = (char *)virt_to_phys(addr);
+    /* The early heap is within the kernel image */
+    addr = (char *)virt_to_phys(&kend);
     end = (char *)MB_HIGH_MEM_START + msize;
-    /* Free unused space (after the kernel brk) */
+    /* Free unused space (after the kernel image) */
     while (addr < end) {
-        frame_free(addr, 0);
+        if (!mod_page(addr))
+            frame_free(addr, 0);
         addr += PAGE_SIZE;
     }
 }
@@ -128,7 +146,8 @@ static void mm_high_init(const struct multiboot_info *mbi)
             addr = (char *)ZONE_LOW_TOP;
             end = (char *)ZONE_LOW_TOP + RESV;
             while (addr < end) {
-                frame_free(addr, 0);
+                if (!mod_page(addr))
+                    frame_free(addr, 0);
                 addr += PAGE_SIZE;
             }
             end = (char *)ZONE_LOW_TOP + msize;
@@ -140,27 +159,58 @@ static void mm_high_init(const struct multiboot_info *mbi)
         panic("Error adding high mem zone");
 
     while (addr < end) {
-        frame_free(addr, 0);
+        if (!mod_page(addr))
+            frame_free(addr, 0);
         addr += PAGE_SIZE;
     }
 }
 
+/*
+ * Reserve the boot module memory, must be called before any use of the
+ * memory allocator.
+ * The module pages are excluded from the frame zones, the part above
+ * the low memory zone is mapped later by mod_map. The module is moved
+ * only if it overlaps the kernel image (and thus the early heap), just
+ * past it and within the boot mapping of the low memory zone.
+ */
 static void mod_load(const struct multiboot_info *mbi)
 {
-    char *addr, *start, *end;
     char **mods_addr = (char **)mbi->mods_addr;
+    char *addr;
     size_t size;
 
-    start = mods_addr[0];
-    end   = mods_addr[1];
-    if (end < start)
+    mod_start = mods_addr[0];
+    mod_end   = mods_addr[1];
+    if (mod_end < mod_start)
         panic("malformed data within multiboot info");
-    size = end - start;
-    addr = (char *)kmalloc(size, 0);
-    if (addr == NULL)
-        panic("no space for initrd");
-    memmove(addr, phys_to_virt(start), size); /* Takes care of overlaps */
-    ramdisk_init(addr, size); /* Initialize ramdisk device */
+    size = mod_end - mod_start;
+
+    addr = (char *)virt_to_phys(&kend);
+    if (mod_start < addr) {
+        if (size > (char *)ZONE_LOW_TOP - addr)
+            panic("no space to relocate initrd");
+        memmove(phys_to_virt(addr), phys_to_virt(mod_start), size);
+        mod_start = addr;
+        mod_end = mod_start + size;
+    }
+}
+
+/*
+ * Map the module part above the low memory zone, which is not mapped by
+ * default, just after the low memory (same physical to virtual offset).
+ */
+static void mod_map(void)
+{
+    char *addr;
+
+    addr = (char *)ALIGN_DOWN((uintptr_t)MAX(mod_start,
+                              (char *)ZONE_LOW_TOP), PAGE_SIZE);
+    while (addr < mod_end) {
+        if ((int)page_map(phys_to_virt(addr), (uint32_t)addr) < 0)
+            panic("no space to map initrd");
+        addr += PAGE_SIZE;
+    }
+    ramdisk_init(phys_to_virt(mod_start), mod_end - mod_start);
 }
 
 const struct multiboot_info *g_mbi;
@@ -196,6 +246,10 @@ void arch_init(const struct multiboot_info *mbi)
     /* Finish with paging initialization */
     paging_init();
 
+    /* Make the initrd accessible */
+    if (mod_end != NULL)
+        mod_map();
+
 
 }
 
@@ -205,4 +259,9 @@ void arch_final(void)
 
     /* Initialize keyboard */
     kbd_init();
+
+    /* Enumerate PCI devices and probe the disks */
+    pci_init();
+    ata_init();
+    virtio_blk_init();
 }
@@ -0,0 +1,467 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * ATA disks attached to the legacy IDE channels.
+ * Transfers are completed by the channel interrupt. Bus master DMA is
+ * used if the IDE controller is found on the PCI bus, PIO otherwise.
+ * Just LBA28 addressing is supported (disks up to 128 GiB).
+ */
+
+#include "ata.h"
+#include "pci.h"
+#include "io.h"
+#include "vmem.h"
+#include "paging_bits.h"
+#include "isr.h"
+#include "dev.h"
+#include "driver/blkdev.h"
+#include "mm/frame.h"
+#include "kprintf.h"
+#include "util.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* Task file registers (offset from the channel base port) */
+#define ATA_REG_DATA        0
+#define ATA_REG_ERROR       1
+#define ATA_REG_NSECT       2
+#define ATA_REG_LBA0        3
+#define ATA_REG_LBA1        4
+#define ATA_REG_LBA2        5
+#define ATA_REG_DRIVE       6
+#define ATA_REG_STATUS      7
+#define ATA_REG_CMD         7
+
+/* Status register bits */
+#define ATA_SR_BSY          0x80
+#define ATA_SR_DRDY         0x40
+#define ATA_SR_DF           0x20
+#define ATA_SR_DRQ          0x08
+#define ATA_SR_ERR          0x01
+
+/* Device control register bits */
+#define ATA_CTL_NIEN        0x02
+
+/* Drive register: LBA addressing */
+#define ATA_DRIVE_LBA       0xE0
+
+/* Commands */
+#define ATA_CMD_READ_PIO    0x20
+#define ATA_CMD_WRITE_PIO   0x30
+#define ATA_CMD_READ_DMA    0xC8
+#define ATA_CMD_WRITE_DMA   0xCA
+#define ATA_CMD_IDENTIFY    0xEC
+
+/* Bus master registers (offset from the channel bus master base port) */
+#define BM_REG_CMD          0
+#define BM_REG_STATUS       2
+#define BM_REG_PRDT         4
+
+#define BM_CMD_START        0x01
+#define BM_CMD_READ         0x08    /* Device to memory */
+#define BM_SR_ERR           0x02
+#define BM_SR_IRQ           0x04
+
+/* PCI mass storage class, IDE subclass */
+#define PCI_CLASS_STORAGE   0x01
+#define PCI_SUBCLASS_IDE    0x01
+/* Programming interface: bus master capable */
+#define PCI_IDE_BM          0x80
+
+/* Physical region descriptor */
+struct ata_prd {
+    uint32_t    addr;
+    uint16_t    count;      /* 0 means 64 KiB */
+    uint16_t    flags;
+};
+
+#define PRD_EOT             0x8000
+#define PRD_MAX             (PAGE_SIZE / sizeof(struct ata_prd))
+
+/* Bus master DMA is limited to the identity mapped low memory */
+#define ATA_DMA_TOP         (KVBASE + 0x400000)
+
+#define ATA_SECT_MAX        256     /* Sectors per command */
+#define ATA_LBA28_MAX       (1U << 28)
+#define ATA_POLL_MAX        100000
+
+struct ata_disk {
+    int         present;
+    uint32_t    sectors;
+    char        model[41];
+};
+
+struct ata_channel {
+    uint16_t            base;       /* Task file base port */
+    uint16_t            ctl;        /* Device control port */
+    unsigned int        irq;
+    uint16_t            bmide;      /* Bus master base port (0 if none) */
+    struct ata_prd      *prdt;      /* Physical region descriptors table */
+    struct ata_disk     disks[2];   /* Master and slave */
+    struct blk_request  *req;       /* Request in service */
+    int                 dma;        /* The request is served via DMA */
+    struct bio          *bio;       /* PIO: current bio */
+    size_t              bio_off;    /* PIO: offset within the current bio */
+    unsigned int        left;       /* PIO: sectors left */
+};
+
+static struct ata_channel ata_chans[2] = {
+    { .base = 0x1F0, .ctl = 0x3F6, .irq = 14 },
+    { .base = 0x170, .ctl = 0x376, .irq = 15 },
+};
+
+static const unsigned int ata_majors[2] = {
+    major(DEV_HDA), major(DEV_HDC)
+};
+
+static uint16_t ata_id[256];
+
+
+static struct ata_channel *ata_lookup(dev_t dev, int *slave)
+{
+    struct ata_channel *chan;
+
+    if (major(dev) == ata_majors[0])
+        chan = &ata_chans[0];
+    else if (major(dev) == ata_majors[1])
+        chan = &ata_chans[1];
+    else
+        return NULL;
+    if (minor(dev) != minor(DEV_HDA) && minor(dev) != minor(DEV_HDB))
+        return NULL;
+    *slave = (minor(dev) == minor(DEV_HDB));
+    if (chan->disks[*slave].present == 0)
+        return NULL;
+    return chan;
+}
+
+/* Wait 400ns reading the alternate status register */
+static void ata_delay(const struct ata_channel *chan)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        inb(chan->ctl);
+}
+
+/*
+ * Polls the status register until the drive is not busy and any of
+ * the 'mask' bits is set (if not zero).
+ * Returns the status or -1 on timeout.
+ */
+static int ata_poll(const struct ata_channel *chan, uint8_t mask)
+{
+    int i;
+    uint8_t st;
+
+    for (i = 0; i < ATA_POLL_MAX; i++) {
+        st = inb(chan->ctl);
+        if ((st & ATA_SR_BSY) == 0 &&
+            (mask == 0 || (st & (mask | ATA_SR_ERR)) != 0))
+            return st;
+    }
+    return -1;
+}
+
+static void ata_select(const struct ata_channel *chan, int slave,
+                       uint32_t lba)
+{
+    outb(chan->base + ATA_REG_DRIVE,
+         ATA_DRIVE_LBA | (slave << 4) | ((lba >> 24) & 0x0F));
+    ata_delay(chan);
+}
+
+static void ata_command(const struct ata_channel *chan, int slave,
+                        uint32_t lba, unsigned int nsect, uint8_t cmd)
+{
+    ata_select(chan, slave, lba);
+    outb(chan->base + ATA_REG_NSECT, nsect & 0xFF);    /* 0 is 256 */
+    outb(chan->base + ATA_REG_LBA0, lba & 0xFF);
+    outb(chan->base + ATA_REG_LBA1, (lba >> 8) & 0xFF);
+    outb(chan->base + ATA_REG_LBA2, (lba >> 16) & 0xFF);
+    outb(chan->base + ATA_REG_CMD, cmd);
+}
+
+
+static void ata_end(struct ata_channel *chan, int error)
+{
+    struct blk_request *req = chan->req;
+
+    /* The completion may dispatch the next request */
+    chan->req = NULL;
+    blk_end_request(req, error);
+}
+
+/* Transfer one sector of the current PIO request */
+static void ata_pio_sector(struct ata_channel *chan)
+{
+    char *ptr = (char *)chan->bio->data + chan->bio_off;
+
+    if (chan->req->write != 0)
+        outsw(chan->base + ATA_REG_DATA, ptr, BLK_SECTOR_SIZE / 2);
+    else
+        insw(chan->base + ATA_REG_DATA, ptr, BLK_SECTOR_SIZE / 2);
+    chan->left--;
+    chan->bio_off += BLK_SECTOR_SIZE;
+    if (chan->bio_off == chan->bio->size) {
+        chan->bio = chan->bio->next;
+        chan->bio_off = 0;
+    }
+}
+
+/*
+ * Fill the physical region descriptors table.
+ * Returns -1 if the request data is not suitable for DMA.
+ */
+static int ata_dma_setup(struct ata_channel *chan, struct blk_request *req)
+{
+    const struct bio *bio;
+    uint32_t phys, len, n;
+    unsigned int i = 0;
+
+    for (bio = req->head; bio != NULL; bio = bio->next) {
+        if ((uintptr_t)bio->data < KVBASE ||
+            (uintptr_t)bio->data + bio->size > ATA_DMA_TOP ||
+            ((uintptr_t)bio->data & 1) != 0)
+            return -1;
+        phys = (uint32_t)virt_to_phys(bio->data);
+        len = bio->size;
+        while (len > 0) {
+            if (i == PRD_MAX)
+                return -1;
+            /* A region can't cross a 64 KiB boundary */
+            n = MIN(len, 0x10000 - (phys & 0xFFFF));
+            chan->prdt[i].addr = phys;
+            chan->prdt[i].count = n & 0xFFFF;
+            chan->prdt[i].flags = 0;
+            phys += n;
+            len -= n;
+            i++;
+        }
+    }
+    chan->prdt[i - 1].flags = PRD_EOT;
+    return 0;
+}
+
+static void ata_request(struct blk_request *req)
+{
+    struct ata_channel *chan;
+    unsigned int nsect = req->size / BLK_SECTOR_SIZE;
+    uint8_t dir;
+    int slave;
+
+    chan = ata_lookup(req->dev, &slave);
+    if (chan == NULL || nsect == 0 || nsect > ATA_SECT_MAX ||
+        req->sector + nsect > chan->disks[slave].sectors) {
+        blk_end_request(req, 1);
+        return;
+    }
+    chan->req = req;
+    chan->dma = (chan->bmide != 0 && ata_dma_setup(chan, req) == 0);
+
+    if (chan->dma != 0) {
+        dir = (req->write != 0) ? 0 : BM_CMD_READ;
+        outb(chan->bmide + BM_REG_CMD, 0);
+        outl(chan->bmide + BM_REG_PRDT, (uint32_t)virt_to_phys(chan->prdt));
+        /* Status error and interrupt bits are cleared writing one */
+        outb(chan->bmide + BM_REG_STATUS, inb(chan->bmide + BM_REG_STATUS) |
+             BM_SR_ERR | BM_SR_IRQ);
+        outb(chan->bmide + BM_REG_CMD, dir);
+        ata_command(chan, slave, req->sector, nsect, (req->write != 0) ?
+                    ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+        outb(chan->bmide + BM_REG_CMD, dir | BM_CMD_START);
+        return;
+    }
+
+    chan->bio = req->head;
+    chan->bio_off = 0;
+    chan->left = nsect;
+    ata_command(chan, slave, req->sector, nsect, (req->write != 0) ?
+                ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO);
+    if (req->write != 0) {
+        /* First sector sent when requested, then one per interrupt */
+        if (ata_poll(chan, ATA_SR_DRQ) < 0 ||
+            (inb(chan->ctl) & (ATA_SR_ERR | ATA_SR_DF)) != 0) {
+            ata_end(chan, 1);
+            return;
+        }
+        ata_pio_sector(chan);
+    }
+}
+
+static void ata_irq(struct ata_channel *chan)
+{
+    uint8_t st, bst;
+
+    /* Reading the status acknowledges the interrupt */
+    if (chan->req == NULL) {
+        inb(chan->base + ATA_REG_STATUS);
+        return;
+    }
+
+    if (chan->dma != 0) {
+        bst = inb(chan->bmide + BM_REG_STATUS);
+        outb(chan->bmide + BM_REG_CMD, 0);
+        st = inb(chan->base + ATA_REG_STATUS);
+        outb(chan->bmide + BM_REG_STATUS, bst | BM_SR_ERR | BM_SR_IRQ);
+        ata_end(chan, (st & (ATA_SR_ERR | ATA_SR_DF)) != 0 ||
+                      (bst & BM_SR_ERR) != 0);
+        return;
+    }
+
+    st = inb(chan->base + ATA_REG_STATUS);
+    if ((st & (ATA_SR_ERR | ATA_SR_DF)) != 0) {
+        ata_end(chan, 1);
+    } else if (chan->req->write != 0) {
+        /* Interrupt after each written sector */
+        if (chan->left == 0)
+            ata_end(chan, 0);
+        else
+            ata_pio_sector(chan);
+    } else if ((st & ATA_SR_DRQ) != 0) {
+        /* Interrupt when each sector is ready */
+        ata_pio_sector(chan);
+        if (chan->left == 0)
+            ata_end(chan, 0);
+    }
+}
+
+static void ata_irq_primary(void)
+{
+    ata_irq(&ata_chans[0]);
+}
+
+static void ata_irq_secondary(void)
+{
+    ata_irq(&ata_chans[1]);
+}
+
+static uint32_t ata_sectors(dev_t dev)
+{
+    struct ata_channel *chan;
+    int slave;
+
+    chan = ata_lookup(dev, &slave);
+    return (chan != NULL) ? chan->disks[slave].sectors : 0;
+}
+
+static const struct blk_ops ata_ops = {
+    .request = ata_request,
+    .sectors = ata_sectors,
+};
+
+
+/*
+ * Polled identification, the channel interrupt is disabled.
+ */
+static void ata_identify(struct ata_channel *chan, int slave)
+{
+    struct ata_disk *disk = &chan->disks[slave];
+    int st, i;
+
+    ata_select(chan, slave, 0);
+    outb(chan->base + ATA_REG_NSECT, 0);
+    outb(chan->base + ATA_REG_LBA0, 0);
+    outb(chan->base + ATA_REG_LBA1, 0);
+    outb(chan->base + ATA_REG_LBA2, 0);
+    outb(chan->base + ATA_REG_CMD, ATA_CMD_IDENTIFY);
+    ata_delay(chan);
+    if (inb(chan->base + ATA_REG_STATUS) == 0)
+        return; /* No drive */
+    if (ata_poll(chan, 0) < 0)
+        return;
+    /* Packet (ATAPI) and SATA devices abort with a signature */
+    if (inb(chan->base + ATA_REG_LBA1) != 0 ||
+        inb(chan->base + ATA_REG_LBA2) != 0)
+        return;
+    st = ata_poll(chan, ATA_SR_DRQ);
+    if (st < 0 || (st & ATA_SR_ERR) != 0)
+        return;
+    insw(chan->base + ATA_REG_DATA, ata_id, 256);
+
+    /* LBA28 addressable sectors */
+    disk->sectors = ata_id[60] | ((uint32_t)ata_id[61] << 16);
+    if (disk->sectors == 0)
+        return; /* LBA not supported */
+    disk->sectors = MIN(disk->sectors, ATA_LBA28_MAX - 1);
+
+    /* Model string, words are big endian and padded with spaces */
+    for (i = 0; i < 20; i++) {
+        disk->model[2 * i] = ata_id[27 + i] >> 8;
+        disk->model[2 * i + 1] = ata_id[27 + i] & 0xFF;
+    }
+    for (i = 40; i > 0 && disk->model[i - 1] == ' '; i--)
+        ;
+    disk->model[i] = '\0';
+    disk->present = 1;
+}
+
+void ata_init(void)
+{
+    static const isr_handler_t handlers[2] = {
+        ata_irq_primary, ata_irq_secondary
+    };
+    const struct pci_dev *pdev;
+    struct ata_channel *chan;
+    uint16_t bmide = 0;
+    void *prdt;
+    unsigned int i;
+    int slave;
+
+    pdev = pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE, NULL);
+    if (pdev != NULL && (pdev->prog_if & PCI_IDE_BM) != 0 &&
+        (pdev->bar[4] & PCI_BAR_IO) != 0) {
+        pci_enable(pdev);
+        bmide = pdev->bar[4] & ~0x03;
+    }
+
+    for (i = 0; i < 2; i++) {
+        chan = &ata_chans[i];
+        outb(chan->ctl, ATA_CTL_NIEN);
+        /* Floating bus, no channel */
+        if (inb(chan->base + ATA_REG_STATUS) == 0xFF)
+            continue;
+        for (slave = 0; slave < 2; slave++)
+            ata_identify(chan, slave);
+        if (chan->disks[0].present == 0 && chan->disks[1].present == 0)
+            continue;
+
+        if (bmide != 0) {
+            prdt = frame_alloc(0, ZONE_LOW);
+            if (prdt != NULL) {
+                chan->prdt = (struct ata_prd *)phys_to_virt(prdt);
+                chan->bmide = bmide + 8 * i;
+            }
+        }
+        isr_register_handler(ISR_IRQ0 + chan->irq, handlers[i]);
+        outb(chan->ctl, 0);
+        if (blk_register(ata_majors[i], &ata_ops) < 0)
+            continue;
+
+        for (slave = 0; slave < 2; slave++) {
+            if (chan->disks[slave].present == 0)
+                continue;
+            kprintf("hd%c: %s, %u MiB, %s\n", 'a' + 2 * i + slave,
+                    chan->disks[slave].model,
+                    chan->disks[slave].sectors / 2048,
+                    (chan->bmide != 0) ? "dma" : "pio");
+        }
+    }
+}
@@ -19,6 +19,7 @@
 
 #include "proc.h"
 #include "misc.h"
+#include "timer.h"
 
 /*
  * Kernel idle procedure.
@@ -30,6 +31,7 @@ void idle(void)
     do {
         current->state = TASK_SLEEPING;
         scheduler();
+        timer_idle_enter(); /* Stop the periodic tick if possible */
         sti(); /* Enable interrupts */
         hlt(); /* ...before halt the processor */
         cli(); /* Disable interrupts in kernel code */
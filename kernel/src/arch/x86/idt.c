@@ -73,6 +73,8 @@ void isr_44(void);
 void isr_45(void);
 void isr_46(void);
 void isr_47(void);
+void isr_48(void);
+void isr_63(void);
 void isr_128(void);
 
 static struct idt_entry     idt_entries[256];
@@ -169,6 +171,10 @@ void idt_init(void)
     idt_entry_init(46, (uint32_t) isr_46, 0x08, 0x8E);
     idt_entry_init(47, (uint32_t) isr_47, 0x08, 0x8E);
 
+    /* Local APIC timer and spurious interrupts */
+    idt_entry_init(48, (uint32_t) isr_48, 0x08, 0x8E);
+    idt_entry_init(63, (uint32_t) isr_63, 0x08, 0x8E);
+
     /* Software interrupt (used by syscalls) */
     idt_entry_init(128, (uint32_t) isr_128, 0x08, 0xEE);
 
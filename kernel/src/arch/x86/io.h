@@ -127,4 +127,32 @@ static inline uint32_t inl(uint16_t port)
     return val;
 }
 
+/*
+ * Read a sequence of 16-bits words from an input port
+ *
+ * @param port  Port address
+ * @param buf   Destination buffer
+ * @param count Number of words
+ */
+static inline void insw(uint16_t port, void *buf, uint32_t count)
+{
+    asm volatile("cld\n\t"
+                 "rep insw"
+                 : "+D"(buf), "+c"(count) : "d"(port) : "memory");
+}
+
+/*
+ * Write a sequence of 16-bits words to an output port
+ *
+ * @param port  Port address
+ * @param buf   Source buffer
+ * @param count Number of words
+ */
+static inline void outsw(uint16_t port, const void *buf, uint32_t count)
+{
+    asm volatile("cld\n\t"
+                 "rep outsw"
+                 : "+S"(buf), "+c"(count) : "d"(port) : "memory");
+}
+
 #endif /* BEEOS_ARCH_X86_IO_H_ */
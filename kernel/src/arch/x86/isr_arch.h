@@ -57,6 +57,8 @@ struct isr_frame {
 #define ISR_KEYBOARD    33
 #define ISR_COM2        35
 #define ISR_COM1        36
+#define ISR_LAPIC_TIMER 48
+#define ISR_SPURIOUS    63
 #define ISR_SYSCALL     128
 
 #endif /* BEEOS_ARCH_X86_ISR_ARCH_H_ */
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "lapic.h"
+#include "paging.h"
+#include "isr.h"
+#include "tsc.h"
+
+/* Fixed virtual address of the registers, below the paging reserved area */
+#define LAPIC_VADDR         0xFF000000
+
+/* Registers offsets */
+#define LAPIC_TPR           0x080   /* Task priority */
+#define LAPIC_EOI           0x0B0   /* End of interrupt */
+#define LAPIC_SVR           0x0F0   /* Spurious interrupt vector */
+#define LAPIC_LVT_TIMER     0x320   /* Local vector table, timer */
+#define LAPIC_LVT_LINT0     0x350   /* Local vector table, LINT0 pin */
+#define LAPIC_LVT_LINT1     0x360   /* Local vector table, LINT1 pin */
+#define LAPIC_TIMER_INIT    0x380   /* Timer initial count */
+#define LAPIC_TIMER_CURR    0x390   /* Timer current count */
+#define LAPIC_TIMER_DIV     0x3E0   /* Timer divide configuration */
+
+#define LAPIC_SVR_ENABLE    0x100   /* Software enable */
+#define LAPIC_LVT_EXTINT    0x700   /* ExtINT delivery mode */
+#define LAPIC_LVT_NMI       0x400   /* NMI delivery mode */
+#define LAPIC_LVT_MASKED    0x10000 /* Interrupt masked */
+#define LAPIC_TIMER_DIV1    0x0B    /* Divide by 1 */
+
+#define MSR_APIC_BASE       0x1B
+#define MSR_APIC_ENABLE     0x800   /* Global enable */
+#define CPUID_EDX_APIC      0x200   /* Local APIC present */
+
+/* Timer calibration period */
+#define LAPIC_CALIBRATE_MS  10
+
+static volatile uint32_t *regs;
+static uint32_t timer_khz;
+
+
+static inline uint32_t lapic_read(unsigned int reg)
+{
+    return regs[reg / 4];
+}
+
+static inline void lapic_write(unsigned int reg, uint32_t val)
+{
+    regs[reg / 4] = val;
+}
+
+static int lapic_present(void)
+{
+    uint32_t a = 1, b, c, d;
+
+    asm volatile("cpuid" : "+a"(a), "=b"(b), "=c"(c), "=d"(d));
+    return (d & CPUID_EDX_APIC) != 0;
+}
+
+static uint32_t lapic_base(void)
+{
+    uint32_t lo, hi;
+
+    asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(MSR_APIC_BASE));
+    if ((lo & MSR_APIC_ENABLE) == 0) {
+        lo |= MSR_APIC_ENABLE;
+        asm volatile("wrmsr" : : "a"(lo), "d"(hi), "c"(MSR_APIC_BASE));
+    }
+    return lo & PTE_MASK;
+}
+
+/*
+ * Count the timer decrements over a TSC measured period.
+ */
+static void lapic_timer_calibrate(void)
+{
+    uint64_t start, cycles;
+    uint32_t elapsed;
+
+    cycles = (uint64_t)tsc_khz() * LAPIC_CALIBRATE_MS;
+    if (cycles == 0)
+        return;
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV1);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | ISR_LAPIC_TIMER);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    start = tsc_read();
+    while (tsc_read() - start < cycles)
+        ;
+    elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    timer_khz = elapsed / LAPIC_CALIBRATE_MS;
+
+    /* One-shot mode */
+    lapic_write(LAPIC_LVT_TIMER, ISR_LAPIC_TIMER);
+}
+
+/* Spurious interrupts are not acknowledged */
+static void lapic_spurious(void)
+{
+}
+
+int lapic_init(void)
+{
+    if (!lapic_present())
+        return -1;
+    if ((int)page_map_io((void *)LAPIC_VADDR, lapic_base()) < 0)
+        return -1;
+    regs = (volatile uint32_t *)LAPIC_VADDR;
+
+    /* Keep the PIC as the external interrupts source */
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_EXTINT);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | ISR_SPURIOUS);
+    isr_register_handler(ISR_SPURIOUS, lapic_spurious);
+
+    lapic_timer_calibrate();
+    return (timer_khz != 0) ? 0 : -1;
+}
+
+void lapic_eoi(void)
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+uint32_t lapic_timer_khz(void)
+{
+    return timer_khz;
+}
+
+void lapic_timer_oneshot(uint32_t count)
+{
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_ARCH_X86_LAPIC_H_
+#define BEEOS_ARCH_X86_LAPIC_H_
+
+#include <stdint.h>
+
+/**
+ * Detect, map and enable the local APIC and calibrate its timer against
+ * the time stamp counter. The legacy PIC keeps delivering the external
+ * interrupts (virtual wire mode).
+ *
+ * @return  Zero on success, negative if the local APIC is not available.
+ */
+int lapic_init(void);
+
+/**
+ * Signal the end of interrupt to the local APIC.
+ */
+void lapic_eoi(void);
+
+/**
+ * Local APIC timer frequency.
+ *
+ * @return  Frequency in kHz, zero if not available.
+ */
+uint32_t lapic_timer_khz(void);
+
+/**
+ * Program the local APIC timer to fire once.
+ * The timer raises the ISR_LAPIC_TIMER interrupt.
+ *
+ * @param count     Timer counts, zero stops the timer.
+ */
+void lapic_timer_oneshot(uint32_t count);
+
+#endif /* BEEOS_ARCH_X86_LAPIC_H_ */
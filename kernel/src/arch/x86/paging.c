@@ -30,6 +30,7 @@
 #include "panic.h"
 #include "proc.h"
 #include "sys.h"
+#include "util.h"
 #include <string.h>
 #include <errno.h>
 
@@ -49,11 +50,13 @@
  * We also reserve a "wild" page starting below the second-to-last 4MB to
  * temporary map arbitrary physical addresses to a well known virtual address.
  * This wild page is used to copy pages between two different processes.
+ * The page below gives the kernel access to frames out of the low memory.
  */
 #define PAGE_TAB_MAP    0xFFC00000  /* Current page tables base vaddress */
 #define PAGE_DIR_MAP    0xFFFFF000  /* Current page directory vaddress */
 #define PAGE_TAB_MAP2   0xFF800000  /* Temporary page tables base vaddress */
 #define PAGE_WILD       (PAGE_TAB_MAP2-4096) /* Temporary "wild" page */
+#define PAGE_TMP        (PAGE_WILD-4096)     /* Temporary kernel access */
 
 /* Virtual address to page directory index (virt / 4M) */
 #define DIR_INDEX(virt) ((uint32_t)(virt) >> 22)
@@ -79,8 +82,10 @@
 
 /*
  * Maps a page virtual memory address to a physical memory address.
+ * The page table entry gets the given flags, the page directory entry is
+ * always writable.
  */
-uint32_t page_map(void *virt, uint32_t phys)
+static uint32_t page_map_flags(void *virt, uint32_t phys, uint32_t flags)
 {
     unsigned int di = DIR_INDEX(virt);
     unsigned int ti = TAB_INDEX(virt);
@@ -88,7 +93,6 @@ uint32_t page_map(void *virt, uint32_t phys)
     uint32_t pag_phys = phys;
     uint32_t *dir = (uint32_t *)PAGE_DIR_MAP;
     uint32_t *tab = (uint32_t *)(PAGE_TAB_MAP + (di * 0x1000));
-    uint32_t flags = PTE_P | PTE_W;
 
     /* Check if is user space memory */
     if ((uint32_t)virt < KVBASE)
@@ -104,7 +108,7 @@ uint32_t page_map(void *virt, uint32_t phys)
         tab_phys = (uint32_t)frame_alloc(0, ZONE_LOW);
         if (tab_phys == 0)
             return (uint32_t)-ENOMEM;
-        dir[di] = tab_phys | flags;
+        dir[di] = tab_phys | PTE_P | PTE_W | (flags & PTE_U);
         /* Clean the new page table entries */
         memset(tab, 0, PAGE_SIZE);
     }
@@ -134,6 +138,34 @@ uint32_t page_map(void *virt, uint32_t phys)
     return pag_phys;
 }
 
+uint32_t page_map(void *virt, uint32_t phys)
+{
+    return page_map_flags(virt, phys, PTE_P | PTE_W);
+}
+
+uint32_t page_map_shared(void *virt, uint32_t phys)
+{
+    return page_map_flags(virt, phys, PTE_P | PTE_SHARED);
+}
+
+uint32_t page_map_io(void *virt, uint32_t phys)
+{
+    return page_map_flags(virt, phys,
+                          PTE_P | PTE_W | PTE_PCD | PTE_PWT | PTE_SHARED);
+}
+
+void *page_map_tmp(uint32_t phys)
+{
+    if ((int)page_map((void *)PAGE_TMP, phys) < 0)
+        return NULL;
+    return (void *)PAGE_TMP;
+}
+
+void page_unmap_tmp(void)
+{
+    page_unmap((void *)PAGE_TMP, 1);
+}
+
 /*
  * Unmap a virtual memory address.
  */
@@ -150,10 +182,10 @@ uint32_t page_unmap(void *virt, int retain)
     if((dir[di] & PTE_P) != 0) {
         if ((tab[ti] & PTE_P) != 0) {
             pag_phys = (tab[ti] & PTE_MASK);
+            if (retain == 0 && (tab[ti] & PTE_SHARED) == 0)
+                frame_free((void *)pag_phys, 0);
             tab[ti] = 0;
             page_invalidate(pag_phys);
-            if (retain == 0)
-                frame_free((void *)pag_phys, 0);
         }
 
         /* Check if that was the last page in the page table */
@@ -195,7 +227,7 @@ void page_dir_del(uint32_t phys)
         if ((dir[di] & PTE_P) != 0) {
             tab = (uint32_t *)(PAGE_TAB_MAP2 + (di * 4096));
             for (ti = 0; ti < 1024; ti++) {
-                if ((tab[ti] & PTE_P) != 0)
+                if ((tab[ti] & (PTE_P | PTE_SHARED)) == PTE_P)
                     frame_free((char *)(tab[ti] & PTE_MASK), 0);
             }
             frame_free((char *)(dir[di] & PTE_MASK), 0);
@@ -209,6 +241,35 @@ void page_dir_del(uint32_t phys)
 }
 
 
+/*
+ * Count the user space pages mapped by a page directory.
+ */
+unsigned int page_dir_rss(uint32_t phys)
+{
+    unsigned int di, ti, n = 0;
+    const uint32_t *tab;
+    const uint32_t *dir;
+    uint32_t *dir_curr;
+
+    dir_curr = (uint32_t *)PAGE_DIR_MAP;
+    /* Temporary map the dir in under the current dir */
+    dir_curr[1022] = phys | PTE_W | PTE_P;
+    flush_tlb();
+    dir = (uint32_t *)(PAGE_TAB_MAP + (1022 * 4096));
+    for (di = 0; di < 768; di++) {
+        if ((dir[di] & PTE_P) != 0) {
+            tab = (uint32_t *)(PAGE_TAB_MAP2 + (di * 4096));
+            for (ti = 0; ti < 1024; ti++) {
+                if ((tab[ti] & PTE_P) != 0)
+                    n++;
+            }
+        }
+    }
+    dir_curr[1022] = 0;
+    flush_tlb();
+    return n;
+}
+
 
 static void page_tab_dup(uint32_t *dir_dst, unsigned int i, uint32_t flags)
 {
@@ -226,7 +287,9 @@ static void page_tab_dup(uint32_t *dir_dst, unsigned int i, uint32_t flags)
     dir_dst[i] = phys | flags;
 
     for (j = 0; j < 1024; j++) {
-        if (tab_src[j] != 0) {
+        if ((tab_src[j] & PTE_SHARED) != 0) {
+            tab_dst[j] = tab_src[j];    /* Not owned, thus read-only */
+        } else if (tab_src[j] != 0) {
             /* TODO: copy on write (in the page fault handler) */
             /*
              * tab_src[j] &= ~PTE_W; // NON SEMBRA FUNZIONARE...
@@ -282,6 +345,27 @@ uint32_t page_dir_dup(int dup_user)
     return phys;
 }
 
+int page_user_writable(const void *buf, size_t size)
+{
+    uint32_t virt = ALIGN_DOWN((uint32_t)buf, PAGE_SIZE);
+    uint32_t end = (uint32_t)buf + size;
+    const uint32_t *dir = (uint32_t *)PAGE_DIR_MAP;
+    const uint32_t *tab;
+
+    if ((uint32_t)buf >= KVBASE)
+        return 0;   /* Kernel buffer, internal call */
+    if (end > KVBASE || end < (uint32_t)buf)
+        return -EFAULT;
+    for (; virt < end; virt += PAGE_SIZE) {
+        if ((dir[DIR_INDEX(virt)] & PTE_P) == 0)
+            continue;   /* Mapped on demand */
+        tab = (uint32_t *)(PAGE_TAB_MAP + (DIR_INDEX(virt) * 0x1000));
+        if ((tab[TAB_INDEX(virt)] & (PTE_P | PTE_W)) == PTE_P)
+            return -EFAULT;
+    }
+    return 0;
+}
+
 /*
  * Propagates a kernel virtual address mapping to all the other processes.
  * This happens for kmalloced virtual addresses that are after the initially
@@ -309,6 +393,23 @@ static void map_propagate(unsigned int idx)
     flush_tlb();
 }
 
+/*
+ * Replace a read-only user page with a writable private copy.
+ */
+static void page_make_private(uint32_t virt)
+{
+    uint32_t *tab = (uint32_t *)(PAGE_TAB_MAP + (DIR_INDEX(virt) * 0x1000));
+    void *page = (void *)ALIGN_DOWN(virt, PAGE_SIZE);
+    uint32_t phys;
+
+    if ((int)page_map((void *)PAGE_WILD, -1) < 0)
+        panic("Out of mem in page fault handler");
+    memcpy((void *)PAGE_WILD, page, PAGE_SIZE);
+    phys = page_unmap((void *)PAGE_WILD, 1);
+    tab[TAB_INDEX(virt)] = phys | PTE_P | PTE_W | PTE_U;
+    flush_tlb();
+}
+
 /* Page fault error bits */
 /* The fault is caused by a page-protection violation. */
 #define ERR_PRESENT (1 << 0)
@@ -341,6 +442,7 @@ static void page_fault_handler(void)
 
     fault_addr_get(virt);
     err = current->arch.ifr->err_no;
+    current->faults++;
 
 #ifdef DEBUG_PAGING
     kprintf("pid: %d\n", current->pid);
@@ -353,7 +455,19 @@ static void page_fault_handler(void)
     if ((err & (ERR_PRESENT | ERR_FETCH)) != 0) {
         kprintf("Protection fault or NX violation... kill process %d\n",
                 current->pid);
-        do_kill = 1;
+        if ((err & ERR_USER) == 0) {
+            if (virt >= KVBASE)
+                panic("Kernel protection fault");
+            /*
+             * Kernel write to a read-only user buffer not rejected by
+             * page_user_writable. The faulting instruction is restarted,
+             * thus let it complete on a private copy of the page.
+             */
+            page_make_private(virt);
+        }
+        /* The page is there, nothing to map */
+        sys_kill(current->pid, SIGSEGV);
+        return;
     }
     if ((err & ERR_USER) != 0) {
         /*
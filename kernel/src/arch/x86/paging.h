@@ -23,6 +23,7 @@
 #include "paging_bits.h"
 #include "vmem.h"
 #include <stdint.h>
+#include <stddef.h>
 
 /**
  * Duplicates the current process page directory.
@@ -40,6 +41,14 @@ uint32_t page_dir_dup(int dup_user);
  */
 void page_dir_del(uint32_t phys);
 
+/**
+ * Count the user space pages mapped by a page directory (resident set).
+ *
+ * @param phys  Physical address of the page directory.
+ * @return      Number of pages.
+ */
+unsigned int page_dir_rss(uint32_t phys);
+
 /**
  * Maps a page virtual memory address to a physical memory address.
  *
@@ -51,6 +60,55 @@ void page_dir_del(uint32_t phys);
  */
 uint32_t page_map(void *virt, uint32_t phys);
 
+/**
+ * Maps a page virtual memory address, read-only, to a physical frame that
+ * is not owned by the address space (e.g. file data directly accessed in
+ * memory). The frame is never released when the page is unmapped and
+ * is shared, instead of copied, when the address space is duplicated.
+ *
+ * @param virt  Page virtual memory address.
+ * @param phys  Page physical memory address.
+ * @return      Page physical memory address.
+ */
+uint32_t page_map_shared(void *virt, uint32_t phys);
+
+/**
+ * Maps a page virtual memory address to device registers (memory mapped
+ * I/O). The page is not cached and the frame is never released.
+ *
+ * @param virt  Page virtual memory address.
+ * @param phys  Device registers physical address.
+ * @return      Page physical memory address.
+ */
+uint32_t page_map_io(void *virt, uint32_t phys);
+
+/**
+ * Temporarily maps a physical frame at a reserved kernel address, e.g. to
+ * access frames that are not within the identity mapped low memory.
+ * One frame at a time, unmapped before any rescheduling.
+ *
+ * @param phys  Page physical memory address.
+ * @return      Page virtual memory address, NULL if out of memory.
+ */
+void *page_map_tmp(uint32_t phys);
+
+/**
+ * Drops the temporary mapping, the frame is retained.
+ */
+void page_unmap_tmp(void);
+
+/**
+ * Check that the kernel can write into a user buffer.
+ * Pages not mapped yet are fine, they are mapped on demand, while
+ * read-only pages (e.g. directly mapped file text or the time page) are
+ * not. Kernel addresses, used by internal calls, are not checked.
+ *
+ * @param buf   Buffer address.
+ * @param size  Buffer size.
+ * @return      Zero if writable, -EFAULT otherwise.
+ */
+int page_user_writable(const void *buf, size_t size);
+
 /**
  * Unmaps a virtual memory address.
  *
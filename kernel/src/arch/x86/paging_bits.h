@@ -51,7 +51,10 @@
 #define PTE_P           0x00000001      /* Present */
 #define PTE_W           0x00000002      /* Writeable */
 #define PTE_U           0x00000004      /* User */
+#define PTE_PWT         0x00000008      /* Page write-through */
+#define PTE_PCD         0x00000010      /* Page cache disable */
 #define PTE_PS          0x00000080      /* Page size, if set 4MB else 4KB */
+#define PTE_SHARED      0x00000200      /* Frame not owned (available bit) */
 #define PTE_MASK        0xFFFFF000      /* Page pysical address mask */
 
 #endif /* BEEOS_ARCH_X86_PAGING_BITS_H_ */
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * PCI configuration space access via the configuration mechanism #1.
+ */
+
+#include "pci.h"
+#include "io.h"
+#include "kprintf.h"
+#include <stddef.h>
+
+#define PCI_CONFIG_ADDRESS      0xCF8
+#define PCI_CONFIG_DATA         0xCFC
+
+#define PCI_BUSES               256
+#define PCI_SLOTS               32
+#define PCI_FUNCS               8
+
+static struct pci_dev pci_devs[PCI_DEVS_MAX];
+static unsigned int pci_ndevs;
+
+
+static void pci_select(uint8_t bus, uint8_t slot, uint8_t func, uint8_t off)
+{
+    outl(PCI_CONFIG_ADDRESS, 0x80000000 | ((uint32_t)bus << 16) |
+         ((uint32_t)slot << 11) | ((uint32_t)func << 8) | (off & 0xFC));
+}
+
+static uint32_t pci_conf_read(uint8_t bus, uint8_t slot, uint8_t func,
+                              uint8_t off)
+{
+    pci_select(bus, slot, func, off);
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint32_t pci_read32(const struct pci_dev *pdev, uint8_t off)
+{
+    return pci_conf_read(pdev->bus, pdev->slot, pdev->func, off);
+}
+
+uint16_t pci_read16(const struct pci_dev *pdev, uint8_t off)
+{
+    return (uint16_t)(pci_read32(pdev, off) >> ((off & 2) * 8));
+}
+
+uint8_t pci_read8(const struct pci_dev *pdev, uint8_t off)
+{
+    return (uint8_t)(pci_read32(pdev, off) >> ((off & 3) * 8));
+}
+
+void pci_write32(const struct pci_dev *pdev, uint8_t off, uint32_t val)
+{
+    pci_select(pdev->bus, pdev->slot, pdev->func, off);
+    outl(PCI_CONFIG_DATA, val);
+}
+
+void pci_write16(const struct pci_dev *pdev, uint8_t off, uint16_t val)
+{
+    pci_select(pdev->bus, pdev->slot, pdev->func, off);
+    outw(PCI_CONFIG_DATA + (off & 2), val);
+}
+
+void pci_enable(const struct pci_dev *pdev)
+{
+    pci_write16(pdev, PCI_COMMAND, pci_read16(pdev, PCI_COMMAND) |
+                PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+}
+
+const struct pci_dev *pci_find_class(uint8_t class, uint8_t subclass,
+                                     const struct pci_dev *from)
+{
+    unsigned int i;
+
+    i = (from != NULL) ? (unsigned int)(from - pci_devs) + 1 : 0;
+    for (; i < pci_ndevs; i++) {
+        if (pci_devs[i].class == class && pci_devs[i].subclass == subclass)
+            return &pci_devs[i];
+    }
+    return NULL;
+}
+
+const struct pci_dev *pci_find_device(uint16_t vendor, uint16_t device,
+                                      const struct pci_dev *from)
+{
+    unsigned int i;
+
+    i = (from != NULL) ? (unsigned int)(from - pci_devs) + 1 : 0;
+    for (; i < pci_ndevs; i++) {
+        if (pci_devs[i].vendor == vendor && pci_devs[i].device == device)
+            return &pci_devs[i];
+    }
+    return NULL;
+}
+
+void pci_dump(void)
+{
+    unsigned int i;
+    const struct pci_dev *pdev;
+
+    for (i = 0; i < pci_ndevs; i++) {
+        pdev = &pci_devs[i];
+        kprintf("pci %x:%x.%x: %x:%x class %x:%x irq %u\n",
+                pdev->bus, pdev->slot, pdev->func, pdev->vendor,
+                pdev->device, pdev->class, pdev->subclass, pdev->irq);
+    }
+}
+
+
+static void pci_probe(uint8_t bus, uint8_t slot, uint8_t func)
+{
+    struct pci_dev *pdev;
+    uint32_t id;
+    int i;
+
+    id = pci_conf_read(bus, slot, func, PCI_VENDOR_ID);
+    if ((id & 0xFFFF) == 0xFFFF || pci_ndevs == PCI_DEVS_MAX)
+        return;
+    pdev = &pci_devs[pci_ndevs++];
+    pdev->bus = bus;
+    pdev->slot = slot;
+    pdev->func = func;
+    pdev->vendor = id & 0xFFFF;
+    pdev->device = id >> 16;
+    pdev->class = pci_read8(pdev, PCI_CLASS);
+    pdev->subclass = pci_read8(pdev, PCI_SUBCLASS);
+    pdev->prog_if = pci_read8(pdev, PCI_PROG_IF);
+    pdev->irq = pci_read8(pdev, PCI_INTERRUPT_LINE);
+    for (i = 0; i < 6; i++)
+        pdev->bar[i] = pci_read32(pdev, PCI_BAR0 + 4 * i);
+}
+
+/*
+ * Brute force scan, the multi function bit is honoured to not report
+ * single function devices eight times.
+ */
+void pci_init(void)
+{
+    unsigned int bus, slot, func, nfuncs;
+    uint32_t hdr;
+
+    pci_ndevs = 0;
+    for (bus = 0; bus < PCI_BUSES; bus++) {
+        for (slot = 0; slot < PCI_SLOTS; slot++) {
+            if ((pci_conf_read(bus, slot, 0, PCI_VENDOR_ID) & 0xFFFF) ==
+                    0xFFFF)
+                continue;
+            hdr = pci_conf_read(bus, slot, 0, PCI_HEADER_TYPE);
+            nfuncs = ((hdr >> 16) & 0x80) ? PCI_FUNCS : 1;
+            for (func = 0; func < nfuncs; func++)
+                pci_probe(bus, slot, func);
+        }
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_ARCH_X86_PCI_H_
+#define BEEOS_ARCH_X86_PCI_H_
+
+#include <stdint.h>
+
+/** Configuration space registers @{ */
+#define PCI_VENDOR_ID           0x00
+#define PCI_DEVICE_ID           0x02
+#define PCI_COMMAND             0x04
+#define PCI_STATUS              0x06
+#define PCI_PROG_IF             0x09
+#define PCI_SUBCLASS            0x0A
+#define PCI_CLASS               0x0B
+#define PCI_HEADER_TYPE         0x0E
+#define PCI_BAR0                0x10
+#define PCI_INTERRUPT_LINE      0x3C
+/** @} */
+
+/** Command register bits @{ */
+#define PCI_COMMAND_IO          0x0001
+#define PCI_COMMAND_MEMORY      0x0002
+#define PCI_COMMAND_MASTER      0x0004
+/** @} */
+
+/** I/O space BAR flag */
+#define PCI_BAR_IO              0x01
+
+/** Max number of devices tracked by the enumeration */
+#define PCI_DEVS_MAX            32
+
+/** PCI function descriptor */
+struct pci_dev {
+    uint8_t     bus;        /**< Bus number */
+    uint8_t     slot;       /**< Device number */
+    uint8_t     func;       /**< Function number */
+    uint8_t     irq;        /**< Legacy interrupt line */
+    uint16_t    vendor;     /**< Vendor identifier */
+    uint16_t    device;     /**< Device identifier */
+    uint8_t     class;      /**< Class code */
+    uint8_t     subclass;   /**< Subclass code */
+    uint8_t     prog_if;    /**< Programming interface */
+    uint32_t    bar[6];     /**< Base address registers */
+};
+
+/**
+ * Read a configuration space register.
+ *
+ * @param pdev  Device.
+ * @param off   Register offset (aligned to the access size).
+ * @return      Register value.
+ */
+uint32_t pci_read32(const struct pci_dev *pdev, uint8_t off);
+
+uint16_t pci_read16(const struct pci_dev *pdev, uint8_t off);
+
+uint8_t pci_read8(const struct pci_dev *pdev, uint8_t off);
+
+/**
+ * Write a configuration space register.
+ *
+ * @param pdev  Device.
+ * @param off   Register offset (aligned to the access size).
+ * @param val   Value.
+ */
+void pci_write32(const struct pci_dev *pdev, uint8_t off, uint32_t val);
+
+void pci_write16(const struct pci_dev *pdev, uint8_t off, uint16_t val);
+
+/**
+ * Enable the device I/O and memory decoding and bus mastering.
+ *
+ * @param pdev  Device.
+ */
+void pci_enable(const struct pci_dev *pdev);
+
+/**
+ * Find a device by class.
+ *
+ * @param class     Class code.
+ * @param subclass  Subclass code.
+ * @param from      Previous match or NULL to start from the beginning.
+ * @return          Device descriptor or NULL if not found.
+ */
+const struct pci_dev *pci_find_class(uint8_t class, uint8_t subclass,
+                                     const struct pci_dev *from);
+
+/**
+ * Find a device by identifier.
+ *
+ * @param vendor    Vendor identifier.
+ * @param device    Device identifier.
+ * @param from      Previous match or NULL to start from the beginning.
+ * @return          Device descriptor or NULL if not found.
+ */
+const struct pci_dev *pci_find_device(uint16_t vendor, uint16_t device,
+                                      const struct pci_dev *from);
+
+/**
+ * PCI devices dump function.
+ */
+void pci_dump(void);
+
+/**
+ * Enumerate the devices on the PCI buses.
+ */
+void pci_init(void);
+
+#endif /* BEEOS_ARCH_X86_PCI_H_ */
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "rtc.h"
+#include "io.h"
+
+#define RTC_IO_ADDR     0x70    /* Register select port */
+#define RTC_IO_DATA     0x71    /* Data port */
+
+#define RTC_SEC         0x00
+#define RTC_MIN         0x02
+#define RTC_HOUR        0x04
+#define RTC_DAY         0x07
+#define RTC_MONTH       0x08
+#define RTC_YEAR        0x09
+#define RTC_STATUS_A    0x0A
+#define RTC_STATUS_B    0x0B
+
+#define RTC_UIP         0x80    /* Update in progress (status A) */
+#define RTC_24H         0x02    /* 24 hours format (status B) */
+#define RTC_BINARY      0x04    /* Binary instead of BCD (status B) */
+#define RTC_PM          0x80    /* PM flag in the 12 hours format */
+
+struct rtc_time {
+    uint8_t sec;
+    uint8_t min;
+    uint8_t hour;
+    uint8_t day;
+    uint8_t month;
+    uint8_t year;
+};
+
+/* Days before the start of each month, non leap year */
+static const unsigned short month_days[12] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+
+static uint8_t rtc_reg(uint8_t reg)
+{
+    outb(RTC_IO_ADDR, reg);
+    return inb(RTC_IO_DATA);
+}
+
+static void rtc_get(struct rtc_time *tm)
+{
+    while ((rtc_reg(RTC_STATUS_A) & RTC_UIP) != 0)
+        ;
+    tm->sec = rtc_reg(RTC_SEC);
+    tm->min = rtc_reg(RTC_MIN);
+    tm->hour = rtc_reg(RTC_HOUR);
+    tm->day = rtc_reg(RTC_DAY);
+    tm->month = rtc_reg(RTC_MONTH);
+    tm->year = rtc_reg(RTC_YEAR);
+}
+
+static uint8_t bcd_to_bin(uint8_t val)
+{
+    return (val & 0x0F) + (val >> 4) * 10;
+}
+
+static int leap_year(unsigned int year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+time_t rtc_read(void)
+{
+    struct rtc_time tm, prev;
+    unsigned int year, y, days;
+    uint8_t status, pm;
+
+    /* Read until two consecutive reads match, to skip an update */
+    rtc_get(&tm);
+    do {
+        prev = tm;
+        rtc_get(&tm);
+    } while (tm.sec != prev.sec || tm.min != prev.min ||
+             tm.hour != prev.hour || tm.day != prev.day ||
+             tm.month != prev.month || tm.year != prev.year);
+
+    status = rtc_reg(RTC_STATUS_B);
+    pm = tm.hour & RTC_PM;
+    tm.hour &= ~RTC_PM;
+    if ((status & RTC_BINARY) == 0) {
+        tm.sec = bcd_to_bin(tm.sec);
+        tm.min = bcd_to_bin(tm.min);
+        tm.hour = bcd_to_bin(tm.hour);
+        tm.day = bcd_to_bin(tm.day);
+        tm.month = bcd_to_bin(tm.month);
+        tm.year = bcd_to_bin(tm.year);
+    }
+    if ((status & RTC_24H) == 0) {
+        if (tm.hour == 12)
+            tm.hour = 0;
+        if (pm != 0)
+            tm.hour += 12;
+    }
+    if (tm.month < 1 || tm.month > 12)
+        return 0;
+
+    /* No century register, two digits years from 1970 to 2069 */
+    year = (tm.year < 70) ? 2000 + tm.year : 1900 + tm.year;
+    days = 0;
+    for (y = 1970; y < year; y++)
+        days += leap_year(y) ? 366 : 365;
+    days += month_days[tm.month - 1] + tm.day - 1;
+    if (tm.month > 2 && leap_year(year))
+        days++;
+
+    return (time_t)days * 86400 + tm.hour * 3600 + tm.min * 60 + tm.sec;
+}
@@ -15,4 +15,10 @@ local_sources := init.S \
 				 task.c \
 				 misc.c \
 				 timer.c \
-				 uart.c
+				 uart.c \
+				 pci.c \
+				 ata.c \
+				 virtio_blk.c \
+				 tsc.c \
+				 lapic.c \
+				 rtc.c
@@ -19,8 +19,13 @@
 
 
 #include "timer.h"
+#include "hrtimer.h"
 #include "io.h"
 #include "isr.h"
+#include "tsc.h"
+#include "lapic.h"
+#include "rtc.h"
+#include "timepage.h"
 
 /* Internal clock frequency is 1193180 Hz. */
 #define TIMER_ARCH_HZ       1193180 /* Built-in timer max frequency */
@@ -37,7 +42,19 @@
 #define TIMER_IO_CMD        0x43    /* Command port */
 
 #define TIMER_OPMODE        0x04    /* Mode 2, rate generator */
+#define TIMER_ONESHOT       0x00    /* Mode 0, interrupt on terminal count */
 #define TIMER_ACCESS        0x30    /* 16bit, LSB first */
+#define TIMER_READBACK      0xC2    /* Latch channel 0 status and count */
+#define TIMER_STATUS_OUT    0x80    /* Output pin state */
+
+/* Longest one-shot period, in ticks */
+#define TIMER_ONESHOT_MAX   (0xFFFF / TIMER_DIVISOR)
+
+/* Programmed one-shot count */
+static unsigned int oneshot_count;
+
+/* Time stamp counter at startup, monotonic clock origin */
+static uint64_t boot_tsc;
 
 
 static void timer_handler(void)
@@ -46,20 +63,90 @@ static void timer_handler(void)
     timer_update();
 }
 
-void timer_arch_init(void)
+static void timer_count_set(uint8_t mode, unsigned int count)
 {
-    uint8_t lo, hi;
-
-    outb(TIMER_IO_CMD, TIMER_OPMODE | TIMER_ACCESS);
+    outb(TIMER_IO_CMD, mode | TIMER_ACCESS);
 
     /* Divisor has to be sent byte-wise, so split here into upper/lower bytes.*/
-    lo = (uint8_t) TIMER_DIVISOR;
-    hi = (uint8_t) (TIMER_DIVISOR >> 8 );
+    outb(TIMER_IO_DAT, (uint8_t)count);
+    outb(TIMER_IO_DAT, (uint8_t)(count >> 8));
+}
+
+unsigned int timer_arch_oneshot(unsigned int ticks)
+{
+    if (ticks > TIMER_ONESHOT_MAX)
+        ticks = TIMER_ONESHOT_MAX;
+    oneshot_count = ticks * TIMER_DIVISOR;
+    timer_count_set(TIMER_ONESHOT, oneshot_count);
+    return ticks;
+}
+
+unsigned int timer_arch_periodic(void)
+{
+    uint8_t status, lo, hi;
+    unsigned int elapsed;
+
+    outb(TIMER_IO_CMD, TIMER_READBACK);
+    status = inb(TIMER_IO_DAT);
+    lo = inb(TIMER_IO_DAT);
+    hi = inb(TIMER_IO_DAT);
+
+    if ((status & TIMER_STATUS_OUT) != 0) {
+        /* Expired, the (pending) interrupt accounts the last tick */
+        elapsed = oneshot_count / TIMER_DIVISOR - 1;
+    } else {
+        /* Woken by another interrupt, the tick fraction is lost */
+        elapsed = (oneshot_count - ((hi << 8) | lo)) / TIMER_DIVISOR;
+    }
+    timer_count_set(TIMER_OPMODE, TIMER_DIVISOR);
+    return elapsed;
+}
+
+uint64_t timer_monotonic(void)
+{
+    if (tsc_khz() == 0)
+        return (uint64_t)timer_ticks * NSECS_PER_TICK;
+    return tsc_to_nsecs(tsc_read() - boot_tsc);
+}
+
+void timer_arch_init(void)
+{
+    tsc_init();
+    boot_tsc = tsc_read();
+    timer_realtime_base = rtc_read();
+    timepage_init(tsc_khz(), boot_tsc);
 
-    /* Send the frequency divisor. */
-    outb(TIMER_IO_DAT, lo);
-    outb(TIMER_IO_DAT, hi);
+    timer_count_set(TIMER_OPMODE, TIMER_DIVISOR);
 
     /* register the timer callback */
     isr_register_handler(ISR_TIMER, timer_handler);
 }
+
+static void lapic_timer_handler(void)
+{
+    lapic_eoi();
+    hrtimer_update();
+}
+
+int hrtimer_arch_init(void)
+{
+    if (lapic_init() < 0)
+        return -1;
+    isr_register_handler(ISR_LAPIC_TIMER, lapic_timer_handler);
+    return 0;
+}
+
+void hrtimer_arch_program(uint64_t nsecs)
+{
+    uint64_t count;
+
+    /* Bounded to not overflow, the event is then reprogrammed */
+    if (nsecs > NSECS_PER_SEC)
+        nsecs = NSECS_PER_SEC;
+    count = nsecs * lapic_timer_khz() / 1000000;
+    if (count == 0)
+        count = 1;
+    else if (count > 0xFFFFFFFF)
+        count = 0xFFFFFFFF;
+    lapic_timer_oneshot((uint32_t)count);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "tsc.h"
+#include "io.h"
+
+/* Calibration period */
+#define TSC_CALIBRATE_MS    10
+
+#define PIT_HZ              1193182
+#define PIT_IO_CH2          0x42    /* Channel 2 data port */
+#define PIT_IO_CMD          0x43    /* Command port */
+#define PIT_CH2_ONESHOT     0xB0    /* Channel 2, 16bit, mode 0 */
+#define PIT_IO_GATE         0x61    /* Channel 2 gate and output */
+#define PIT_GATE_ON         0x01    /* Gate input enable */
+#define PIT_SPEAKER_ON      0x02    /* Speaker data enable */
+#define PIT_CH2_OUT         0x20    /* Channel 2 output state */
+
+static uint32_t khz;
+
+void tsc_init(void)
+{
+    unsigned int count = PIT_HZ / (1000 / TSC_CALIBRATE_MS);
+    uint64_t start, end;
+    uint8_t gate;
+
+    /* Gate the channel 2 with the speaker disconnected */
+    gate = inb(PIT_IO_GATE);
+    outb(PIT_IO_GATE, (gate & ~PIT_SPEAKER_ON) & ~PIT_GATE_ON);
+    outb(PIT_IO_CMD, PIT_CH2_ONESHOT);
+    outb(PIT_IO_CH2, (uint8_t)count);
+    outb(PIT_IO_CH2, (uint8_t)(count >> 8));
+
+    /* The count starts with the gate rising edge */
+    outb(PIT_IO_GATE, (gate & ~PIT_SPEAKER_ON) | PIT_GATE_ON);
+    start = tsc_read();
+    while ((inb(PIT_IO_GATE) & PIT_CH2_OUT) == 0)
+        ;
+    end = tsc_read();
+    outb(PIT_IO_GATE, gate);
+
+    khz = (uint32_t)((end - start) / TSC_CALIBRATE_MS);
+}
+
+uint32_t tsc_khz(void)
+{
+    return khz;
+}
+
+uint64_t tsc_to_usecs(uint64_t cycles)
+{
+    if (khz == 0)
+        return 0;
+    return cycles * 1000 / khz;
+}
+
+/*
+ * Split to not overflow the multiplication, the remainder is less
+ * than the frequency.
+ */
+uint64_t tsc_to_nsecs(uint64_t cycles)
+{
+    if (khz == 0)
+        return 0;
+    return (cycles / khz) * 1000000 + (cycles % khz) * 1000000 / khz;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_ARCH_X86_TSC_H_
+#define BEEOS_ARCH_X86_TSC_H_
+
+#include <stdint.h>
+
+/**
+ * Read the processor time stamp counter.
+ */
+static inline uint64_t tsc_read(void)
+{
+    uint32_t lo, hi;
+
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Calibrate the time stamp counter against the PIT channel 2.
+ * Busy waits for 10 milliseconds, called once at boot.
+ */
+void tsc_init(void);
+
+/**
+ * Time stamp counter frequency.
+ *
+ * @return  Frequency in kHz, zero if not calibrated yet.
+ */
+uint32_t tsc_khz(void);
+
+/**
+ * Convert time stamp counter cycles to microseconds.
+ *
+ * @param cycles    Cycles count.
+ * @return          Microseconds, zero if not calibrated yet.
+ */
+uint64_t tsc_to_usecs(uint64_t cycles);
+
+/**
+ * Convert time stamp counter cycles to nanoseconds.
+ *
+ * @param cycles    Cycles count.
+ * @return          Nanoseconds, zero if not calibrated yet.
+ */
+uint64_t tsc_to_nsecs(uint64_t cycles);
+
+#endif /* BEEOS_ARCH_X86_TSC_H_ */
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Virtio block device, legacy PCI interface.
+ * Requests are published on a single virtqueue and many of them can be
+ * in flight at the same time. Completions are collected by the
+ * interrupt handler from the used ring.
+ */
+
+#include "virtio_blk.h"
+#include "pci.h"
+#include "io.h"
+#include "vmem.h"
+#include "paging_bits.h"
+#include "isr.h"
+#include "dev.h"
+#include "driver/blkdev.h"
+#include "mm/frame.h"
+#include "kprintf.h"
+#include "util.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define VIRTIO_VENDOR           0x1AF4
+#define VIRTIO_BLK_LEGACY       0x1001
+
+/* Legacy registers (offset from the I/O BAR) */
+#define VIRTIO_HOST_FEATURES    0x00
+#define VIRTIO_GUEST_FEATURES   0x04
+#define VIRTIO_QUEUE_PFN        0x08
+#define VIRTIO_QUEUE_SIZE       0x0C
+#define VIRTIO_QUEUE_SELECT     0x0E
+#define VIRTIO_QUEUE_NOTIFY     0x10
+#define VIRTIO_STATUS           0x12
+#define VIRTIO_ISR              0x13
+#define VIRTIO_BLK_CAPACITY     0x14    /* 64 bits, in sectors */
+
+/* Device status bits */
+#define VIRTIO_STATUS_ACK       0x01
+#define VIRTIO_STATUS_DRIVER    0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+#define VIRTIO_STATUS_FAILED    0x80
+
+/* Descriptor flags */
+#define VRING_DESC_F_NEXT       0x01
+#define VRING_DESC_F_WRITE      0x02
+
+#define VRING_ALIGN             PAGE_SIZE
+
+/* Request types */
+#define VIRTIO_BLK_T_IN         0
+#define VIRTIO_BLK_T_OUT        1
+
+#define VIRTIO_BLK_S_OK         0
+
+/* Bios per request, each request uses two more descriptors */
+#define VIRTIO_BLK_MAX_BIOS     16
+#define VIRTIO_BLK_DESCS        (VIRTIO_BLK_MAX_BIOS + 2)
+
+/* Queue memory is allocated as a single block, up to 64 KiB */
+#define VIRTIO_QUEUE_ORDER_MAX  4
+
+/* Device addressable data is limited to the identity mapped low memory */
+#define VIRTIO_DMA_TOP          (KVBASE + 0x400000)
+
+struct vring_desc {
+    uint64_t    addr;
+    uint32_t    len;
+    uint16_t    flags;
+    uint16_t    next;
+};
+
+struct vring_avail {
+    uint16_t    flags;
+    uint16_t    idx;
+    uint16_t    ring[];
+};
+
+struct vring_used_elem {
+    uint32_t    id;
+    uint32_t    len;
+};
+
+struct vring_used {
+    uint16_t                flags;
+    uint16_t                idx;
+    struct vring_used_elem  ring[];
+};
+
+/* Request header, device readable */
+struct virtio_blk_hdr {
+    uint32_t    type;
+    uint32_t    reserved;
+    uint64_t    sector;
+};
+
+/* Per request (head descriptor) state */
+struct virtio_blk_slot {
+    struct virtio_blk_hdr   hdr;
+    uint8_t                 status;     /* Device writable */
+    struct blk_request      *req;
+};
+
+static struct {
+    uint16_t                iobase;
+    uint32_t                sectors;
+    uint16_t                qsize;
+    volatile struct vring_desc  *desc;
+    volatile struct vring_avail *avail;
+    volatile struct vring_used  *used;
+    uint16_t                used_last;  /* Next used element to consume */
+    uint16_t                free_head;  /* Free descriptors list */
+    uint16_t                nfree;
+    struct virtio_blk_slot  *slots;     /* Indexed by head descriptor */
+} vblk;
+
+static struct blk_ops virtio_blk_ops;
+
+/* Prevents the compiler from reordering the rings accesses */
+#define barrier()   asm volatile("" : : : "memory")
+
+
+static uint16_t desc_alloc(void)
+{
+    uint16_t i = vblk.free_head;
+
+    vblk.free_head = vblk.desc[i].next;
+    vblk.nfree--;
+    return i;
+}
+
+static void desc_free_chain(uint16_t i)
+{
+    uint16_t next;
+
+    for (;;) {
+        next = vblk.desc[i].next;
+        vblk.desc[i].next = vblk.free_head;
+        vblk.free_head = i;
+        vblk.nfree++;
+        if ((vblk.desc[i].flags & VRING_DESC_F_NEXT) == 0)
+            break;
+        i = next;
+    }
+}
+
+static uint16_t desc_add(uint16_t prev, void *data, uint32_t len,
+                         uint16_t flags)
+{
+    uint16_t i = desc_alloc();
+
+    vblk.desc[i].addr = (uint32_t)virt_to_phys(data);
+    vblk.desc[i].len = len;
+    vblk.desc[i].flags = flags;
+    vblk.desc[prev].flags |= VRING_DESC_F_NEXT;
+    vblk.desc[prev].next = i;
+    return i;
+}
+
+static void virtio_blk_request(struct blk_request *req)
+{
+    struct virtio_blk_slot *slot;
+    struct bio *bio;
+    uint16_t head, i;
+
+    /* The block layer honours the depth and max bios limits */
+    if (req->dev != DEV_VDA || vblk.nfree < req->nbios + 2 ||
+        req->sector + req->size / BLK_SECTOR_SIZE > vblk.sectors) {
+        blk_end_request(req, 1);
+        return;
+    }
+    for (bio = req->head; bio != NULL; bio = bio->next) {
+        if ((uintptr_t)bio->data < KVBASE ||
+            (uintptr_t)bio->data + bio->size > VIRTIO_DMA_TOP) {
+            blk_end_request(req, 1);
+            return;
+        }
+    }
+
+    head = desc_alloc();
+    slot = &vblk.slots[head];
+    slot->req = req;
+    slot->hdr.type = (req->write != 0) ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+    slot->hdr.reserved = 0;
+    slot->hdr.sector = req->sector;
+    slot->status = 0xFF;
+    vblk.desc[head].addr = (uint32_t)virt_to_phys(&slot->hdr);
+    vblk.desc[head].len = sizeof(slot->hdr);
+    vblk.desc[head].flags = 0;
+
+    i = head;
+    for (bio = req->head; bio != NULL; bio = bio->next)
+        i = desc_add(i, bio->data, bio->size,
+                     (req->write != 0) ? 0 : VRING_DESC_F_WRITE);
+    desc_add(i, &slot->status, 1, VRING_DESC_F_WRITE);
+
+    vblk.avail->ring[vblk.avail->idx % vblk.qsize] = head;
+    barrier();
+    vblk.avail->idx++;
+    barrier();
+    outw(vblk.iobase + VIRTIO_QUEUE_NOTIFY, 0);
+}
+
+static void virtio_blk_irq(void)
+{
+    volatile struct vring_used_elem *elem;
+    struct virtio_blk_slot *slot;
+    struct blk_request *req;
+    uint16_t head;
+
+    /* Reading the ISR status acknowledges the interrupt */
+    inb(vblk.iobase + VIRTIO_ISR);
+
+    while (vblk.used_last != vblk.used->idx) {
+        barrier();
+        elem = &vblk.used->ring[vblk.used_last % vblk.qsize];
+        head = (uint16_t)elem->id;
+        vblk.used_last++;
+        slot = &vblk.slots[head];
+        req = slot->req;
+        slot->req = NULL;
+        desc_free_chain(head);
+        /* May queue the next request, the descriptors are free */
+        blk_end_request(req, slot->status != VIRTIO_BLK_S_OK);
+    }
+}
+
+static uint32_t virtio_blk_sectors(dev_t dev)
+{
+    return (dev == DEV_VDA) ? vblk.sectors : 0;
+}
+
+
+/* Legacy ring layout, the used ring is page aligned */
+static size_t vring_size(unsigned int qsize)
+{
+    return ALIGN_UP(sizeof(struct vring_desc) * qsize +
+                    sizeof(uint16_t) * (3 + qsize), VRING_ALIGN) +
+           ALIGN_UP(sizeof(uint16_t) * 3 +
+                    sizeof(struct vring_used_elem) * qsize, VRING_ALIGN);
+}
+
+static int virtio_blk_queue_init(void)
+{
+    unsigned int order, i;
+    size_t size;
+    char *mem;
+
+    outw(vblk.iobase + VIRTIO_QUEUE_SELECT, 0);
+    vblk.qsize = inw(vblk.iobase + VIRTIO_QUEUE_SIZE);
+    if (vblk.qsize < VIRTIO_BLK_DESCS)
+        return -1;
+
+    /* The slots (headers and status) follow the rings, device accessible */
+    size = vring_size(vblk.qsize) +
+           sizeof(struct virtio_blk_slot) * vblk.qsize;
+    for (order = 0; (PAGE_SIZE << order) < size; order++)
+        ;
+    if (order > VIRTIO_QUEUE_ORDER_MAX)
+        return -1;
+    mem = (char *)frame_alloc(order, ZONE_LOW);
+    if (mem == NULL)
+        return -1;
+    mem = (char *)phys_to_virt(mem);
+    memset(mem, 0, PAGE_SIZE << order);
+
+    vblk.slots = (struct virtio_blk_slot *)(mem + vring_size(vblk.qsize));
+
+    vblk.desc = (struct vring_desc *)mem;
+    vblk.avail = (struct vring_avail *)(mem +
+                    sizeof(struct vring_desc) * vblk.qsize);
+    vblk.used = (struct vring_used *)(mem +
+                    ALIGN_UP(sizeof(struct vring_desc) * vblk.qsize +
+                             sizeof(uint16_t) * (3 + vblk.qsize),
+                             VRING_ALIGN));
+    for (i = 0; i < vblk.qsize; i++)
+        vblk.desc[i].next = i + 1;
+    vblk.free_head = 0;
+    vblk.nfree = vblk.qsize;
+    vblk.used_last = 0;
+
+    outl(vblk.iobase + VIRTIO_QUEUE_PFN,
+         (uint32_t)virt_to_phys(mem) / PAGE_SIZE);
+    return 0;
+}
+
+void virtio_blk_init(void)
+{
+    const struct pci_dev *pdev;
+    uint32_t cap_hi;
+
+    pdev = pci_find_device(VIRTIO_VENDOR, VIRTIO_BLK_LEGACY, NULL);
+    if (pdev == NULL || (pdev->bar[0] & PCI_BAR_IO) == 0 || pdev->irq >= 16)
+        return;
+    pci_enable(pdev);
+    vblk.iobase = pdev->bar[0] & ~0x03;
+
+    /* Reset and negotiate, no optional feature is used */
+    outb(vblk.iobase + VIRTIO_STATUS, 0);
+    outb(vblk.iobase + VIRTIO_STATUS, VIRTIO_STATUS_ACK);
+    outb(vblk.iobase + VIRTIO_STATUS,
+         VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER);
+    inl(vblk.iobase + VIRTIO_HOST_FEATURES);
+    outl(vblk.iobase + VIRTIO_GUEST_FEATURES, 0);
+
+    /* Sectors beyond 32 bits (2 TiB) are not addressable */
+    vblk.sectors = inl(vblk.iobase + VIRTIO_BLK_CAPACITY);
+    cap_hi = inl(vblk.iobase + VIRTIO_BLK_CAPACITY + 4);
+    if (cap_hi != 0)
+        vblk.sectors = 0xFFFFFFFF;
+
+    if (virtio_blk_queue_init() < 0) {
+        outb(vblk.iobase + VIRTIO_STATUS, VIRTIO_STATUS_FAILED);
+        return;
+    }
+
+    virtio_blk_ops.request = virtio_blk_request;
+    virtio_blk_ops.sectors = virtio_blk_sectors;
+    virtio_blk_ops.depth = vblk.qsize / VIRTIO_BLK_DESCS;
+    virtio_blk_ops.max_bios = VIRTIO_BLK_MAX_BIOS;
+
+    isr_register_handler(ISR_IRQ0 + pdev->irq, virtio_blk_irq);
+    outb(vblk.iobase + VIRTIO_STATUS, VIRTIO_STATUS_ACK |
+         VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+    if (blk_register(major(DEV_VDA), &virtio_blk_ops) < 0)
+        return;
+    kprintf("vda: virtio, %u MiB, queue %u, depth %u\n",
+            vblk.sectors / 2048, vblk.qsize, virtio_blk_ops.depth);
+}
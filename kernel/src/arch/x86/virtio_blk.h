@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_ARCH_X86_VIRTIO_BLK_H_
+#define BEEOS_ARCH_X86_VIRTIO_BLK_H_
+
+/**
+ * Probe the first legacy virtio block device on the PCI bus and register
+ * it as a block device. Must be called after the PCI enumeration.
+ */
+void virtio_blk_init(void);
+
+#endif /* BEEOS_ARCH_X86_VIRTIO_BLK_H_ */
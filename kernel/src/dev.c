@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "dev.h"
+#include <sys/stat.h>
+#include <errno.h>
+#include <stddef.h>
+
+
+/* Character and block device switch tables, indexed by major */
+static const struct dev_ops *chr_devs[DEV_MAJORS];
+static const struct dev_ops *blk_devs[DEV_MAJORS];
+
+
+static const struct dev_ops **dev_table(mode_t type)
+{
+    if (S_ISCHR(type))
+        return chr_devs;
+    if (S_ISBLK(type))
+        return blk_devs;
+    return NULL;
+}
+
+int dev_register(mode_t type, unsigned int major, const struct dev_ops *ops)
+{
+    const struct dev_ops **table;
+
+    table = dev_table(type);
+    if (table == NULL || major >= DEV_MAJORS || ops == NULL)
+        return -EINVAL;
+    if (table[major] != NULL)
+        return -EBUSY;
+    table[major] = ops;
+    return 0;
+}
+
+void dev_unregister(mode_t type, unsigned int major)
+{
+    const struct dev_ops **table;
+
+    table = dev_table(type);
+    if (table != NULL && major < DEV_MAJORS)
+        table[major] = NULL;
+}
+
+const struct dev_ops *dev_ops_get(mode_t type, dev_t dev)
+{
+    const struct dev_ops **table;
+
+    table = dev_table(type);
+    if (table == NULL || major(dev) >= DEV_MAJORS)
+        return NULL;
+    return table[major(dev)];
+}
+
+ssize_t dev_read(mode_t type, dev_t dev, void *buf, size_t size, size_t off)
+{
+    const struct dev_ops *ops;
+
+    ops = dev_ops_get(type, dev);
+    if (ops == NULL)
+        return -ENODEV;
+    return ops->read(dev, buf, size, off);
+}
+
+ssize_t dev_write(mode_t type, dev_t dev, const void *buf, size_t size,
+                  size_t off)
+{
+    const struct dev_ops *ops;
+
+    ops = dev_ops_get(type, dev);
+    if (ops == NULL)
+        return -ENODEV;
+    return ops->write(dev, buf, size, off);
+}
+
+void *dev_direct(mode_t type, dev_t dev, size_t size, size_t off)
+{
+    const struct dev_ops *ops;
+
+    ops = dev_ops_get(type, dev);
+    if (ops == NULL || ops->direct == NULL)
+        return NULL;
+    return ops->direct(dev, size, off);
+}
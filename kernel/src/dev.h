@@ -59,6 +59,88 @@
 /** Block devices @{ */
 /** Initial ram-disk */
 #define DEV_INITRD              0x01FA
+/** First IDE channel, master disk */
+#define DEV_HDA                 0x0300
+/** First IDE channel, slave disk */
+#define DEV_HDB                 0x0340
+/** Second IDE channel, master disk */
+#define DEV_HDC                 0x1600
+/** Second IDE channel, slave disk */
+#define DEV_HDD                 0x1640
+/** First virtio block device */
+#define DEV_VDA                 0xFD00
 /** @} */
 
+
+/** Maximum number of majors per device type */
+#define DEV_MAJORS              256
+
+/**
+ * Device driver operations.
+ * Each driver serves all the minors of one or more majors.
+ */
+struct dev_ops {
+    /** Read from the device (mandatory) */
+    ssize_t (* read)(dev_t dev, void *buf, size_t size, size_t off);
+    /** Write to the device (mandatory) */
+    ssize_t (* write)(dev_t dev, const void *buf, size_t size, size_t off);
+    /** Direct memory access for memory backed devices (optional) */
+    void *(* direct)(dev_t dev, size_t size, size_t off);
+};
+
+/**
+ * Register a device driver.
+ *
+ * @param type  Device type (S_IFCHR or S_IFBLK).
+ * @param major Major number served by the driver.
+ * @param ops   Driver operations.
+ * @return      0 on success, -EINVAL if the type or the major are not
+ *              valid, -EBUSY if the major is already taken.
+ */
+int dev_register(mode_t type, unsigned int major, const struct dev_ops *ops);
+
+/**
+ * Unregister a device driver.
+ *
+ * @param type  Device type (S_IFCHR or S_IFBLK).
+ * @param major Major number served by the driver.
+ */
+void dev_unregister(mode_t type, unsigned int major);
+
+/**
+ * Get the driver operations for a device.
+ *
+ * @param type  Device type (S_IFCHR or S_IFBLK).
+ * @param dev   Device number.
+ * @return      Driver operations or NULL if no driver is registered.
+ */
+const struct dev_ops *dev_ops_get(mode_t type, dev_t dev);
+
+/**
+ * Read from a device.
+ *
+ * @return  Number of bytes read or -ENODEV if no driver is registered.
+ */
+ssize_t dev_read(mode_t type, dev_t dev, void *buf, size_t size, size_t off);
+
+/**
+ * Write to a device.
+ *
+ * @return  Number of bytes written or -ENODEV if no driver is registered.
+ */
+ssize_t dev_write(mode_t type, dev_t dev, const void *buf, size_t size,
+                  size_t off);
+
+/**
+ * Direct access to the memory of memory backed devices.
+ *
+ * @param type  Device type (S_IFCHR or S_IFBLK).
+ * @param dev   Device.
+ * @param size  Size of the range.
+ * @param off   Range offset from the device start.
+ * @return      Pointer to the range or NULL if the device is not memory
+ *              backed or the range is out of bounds.
+ */
+void *dev_direct(mode_t type, dev_t dev, size_t size, size_t off);
+
 #endif /* BEEOS_DEV_H_ */
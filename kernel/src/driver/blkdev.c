@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "driver/blkdev.h"
+#include "dev.h"
+#include "sync/cond.h"
+#include "proc.h"
+#include "arch/x86/misc.h"
+#include "arch/x86/vmem.h"
+#include "mm/frame.h"
+#include "kmalloc.h"
+#include "kprintf.h"
+#include "util.h"
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+
+
+struct blk_queue {
+    const struct blk_ops    *ops;
+    struct list_link        pending;    /* Sorted by device and sector */
+    unsigned int            depth;      /* Pending requests */
+    unsigned int            inflight;   /* Requests served by the driver */
+    unsigned int            inflight_max;
+    int                     plugged;    /* Dispatch is deferred */
+    int                     running;    /* Dispatch loop is running */
+    struct cond             done;       /* Bios completion */
+    struct blk_stats        stats;
+};
+
+static struct blk_queue *blk_queues[DEV_MAJORS];
+
+/* Bounce buffer size for byte granular accesses */
+#define BLK_BOUNCE_ORDER    2
+#define BLK_BOUNCE_SIZE     (PAGE_SIZE << BLK_BOUNCE_ORDER)
+
+/*
+ * Single bounce buffer, allocated from the low memory zone when the first
+ * not memory backed device is registered, thus addressable by DMA.
+ */
+static char *blk_bounce;
+static int blk_bounce_busy;
+static struct cond blk_bounce_free;
+
+
+static struct blk_queue *blk_queue_get(dev_t dev)
+{
+    return blk_queues[major(dev)];
+}
+
+static void blk_run(struct blk_queue *q)
+{
+    struct blk_request *req;
+
+    /* Synchronous drivers complete from within the loop */
+    if (q->running != 0)
+        return;
+    q->running = 1;
+    while (q->inflight < q->inflight_max && q->plugged == 0) {
+        if (list_empty(&q->pending)) {
+            /* Drained, plug again to collect the next batch */
+            q->plugged = 1;
+            break;
+        }
+        req = list_container(q->pending.next, struct blk_request, link);
+        list_delete(&req->link);
+        q->stats.depth_sum += q->depth;
+        q->depth--;
+        q->stats.requests++;
+        q->inflight++;
+        if (q->inflight > q->stats.inflight_max)
+            q->stats.inflight_max = q->inflight;
+        q->ops->request(req);
+    }
+    q->running = 0;
+}
+
+void blk_unplug(dev_t dev)
+{
+    struct blk_queue *q;
+
+    q = blk_queue_get(dev);
+    if (q != NULL) {
+        q->plugged = 0;
+        blk_run(q);
+    }
+}
+
+void blk_end_request(struct blk_request *req, int error)
+{
+    struct blk_queue *q = blk_queue_get(req->dev);
+    struct bio *bio, *next;
+
+    if (error != 0)
+        q->stats.errors++;
+    for (bio = req->head; bio != NULL; bio = next) {
+        /* The callback may release the bio */
+        next = bio->next;
+        bio->flags |= BIO_DONE | ((error != 0) ? BIO_ERROR : 0);
+        if (bio->end != NULL)
+            bio->end(bio);
+    }
+    q->inflight--;
+    kfree(req, sizeof(*req));
+    cond_broadcast(&q->done);
+    blk_run(q);
+}
+
+/*
+ * Try to append or prepend a bio to a pending request.
+ */
+static int blk_merge(struct blk_queue *q, struct bio *bio)
+{
+    struct list_link *curr;
+    struct blk_request *req;
+    uint32_t nsect;
+
+    for (curr = q->pending.next; curr != &q->pending; curr = curr->next) {
+        req = list_container(curr, struct blk_request, link);
+        if (req->dev != bio->dev || req->write != bio->write ||
+            req->size + bio->size > BLK_REQUEST_MAX ||
+            (q->ops->max_bios != 0 && req->nbios == q->ops->max_bios))
+            continue;
+        nsect = req->size / BLK_SECTOR_SIZE;
+        if (req->sector + nsect == bio->sector) {
+            req->tail->next = bio;
+            req->tail = bio;
+        } else if (bio->sector + bio->size / BLK_SECTOR_SIZE ==
+                   req->sector) {
+            bio->next = req->head;
+            req->head = bio;
+            req->sector = bio->sector;
+        } else {
+            continue;
+        }
+        req->size += bio->size;
+        req->nbios++;
+        return 0;
+    }
+    return -1;
+}
+
+/*
+ * Insert a request keeping the queue sorted (one way elevator).
+ */
+static void blk_insert(struct blk_queue *q, struct blk_request *req)
+{
+    struct list_link *curr;
+    struct blk_request *r;
+
+    for (curr = q->pending.next; curr != &q->pending; curr = curr->next) {
+        r = list_container(curr, struct blk_request, link);
+        if (r->dev > req->dev ||
+            (r->dev == req->dev && r->sector > req->sector))
+            break;
+    }
+    list_insert_before(curr, &req->link);
+    q->depth++;
+    if (q->depth > q->stats.depth_max)
+        q->stats.depth_max = q->depth;
+}
+
+void bio_init(struct bio *bio, dev_t dev, uint32_t sector, void *data,
+              size_t size, int write)
+{
+    bio->dev = dev;
+    bio->sector = sector;
+    bio->size = size;
+    bio->data = data;
+    bio->write = write;
+    bio->flags = 0;
+    bio->end = NULL;
+    bio->priv = NULL;
+    bio->next = NULL;
+}
+
+int blk_submit(struct bio *bio)
+{
+    struct blk_queue *q;
+    struct blk_request *req;
+
+    q = blk_queue_get(bio->dev);
+    if (q == NULL)
+        return -ENODEV;
+    bio->flags = 0;
+    bio->next = NULL;
+    q->stats.bios++;
+
+    if (blk_merge(q, bio) == 0) {
+        q->stats.merges++;
+        return 0;
+    }
+
+    req = (struct blk_request *)kmalloc(sizeof(*req), 0);
+    if (req == NULL) {
+        /* Flush the queue and retry */
+        blk_unplug(bio->dev);
+        req = (struct blk_request *)kmalloc(sizeof(*req), 0);
+        if (req == NULL)
+            return -ENOMEM;
+    }
+    req->dev = bio->dev;
+    req->sector = bio->sector;
+    req->size = bio->size;
+    req->write = bio->write;
+    req->nbios = 1;
+    req->head = bio;
+    req->tail = bio;
+    blk_insert(q, req);
+
+    if (q->depth >= BLK_QUEUE_DEPTH_MAX)
+        q->plugged = 0;
+    blk_run(q);
+    return 0;
+}
+
+int blk_wait(struct bio *bio)
+{
+    struct blk_queue *q;
+
+    q = blk_queue_get(bio->dev);
+    if (q == NULL)
+        return -ENODEV;
+    if ((bio->flags & BIO_DONE) == 0) {
+        blk_unplug(bio->dev);
+        spinlock_lock(&q->done.lock);
+        while ((bio->flags & BIO_DONE) == 0) {
+            cond_wait(&q->done);
+            if (!list_empty(&current->condw)) {
+                /*
+                 * Not signaled, there was nothing else to run (e.g. root
+                 * mount at boot). Halt until the next interrupt.
+                 */
+                list_delete(&current->condw);
+                sti();
+                hlt();
+                cli();
+            }
+        }
+        spinlock_unlock(&q->done.lock);
+    }
+    return ((bio->flags & BIO_ERROR) != 0) ? -EIO : 0;
+}
+
+int blk_rw(dev_t dev, uint32_t sector, void *data, size_t size, int write)
+{
+    struct bio bio;
+    int res;
+
+    bio_init(&bio, dev, sector, data, size, write);
+    res = blk_submit(&bio);
+    if (res == 0)
+        res = blk_wait(&bio);
+    return res;
+}
+
+
+/*
+ * Byte granular access used by the device switch.
+ * Memory backed devices are accessed in place. Otherwise the transfer
+ * goes through a kernel bounce buffer: bios data must be addressable by
+ * the device, thus user buffers can't be used, and partial sectors
+ * require a read-modify-write.
+ */
+static ssize_t blk_dev_rw(dev_t dev, void *buf, size_t size, size_t off,
+                          int write)
+{
+    struct blk_queue *q = blk_queue_get(dev);
+    size_t cap, done, head, n, len;
+    uint32_t sector;
+    char *ptr;
+    int res = 0;
+
+    cap = (size_t)q->ops->sectors(dev) * BLK_SECTOR_SIZE;
+    if (off >= cap)
+        return 0;
+    size = MIN(size, cap - off);
+
+    if (q->ops->direct != NULL) {
+        ptr = (char *)q->ops->direct(dev, size, off);
+        if (ptr != NULL) {
+            if (write != 0)
+                memcpy(ptr, buf, size);
+            else
+                memcpy(buf, ptr, size);
+            return (ssize_t)size;
+        }
+    }
+
+    if (blk_bounce == NULL)
+        return -ENOMEM;
+    spinlock_lock(&blk_bounce_free.lock);
+    while (blk_bounce_busy != 0)
+        cond_wait(&blk_bounce_free);
+    blk_bounce_busy = 1;
+    spinlock_unlock(&blk_bounce_free.lock);
+    ptr = blk_bounce;
+    for (done = 0; done < size; done += n, off += n) {
+        head = off % BLK_SECTOR_SIZE;
+        sector = off / BLK_SECTOR_SIZE;
+        n = MIN(size - done, BLK_BOUNCE_SIZE - head);
+        len = ALIGN_UP(head + n, BLK_SECTOR_SIZE);
+        if (write == 0 || head != 0 || len != head + n) {
+            res = blk_rw(dev, sector, ptr, len, 0);
+            if (res != 0)
+                break;
+        }
+        if (write != 0) {
+            memcpy(ptr + head, (char *)buf + done, n);
+            res = blk_rw(dev, sector, ptr, len, 1);
+            if (res != 0)
+                break;
+        } else {
+            memcpy((char *)buf + done, ptr + head, n);
+        }
+    }
+    spinlock_lock(&blk_bounce_free.lock);
+    blk_bounce_busy = 0;
+    cond_signal(&blk_bounce_free);
+    spinlock_unlock(&blk_bounce_free.lock);
+    if (res != 0 && done == 0)
+        return res;
+    /* Eventually report the partial transfer */
+    return (ssize_t)done;
+}
+
+static ssize_t blk_dev_read(dev_t dev, void *buf, size_t size, size_t off)
+{
+    return blk_dev_rw(dev, buf, size, off, 0);
+}
+
+static ssize_t blk_dev_write(dev_t dev, const void *buf, size_t size,
+                             size_t off)
+{
+    return blk_dev_rw(dev, (void *)buf, size, off, 1);
+}
+
+static void *blk_dev_direct(dev_t dev, size_t size, size_t off)
+{
+    struct blk_queue *q = blk_queue_get(dev);
+
+    if (q->ops->direct == NULL)
+        return NULL;
+    return q->ops->direct(dev, size, off);
+}
+
+static const struct dev_ops blk_dev_ops = {
+    .read   = blk_dev_read,
+    .write  = blk_dev_write,
+    .direct = blk_dev_direct,
+};
+
+
+int blk_register(unsigned int major, const struct blk_ops *ops)
+{
+    struct blk_queue *q;
+    int res;
+
+    if (major >= DEV_MAJORS || ops == NULL || ops->request == NULL ||
+        ops->sectors == NULL)
+        return -EINVAL;
+    if (blk_queues[major] != NULL)
+        return -EBUSY;
+    if (ops->direct == NULL && blk_bounce == NULL) {
+        blk_bounce = (char *)frame_alloc(BLK_BOUNCE_ORDER, ZONE_LOW);
+        if (blk_bounce == NULL)
+            return -ENOMEM;
+        blk_bounce = (char *)phys_to_virt(blk_bounce);
+        cond_init(&blk_bounce_free);
+    }
+    q = (struct blk_queue *)kmalloc(sizeof(*q), 0);
+    if (q == NULL)
+        return -ENOMEM;
+    memset(q, 0, sizeof(*q));
+    q->ops = ops;
+    list_init(&q->pending);
+    q->plugged = 1;
+    q->inflight_max = (ops->depth != 0) ? ops->depth : 1;
+    cond_init(&q->done);
+
+    res = dev_register(S_IFBLK, major, &blk_dev_ops);
+    if (res < 0) {
+        kfree(q, sizeof(*q));
+        return res;
+    }
+    blk_queues[major] = q;
+    return 0;
+}
+
+int blk_stats_get(unsigned int major, struct blk_stats *st)
+{
+    if (major >= DEV_MAJORS || blk_queues[major] == NULL)
+        return -ENODEV;
+    *st = blk_queues[major]->stats;
+    return 0;
+}
+
+void blk_dump(void)
+{
+    unsigned int i;
+    const struct blk_stats *st;
+
+    for (i = 0; i < DEV_MAJORS; i++) {
+        if (blk_queues[i] == NULL)
+            continue;
+        st = &blk_queues[i]->stats;
+        kprintf("blk%u: bios=%u, reqs=%u, merges=%u%%\n", i, st->bios,
+                st->requests,
+                (st->bios != 0) ? (st->merges * 100) / st->bios : 0);
+        kprintf("blk%u: depth avg=%u, max=%u, inflight=%u\n", i,
+                (st->requests != 0) ? st->depth_sum / st->requests : 0,
+                st->depth_max, st->inflight_max);
+        kprintf("blk%u: errors=%u\n", i, st->errors);
+    }
+}
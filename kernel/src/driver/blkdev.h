@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/**
+ * Block I/O layer.
+ *
+ * File systems describe transfers with bios, which are queued per driver
+ * sorted by device and sector (elevator) and merged with adjacent bios
+ * of the same direction into a single request. A queue is plugged while
+ * filling up: requests are dispatched to the driver when someone waits
+ * for a bio, on explicit unplug or when the queue depth limit is reached.
+ * Drivers complete requests, possibly from an interrupt handler, with
+ * blk_end_request, which triggers the bios completion callbacks.
+ */
+
+#ifndef BEEOS_DRIVER_BLKDEV_H_
+#define BEEOS_DRIVER_BLKDEV_H_
+
+#include "list.h"
+#include <stdint.h>
+#include <sys/types.h>
+
+/** Block layer addressing unit */
+#define BLK_SECTOR_SIZE     512
+
+/** Max size of a request built by merging bios */
+#define BLK_REQUEST_MAX     (128 * 1024)
+
+/** Pending requests that force the queue dispatch */
+#define BLK_QUEUE_DEPTH_MAX 32
+
+/** Bio is completed */
+#define BIO_DONE            0x01
+/** Bio is completed with error */
+#define BIO_ERROR           0x02
+
+struct bio;
+
+/** Bio completion callback. Can be called from interrupt context. */
+typedef void (bio_end_t)(struct bio *bio);
+
+/** Block I/O descriptor */
+struct bio {
+    dev_t           dev;        /**< Device */
+    uint32_t        sector;     /**< First sector */
+    size_t          size;       /**< Size, multiple of the sector size */
+    void            *data;      /**< Data buffer (kernel low memory) */
+    int             write;      /**< Transfer direction */
+    volatile int    flags;      /**< Completion status */
+    bio_end_t       *end;       /**< Completion callback (optional) */
+    void            *priv;      /**< Completion callback private data */
+    struct bio      *next;      /**< Next bio within the request */
+};
+
+/** Block request: physically adjacent bios with the same direction */
+struct blk_request {
+    dev_t               dev;        /**< Device */
+    uint32_t            sector;     /**< First sector */
+    size_t              size;       /**< Total size */
+    int                 write;      /**< Transfer direction */
+    unsigned int        nbios;      /**< Number of bios */
+    struct bio          *head;      /**< First bio */
+    struct bio          *tail;      /**< Last bio */
+    struct list_link    link;       /**< Link within the queue */
+};
+
+/** Block driver operations */
+struct blk_ops {
+    /**
+     * Start the processing of a request (mandatory).
+     * The driver signals the completion via blk_end_request.
+     */
+    void (* request)(struct blk_request *req);
+    /** Device size in sectors (mandatory) */
+    uint32_t (* sectors)(dev_t dev);
+    /** Direct memory access for memory backed devices (optional) */
+    void *(* direct)(dev_t dev, size_t size, size_t off);
+    /** Max requests in flight (0 is 1) */
+    unsigned int depth;
+    /** Max bios per request (0 is unlimited) */
+    unsigned int max_bios;
+};
+
+/** Block queue statistics */
+struct blk_stats {
+    unsigned long   bios;       /**< Submitted bios */
+    unsigned long   merges;     /**< Bios merged into a pending request */
+    unsigned long   requests;   /**< Requests dispatched to the driver */
+    unsigned long   depth_sum;  /**< Sum of the depths at dispatch time */
+    unsigned long   depth_max;  /**< Max pending requests */
+    unsigned long   inflight_max; /**< Max requests in flight */
+    unsigned long   errors;     /**< Failed requests */
+};
+
+/**
+ * Register a block driver.
+ * The driver is also reachable via the device switch (dev_read, ...)
+ * for byte granular accesses.
+ *
+ * @param major Major number served by the driver.
+ * @param ops   Driver operations.
+ * @return      0 on success, a negative error code otherwise.
+ */
+int blk_register(unsigned int major, const struct blk_ops *ops);
+
+/**
+ * Initialize a bio.
+ *
+ * @param bio       Bio pointer.
+ * @param dev       Device.
+ * @param sector    First sector.
+ * @param data      Data buffer. Must be kernel low memory (e.g. from
+ *                  kmalloc), thus addressable by DMA capable devices.
+ * @param size      Size, multiple of BLK_SECTOR_SIZE.
+ * @param write     Non zero for a write transfer.
+ */
+void bio_init(struct bio *bio, dev_t dev, uint32_t sector, void *data,
+              size_t size, int write);
+
+/**
+ * Queue a bio. The bio must stay valid until completed.
+ *
+ * @param bio   Bio pointer.
+ * @return      0 on success, -ENODEV if there is no driver for the device.
+ */
+int blk_submit(struct bio *bio);
+
+/**
+ * Dispatch the pending requests of a device queue.
+ *
+ * @param dev   Device.
+ */
+void blk_unplug(dev_t dev);
+
+/**
+ * Wait for a bio completion, dispatching its queue if required.
+ *
+ * @param bio   Bio pointer.
+ * @return      0 on success, -EIO on transfer error.
+ */
+int blk_wait(struct bio *bio);
+
+/**
+ * Synchronous transfer.
+ *
+ * @return      0 on success, a negative error code otherwise.
+ */
+int blk_rw(dev_t dev, uint32_t sector, void *data, size_t size, int write);
+
+/**
+ * Complete a request. To be called by the driver.
+ *
+ * @param req   Request pointer.
+ * @param error Non zero if the transfer failed.
+ */
+void blk_end_request(struct blk_request *req, int error);
+
+/**
+ * Get a copy of the statistics of a driver queue.
+ *
+ * @param major Driver major number.
+ * @param st    Statistics destination.
+ * @return      0 on success, -ENODEV if no driver is registered.
+ */
+int blk_stats_get(unsigned int major, struct blk_stats *st);
+
+/**
+ * Block layer dump function.
+ */
+void blk_dump(void);
+
+#endif /* BEEOS_DRIVER_BLKDEV_H_ */
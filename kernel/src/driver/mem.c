@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "driver/mem.h"
+#include "driver/random.h"
+#include "dev.h"
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+
+
+static ssize_t mem_read(dev_t dev, void *buf, size_t size, size_t off)
+{
+    ssize_t n;
+
+    switch (dev) {
+    case DEV_ZERO:
+        memset(buf, 0, size);
+        n = (ssize_t)size;
+        break;
+    case DEV_NULL:
+        n = 0;
+        break;
+    case DEV_RANDOM:
+    case DEV_URANDOM:
+        n = random_read(buf, size);
+        break;
+    case DEV_MEM:
+    case DEV_KMEM:
+        n = -1;
+        break;
+    default:
+        n = -ENODEV;
+        break;
+    }
+    return n;
+}
+
+static ssize_t mem_write(dev_t dev, const void *buf, size_t size, size_t off)
+{
+    ssize_t n;
+
+    switch (dev) {
+    case DEV_ZERO:
+    case DEV_NULL:
+        n = (ssize_t)size;
+        break;
+    case DEV_RANDOM:
+    case DEV_URANDOM:
+    case DEV_MEM:
+    case DEV_KMEM:
+        n = -1;
+        break;
+    default:
+        n = -ENODEV;
+        break;
+    }
+    return n;
+}
+
+static const struct dev_ops mem_ops = {
+    .read   = mem_read,
+    .write  = mem_write,
+};
+
+
+void mem_init(void)
+{
+    dev_register(S_IFCHR, major(DEV_MEM), &mem_ops);
+}
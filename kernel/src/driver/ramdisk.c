@@ -18,93 +18,68 @@
  */
 
 #include "driver/ramdisk.h"
+#include "driver/blkdev.h"
+#include "dev.h"
 #include "util.h"
 #include <sys/types.h>
 #include <string.h>
 
 
-#define BLOCK_SIZE  512
-
-
 static struct {
     void  *addr;
     size_t size;
 } ramdisk;
 
 
-static ssize_t ramdisk_rw_block(void *buf, size_t blocknum, int doread)
-{
-    size_t n = BLOCK_SIZE;
-    size_t off;
-
-    off = blocknum * BLOCK_SIZE;
-    if (off > ramdisk.size)
-        return -1;
-    if (off + n > ramdisk.size)
-        n = ramdisk.size - off;
-
-    if (doread == 1)
-        memcpy(buf, (char *)ramdisk.addr + off, n);
-    else
-        memcpy((char *)ramdisk.addr + off, buf, n);
-    return (ssize_t)n;
-}
-
-static ssize_t ramdisk_read_block(void *buf, size_t blocknum)
+static uint32_t ramdisk_sectors(dev_t dev)
 {
-    return ramdisk_rw_block(buf, blocknum, 1);
+    if (dev != DEV_INITRD)
+        return 0;
+    return ramdisk.size / BLK_SECTOR_SIZE;
 }
 
-#if 0
-static ssize_t ramdisk_write_block(void *buf, size_t blocknum)
-{
-    return ramdisk_rw_block(buf, blocknum, 0);
-}
-#endif
-
-static char blk[BLOCK_SIZE];
-
-ssize_t ramdisk_read(void *buf, size_t size, size_t off)
+/*
+ * Requests are served synchronously, each bio with a single copy.
+ */
+static void ramdisk_request(struct blk_request *req)
 {
-    unsigned int nblk;
-    size_t left;
-    size_t ioff;
-    ssize_t n;
-    char *ptr;
-
-    left = size;
-    nblk = off / BLOCK_SIZE;
-    ioff = off % BLOCK_SIZE;
-    ptr = (char *)buf;
+    struct bio *bio;
+    size_t off;
 
-    if ((n = ramdisk_read_block(blk, nblk)) != BLOCK_SIZE)
-        return n;
-    n = MIN(BLOCK_SIZE - ioff, left);
-    memcpy(ptr, &blk[ioff], n);
-    left -= n;
-    ptr += n;
-    nblk++;
-    while (left > 0) {
-        if ((n = ramdisk_read_block(blk, nblk)) != BLOCK_SIZE)
-            break;
-        n = MIN(BLOCK_SIZE, left);
-        memcpy(ptr, blk, n);
-        left -= n;
-        ptr += n;
-        nblk++;
+    if ((size_t)req->sector + req->size / BLK_SECTOR_SIZE >
+            ramdisk_sectors(req->dev)) {
+        blk_end_request(req, 1);
+        return;
     }
-
-    return (ssize_t)(size - left);
+    off = (size_t)req->sector * BLK_SECTOR_SIZE;
+    for (bio = req->head; bio != NULL; bio = bio->next) {
+        if (bio->write != 0)
+            memcpy((char *)ramdisk.addr + off, bio->data, bio->size);
+        else
+            memcpy(bio->data, (char *)ramdisk.addr + off, bio->size);
+        off += bio->size;
+    }
+    blk_end_request(req, 0);
 }
 
-ssize_t ramdisk_write(const void *buf, size_t size, size_t off)
+static void *ramdisk_direct(dev_t dev, size_t size, size_t off)
 {
-    return -1; /* TODO */
+    if (dev != DEV_INITRD || off >= ramdisk.size ||
+        size > ramdisk.size - off)
+        return NULL;
+    return (char *)ramdisk.addr + off;
 }
 
+static const struct blk_ops ramdisk_ops = {
+    .request = ramdisk_request,
+    .sectors = ramdisk_sectors,
+    .direct  = ramdisk_direct,
+};
+
 
 void ramdisk_init(void *addr, size_t size)
 {
     ramdisk.addr = addr;
     ramdisk.size = size;
+    blk_register(major(DEV_INITRD), &ramdisk_ops);
 }
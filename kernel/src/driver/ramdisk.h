@@ -23,11 +23,13 @@
 #include <sys/types.h>
 
 
+/**
+ * Initialize the ramdisk and register it as the initrd block device.
+ *
+ * @param addr  Ramdisk start address.
+ * @param size  Ramdisk size.
+ */
 void ramdisk_init(void *addr, size_t size);
 
-ssize_t ramdisk_read(void *buf, size_t size, size_t off);
-
-ssize_t ramdisk_write(const void *buf, size_t size, size_t off);
-
 
 #endif /* BEEOS_DRIVER_RAMDISK_H_ */
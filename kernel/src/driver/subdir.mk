@@ -1 +1 @@
-local_sources := tty.c ramdisk.c screen.c random.c
+local_sources := tty.c ramdisk.c screen.c random.c mem.c blkdev.c
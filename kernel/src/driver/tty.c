@@ -25,6 +25,7 @@
 #include "screen.h"
 #include "timer.h"
 #include <errno.h>
+#include <sys/stat.h>
 
 
 #define TTYS_CONSOLE    4
@@ -34,6 +35,24 @@ static struct tty_st tty_table[TTYS_TOTAL];
 static struct screen scr_table[TTYS_TOTAL];
 static unsigned int tty_curr;
 
+static struct timer_event refresh_tm;
+
+static void refresh_func(void)
+{
+    if (scr_table[tty_curr].dirty != 0)
+        screen_update(&scr_table[tty_curr]);
+}
+
+/*
+ * Schedule a screen refresh, if not already pending.
+ * Nothing is scheduled while the screen doesn't change.
+ */
+static void refresh_request(void)
+{
+    if (refresh_tm.func != NULL && list_empty(&refresh_tm.link))
+        timer_event_mod(&refresh_tm, timer_ticks + msecs_to_ticks(25));
+}
+
 
 static struct tty_st *tty_lookup(dev_t dev)
 {
@@ -87,6 +106,7 @@ void tty_change(unsigned int n)
     if (n < TTYS_CONSOLE) {
         tty_curr = n;
         scr_table[n].dirty = 1;
+        refresh_request();
     }
 }
 
@@ -190,6 +210,8 @@ static int tty_putchar(dev_t dev, int c)
     scr = &scr_table[i];
 
     screen_putchar(scr, (char)c);
+    if (i == tty_curr)
+        refresh_request();
 
     /* Useful for debug */
     uart_putchar(c);
@@ -282,15 +304,22 @@ static void tty_struct_init(struct tty_st *tty, dev_t dev)
 }
 
 
-static struct timer_event refresh_tm;
+static ssize_t tty_dev_read(dev_t dev, void *buf, size_t size, size_t off)
+{
+    return tty_read(dev, buf, size);
+}
 
-static void refresh_func(void)
+static ssize_t tty_dev_write(dev_t dev, const void *buf, size_t size,
+                             size_t off)
 {
-    if (scr_table[tty_curr].dirty != 0)
-        screen_update(&scr_table[tty_curr]);
-    timer_event_mod(&refresh_tm, timer_ticks + msecs_to_ticks(25));
+    return tty_write(dev, buf, size);
 }
 
+static const struct dev_ops tty_ops = {
+    .read   = tty_dev_read,
+    .write  = tty_dev_write,
+};
+
 
 void tty_init(void)
 {
@@ -302,6 +331,9 @@ void tty_init(void)
     }
     tty_curr = 0;
 
+    dev_register(S_IFCHR, major(DEV_TTY1), &tty_ops);
+    dev_register(S_IFCHR, major(DEV_TTY), &tty_ops);
+
     uart_init();
 
     timer_event_init(&refresh_tm, (timer_event_t *)refresh_func, NULL,
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "fs/buf.h"
+#include "kmalloc.h"
+#include "kprintf.h"
+#include "timer.h"
+#include "util.h"
+#include <string.h>
+
+
+#define NBUF            64  /* Number of cached blocks */
+
+#define BUF_HTABLE_BITS 5
+
+static struct buf bufs[NBUF];
+
+static struct htable_link *buf_htable[1 << BUF_HTABLE_BITS];
+
+/* Unreferenced buffers. Least recently used first. */
+static struct list_link buf_lru;
+
+static struct buf_stats stats;
+
+static struct timer_event writeback_tm;
+
+#define KEY(dev, blkno)  (((long long)(dev) << 32) + (blkno))
+
+
+static struct buf *buf_lookup(dev_t dev, uint32_t blkno, size_t size)
+{
+    struct buf *b;
+    struct htable_link *lnk;
+
+    lnk = htable_lookup(buf_htable, KEY(dev, blkno), BUF_HTABLE_BITS);
+    while (lnk != NULL) {
+        b = struct_ptr(lnk, struct buf, hlink);
+        if (b->dev == dev && b->blkno == blkno && b->size == size)
+            return b;
+        lnk = lnk->next;
+    }
+    return NULL;
+}
+
+/* Take a reference on behalf of a transfer in flight */
+static void buf_hold(struct buf *b)
+{
+    if (b->ref == 0)
+        list_delete(&b->lru);
+    b->ref++;
+}
+
+/*
+ * Transfer completion. Can be called from interrupt context.
+ */
+static void buf_io_end(struct bio *bio)
+{
+    struct buf *b = (struct buf *)bio->priv;
+
+    b->flags &= ~BUF_BUSY;
+    if ((bio->flags & BIO_ERROR) != 0) {
+        if (bio->write != 0) {
+            kprintf("bcache: write error block %u (dev=%x)\n",
+                    b->blkno, b->dev);
+            b->flags |= BUF_DIRTY;
+        }
+    } else if (bio->write == 0) {
+        b->flags |= BUF_VALID;
+    }
+    brelse(b);
+}
+
+/*
+ * Queue a buffer transfer. The dirty flag is cleared when the write is
+ * queued, thus changes done while in flight are not lost.
+ */
+static int buf_start(struct buf *b, int write)
+{
+    bio_init(&b->bio, b->dev, b->blkno * (b->size / BLK_SECTOR_SIZE),
+             b->data, b->size, write);
+    b->bio.end = buf_io_end;
+    b->bio.priv = b;
+    b->flags |= BUF_BUSY;
+    if (write != 0)
+        b->flags &= ~BUF_DIRTY;
+    buf_hold(b);
+    if (blk_submit(&b->bio) < 0) {
+        b->flags &= ~BUF_BUSY;
+        if (write != 0)
+            b->flags |= BUF_DIRTY;
+        brelse(b);
+        return -1;
+    }
+    if (write != 0)
+        stats.writes++;
+    return 0;
+}
+
+/* Wait for the transfer in flight, if any */
+static int buf_wait(struct buf *b)
+{
+    if ((b->flags & BUF_BUSY) == 0)
+        return 0;
+    return blk_wait(&b->bio);
+}
+
+/* Get a buffer with a transfer in flight, NULL if none */
+static struct buf *buf_busy(void)
+{
+    int i;
+
+    for (i = 0; i < NBUF; i++) {
+        if ((bufs[i].flags & BUF_BUSY) != 0)
+            return &bufs[i];
+    }
+    return NULL;
+}
+
+/*
+ * Take the least recently used unreferenced clean buffer, unhashed.
+ * The dirty buffers found on the way are queued for write back (thus
+ * leave the LRU list until the transfer completes), the first one is
+ * returned via 'wb'. Never sleeps, returns NULL if all were dirty.
+ */
+static struct buf *buf_recycle(struct buf **wb)
+{
+    struct list_link *lnk;
+    struct buf *b;
+
+    *wb = NULL;
+    lnk = buf_lru.next;
+    while (lnk != &buf_lru) {
+        b = list_container(lnk, struct buf, lru);
+        lnk = lnk->next;
+        if ((b->flags & BUF_DIRTY) != 0) {
+            if (buf_start(b, 1) == 0) {
+                if (*wb == NULL)
+                    *wb = b;
+                continue;
+            }
+            kprintf("bcache: lost block %u (dev=%x)\n", b->blkno, b->dev);
+        }
+        list_delete(&b->lru);
+        if (b->hlink.pprev != NULL)
+            htable_delete(&b->hlink);
+        return b;
+    }
+    return NULL;
+}
+
+/*
+ * The buffer is keyed to the new block only after a clean one has been
+ * found without sleeping. While waiting for a write back another task
+ * may get the wanted block or the written buffer, thus the lookup is
+ * repeated.
+ */
+struct buf *bget(dev_t dev, uint32_t blkno, size_t size)
+{
+    struct buf *b, *wb;
+
+    if (size > BUF_SIZE_MAX)
+        return NULL;
+
+    for (;;) {
+        b = buf_lookup(dev, blkno, size);
+        if (b != NULL) {
+            if (b->ref == 0)
+                list_delete(&b->lru);
+            break;
+        }
+        if (list_empty(&buf_lru)) {
+            /* All referenced, wait for a transfer in flight if any */
+            wb = buf_busy();
+            if (wb == NULL)
+                return NULL;
+            buf_hold(wb);
+            buf_wait(wb);
+            brelse(wb);
+            continue;
+        }
+        b = buf_recycle(&wb);
+        if (b != NULL) {
+            b->dev = dev;
+            b->blkno = blkno;
+            b->size = size;
+            b->flags = 0;
+            htable_insert(buf_htable, &b->hlink, KEY(dev, blkno),
+                          BUF_HTABLE_BITS);
+            break;
+        }
+        /* All dirty, wait for the first write back */
+        buf_hold(wb);
+        if (buf_wait(wb) < 0) {
+            kprintf("bcache: lost block %u (dev=%x)\n", wb->blkno, wb->dev);
+            wb->flags &= ~BUF_DIRTY;
+        }
+        brelse(wb);
+    }
+    b->ref++;
+    buf_wait(b);
+    return b;
+}
+
+struct buf *bread(dev_t dev, uint32_t blkno, size_t size)
+{
+    struct buf *b;
+
+    b = bget(dev, blkno, size);
+    if (b == NULL)
+        return NULL;
+
+    if ((b->flags & BUF_VALID) != 0) {
+        stats.hits++;
+    } else {
+        stats.misses++;
+        if (buf_start(b, 0) < 0 || buf_wait(b) < 0 ||
+            (b->flags & BUF_VALID) == 0) {
+            brelse(b);
+            return NULL;
+        }
+    }
+    return b;
+}
+
+void bprefetch(dev_t dev, uint32_t blkno, size_t size)
+{
+    struct buf *b;
+
+    if (buf_lookup(dev, blkno, size) != NULL)
+        return;
+    b = bget(dev, blkno, size);
+    if (b == NULL)
+        return;
+    if (buf_start(b, 0) == 0)
+        stats.ra++;
+    brelse(b);
+}
+
+void bforget(dev_t dev, uint32_t blkno, size_t size)
+{
+    struct buf *b;
+
+    b = buf_lookup(dev, blkno, size);
+    if (b != NULL)
+        b->flags &= ~(BUF_VALID | BUF_DIRTY);
+}
+
+void brelse(struct buf *b)
+{
+    b->ref--;
+    if (b->ref == 0)
+        list_insert_before(&buf_lru, &b->lru);
+}
+
+
+/*
+ * Queue the writes of the dirty buffers of a device (or of all devices)
+ * and dispatch them. Optionally waits for their completion.
+ */
+static int buf_flush(dev_t dev, int all, int wait)
+{
+    int i;
+    int res = 0;
+    struct buf *b;
+
+    for (i = 0; i < NBUF; i++) {
+        b = &bufs[i];
+        if ((b->flags & (BUF_DIRTY | BUF_BUSY)) == BUF_DIRTY &&
+            (all != 0 || b->dev == dev) && buf_start(b, 1) < 0)
+            res = -1;
+    }
+    for (i = 0; i < NBUF; i++) {
+        b = &bufs[i];
+        if ((b->flags & BUF_BUSY) == 0 || (all == 0 && b->dev != dev))
+            continue;
+        if (wait == 0)
+            blk_unplug(b->dev);
+        else if (buf_wait(b) < 0)
+            res = -1;
+    }
+    return res;
+}
+
+int buf_sync(dev_t dev)
+{
+    return buf_flush(dev, 0, 1);
+}
+
+int buf_sync_all(void)
+{
+    return buf_flush(0, 1, 1);
+}
+
+/*
+ * Periodic write back pass. Re-arms itself.
+ */
+static void buf_writeback(void *data)
+{
+    /* Interrupt context, can't wait */
+    buf_flush(0, 1, 0);
+    timer_event_mod(&writeback_tm,
+                    timer_ticks + msecs_to_ticks(BUF_WRITEBACK_SECS * 1000));
+}
+
+
+void buf_stats_get(struct buf_stats *st)
+{
+    *st = stats;
+}
+
+void buf_dump(void)
+{
+    unsigned long total = stats.hits + stats.misses;
+
+    kprintf("bcache: hits=%u, misses=%u, rate=%u%%\n",
+            stats.hits, stats.misses,
+            (total != 0) ? (stats.hits * 100) / total : 0);
+    kprintf("bcache: writes=%u, readahead=%u\n", stats.writes, stats.ra);
+}
+
+
+void buf_init(void)
+{
+    int i;
+
+    htable_init(buf_htable, BUF_HTABLE_BITS);
+    list_init(&buf_lru);
+    memset(bufs, 0, sizeof(bufs));
+    for (i = 0; i < NBUF; i++) {
+        bufs[i].data = (char *)kmalloc(BUF_SIZE_MAX, 0);
+        if (bufs[i].data == NULL)
+            break;
+        list_insert_before(&buf_lru, &bufs[i].lru);
+    }
+
+    timer_event_init(&writeback_tm, buf_writeback, NULL,
+                     timer_ticks + msecs_to_ticks(BUF_WRITEBACK_SECS * 1000));
+    timer_event_add(&writeback_tm);
+}
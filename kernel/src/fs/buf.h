@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_FS_BUF_H_
+#define BEEOS_FS_BUF_H_
+
+#include "htable.h"
+#include "list.h"
+#include "driver/blkdev.h"
+#include <stdint.h>
+#include <sys/types.h>
+
+/** Max block size that can be cached */
+#define BUF_SIZE_MAX    4096
+
+/** Buffer data is valid (read from the device or filled by the user) */
+#define BUF_VALID       0x01
+/** Buffer data has been modified and must be written back */
+#define BUF_DIRTY       0x02
+/** Buffer has a device transfer in flight */
+#define BUF_BUSY        0x04
+
+/** Periodic write back interval (seconds) */
+#define BUF_WRITEBACK_SECS  5
+
+/** Block buffer */
+struct buf {
+    dev_t               dev;    /**< Device */
+    uint32_t            blkno;  /**< Block number on the device */
+    size_t              size;   /**< Block size */
+    int                 ref;    /**< Reference counter */
+    int                 flags;  /**< Buffer status flags */
+    char                *data;  /**< Block data */
+    struct htable_link  hlink;  /**< Link within the hash table */
+    struct list_link    lru;    /**< Link within the LRU list (if unused) */
+    struct bio          bio;    /**< Device transfer descriptor */
+};
+
+/** Buffer cache statistics */
+struct buf_stats {
+    unsigned long   hits;   /**< Requests satisfied by the cache */
+    unsigned long   misses; /**< Requests that required a device read */
+    unsigned long   writes; /**< Dirty blocks written back */
+    unsigned long   ra;     /**< Blocks read ahead */
+};
+
+/**
+ * Get a referenced buffer holding the content of a device block.
+ * The block is read from the device only if not already cached.
+ *
+ * @param dev   Device.
+ * @param blkno Block number, in units of 'size'.
+ * @param size  Block size, not greater than BUF_SIZE_MAX.
+ * @return      Buffer pointer or NULL on error (or if all buffers are busy).
+ */
+struct buf *bread(dev_t dev, uint32_t blkno, size_t size);
+
+/**
+ * Get a referenced buffer for a device block without reading it.
+ * If the block is not cached the buffer content is undefined, thus this
+ * is meant to be used when the whole block is going to be overwritten.
+ * Waits for the completion of any transfer in flight for the block.
+ *
+ * @param dev   Device.
+ * @param blkno Block number, in units of 'size'.
+ * @param size  Block size, not greater than BUF_SIZE_MAX.
+ * @return      Buffer pointer or NULL if all buffers are busy.
+ */
+struct buf *bget(dev_t dev, uint32_t blkno, size_t size);
+
+/**
+ * Start loading a device block in the cache, if not already there,
+ * without holding a reference. Used to read ahead blocks that are likely
+ * to be requested soon. The read is queued and may be merged with
+ * adjacent ones, bread waits for its completion.
+ *
+ * @param dev   Device.
+ * @param blkno Block number, in units of 'size'.
+ * @param size  Block size, not greater than BUF_SIZE_MAX.
+ */
+void bprefetch(dev_t dev, uint32_t blkno, size_t size);
+
+/**
+ * Drop a cached device block, discarding any pending modification.
+ * Used when the block is released by the file system, thus a stale copy
+ * is never written over the new content.
+ *
+ * @param dev   Device.
+ * @param blkno Block number, in units of 'size'.
+ * @param size  Block size.
+ */
+void bforget(dev_t dev, uint32_t blkno, size_t size);
+
+/**
+ * Mark a buffer as modified.
+ * The content is written to the device by the periodic write back pass,
+ * on explicit sync or when the buffer is recycled.
+ * Should be called after the buffer data has been updated.
+ *
+ * @param b     Buffer pointer.
+ */
+static inline void bdirty(struct buf *b)
+{
+    b->flags |= (BUF_VALID | BUF_DIRTY);
+}
+
+/**
+ * Release a buffer obtained via bread or bget.
+ * When no longer referenced the buffer becomes a candidate for reuse.
+ *
+ * @param b     Buffer pointer.
+ */
+void brelse(struct buf *b);
+
+/**
+ * Write back the dirty buffers of a device.
+ * Writes are queued together, thus adjacent blocks are merged.
+ *
+ * @param dev   Device.
+ * @return      0 on success, -1 if some block write failed.
+ */
+int buf_sync(dev_t dev);
+
+/**
+ * Write back all the dirty buffers.
+ *
+ * @return      0 on success, -1 if some block write failed.
+ */
+int buf_sync_all(void);
+
+/**
+ * Get a copy of the buffer cache statistics.
+ *
+ * @param st    Statistics destination.
+ */
+void buf_stats_get(struct buf_stats *st);
+
+/**
+ * Buffer cache dump function.
+ */
+void buf_dump(void);
+
+/**
+ * Initialize the buffer cache.
+ */
+void buf_init(void);
+
+#endif /* BEEOS_FS_BUF_H_ */
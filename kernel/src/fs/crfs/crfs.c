@@ -0,0 +1,617 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Compressed read-only file system.
+ *
+ * Files data is split in blocks compressed independently, thus only the
+ * blocks actually touched are decompressed. The most recently used
+ * decompressed blocks are kept in a small per file system cache.
+ */
+
+#include "crfs.h"
+#include "crfs_fs.h"
+#include "fs/vfs.h"
+#include "fs/buf.h"
+#include "driver/blkdev.h"
+#include "kmalloc.h"
+#include "dev.h"
+#include "util.h"
+#include <errno.h>
+#include <string.h>
+
+/* Decompressed blocks cache entries */
+#define CRFS_CACHE_LEN      16
+
+struct crfs_cache_entry {
+    uint32_t    off;    /* compressed block offset (0 = unused) */
+    uint32_t    stamp;  /* last access time stamp */
+    char        *data;  /* decompressed data */
+};
+
+struct crfs_super_block {
+    struct super_block      base;
+    uint32_t                size;       /* image size */
+    uint32_t                ninodes;    /* inode table entries */
+    uint32_t                itable;     /* inode table offset */
+    const struct dev_ops    *bdev;      /* block device driver */
+    int                     dax;        /* memory backed device */
+    uint32_t                stamp;      /* cache access counter */
+    struct crfs_cache_entry cache[CRFS_CACHE_LEN];
+};
+
+struct crfs_inode {
+    struct inode    base;
+    uint32_t        offset;     /* data offset within the image */
+};
+
+#define CRFS_SB(sb)     ((struct crfs_super_block *)(sb))
+
+static const struct inode_ops crfs_inode_ops;
+
+
+/******************************************************************************
+ *  Image access
+ ******************************************************************************/
+
+/*
+ * Copy the image range [off, off + n).
+ * Memory backed devices are accessed in place, others via the buffer cache.
+ */
+static int crfs_raw_read(const struct crfs_super_block *sb, void *buf,
+                         size_t n, uint32_t off)
+{
+    struct buf *b;
+    const char *ptr;
+    size_t boff, len;
+
+    if (off > sb->size || n > sb->size - off)
+        return -EIO;
+    if (sb->dax != 0) {
+        ptr = sb->bdev->direct(sb->base.dev, n, off);
+        if (ptr == NULL)
+            return -EIO;
+        memcpy(buf, ptr, n);
+        return 0;
+    }
+    while (n > 0) {
+        b = bread(sb->base.dev, off / CRFS_BLOCK_SIZE, CRFS_BLOCK_SIZE);
+        if (b == NULL)
+            return -EIO;
+        boff = off % CRFS_BLOCK_SIZE;
+        len = MIN(n, CRFS_BLOCK_SIZE - boff);
+        memcpy(buf, b->data + boff, len);
+        brelse(b);
+        n -= len;
+        off += len;
+        buf = (char *)buf + len;
+    }
+    return 0;
+}
+
+/*
+ * LZ4 block format decompression.
+ * Returns the decompressed length or -1 if the input is malformed or
+ * doesn't fit in the destination.
+ */
+static int lz4_decompress(const uint8_t *src, size_t slen,
+                          uint8_t *dst, size_t dlen)
+{
+    const uint8_t *send = src + slen;
+    uint8_t *d = dst;
+    uint8_t *dend = dst + dlen;
+    const uint8_t *match;
+    unsigned int token;
+    size_t len, off;
+    uint8_t b;
+
+    while (src < send) {
+        token = *src++;
+        /* Literals */
+        len = token >> 4;
+        if (len == 15) {
+            do {
+                if (src == send)
+                    return -1;
+                b = *src++;
+                len += b;
+            } while (b == 255);
+        }
+        if (len > (size_t)(send - src) || len > (size_t)(dend - d))
+            return -1;
+        memcpy(d, src, len);
+        d += len;
+        src += len;
+        if (src == send)
+            break;  /* The last sequence has literals only */
+
+        /* Match */
+        if (send - src < 2)
+            return -1;
+        off = src[0] | (src[1] << 8);
+        src += 2;
+        if (off == 0 || off > (size_t)(d - dst))
+            return -1;
+        len = token & 15;
+        if (len == 15) {
+            do {
+                if (src == send)
+                    return -1;
+                b = *src++;
+                len += b;
+            } while (b == 255);
+        }
+        len += 4;
+        if (len > (size_t)(dend - d))
+            return -1;
+        /* Byte by byte, the ranges may overlap */
+        match = d - off;
+        while (len-- > 0)
+            *d++ = *match++;
+    }
+    return d - dst;
+}
+
+/*
+ * Get the image location of a file data block.
+ */
+static int crfs_block_loc(const struct crfs_inode *ci, uint32_t blk,
+                          uint32_t *off, uint32_t *len)
+{
+    const struct crfs_super_block *sb = CRFS_SB(ci->base.sb);
+    uint32_t tab[2];
+
+    if (crfs_raw_read(sb, tab, sizeof(tab),
+                      ci->offset + blk * sizeof(uint32_t)) < 0)
+        return -EIO;
+    if (tab[1] < tab[0] || tab[1] - tab[0] > CRFS_BLOCK_SIZE)
+        return -EIO;
+    *off = tab[0];
+    *len = tab[1] - tab[0];
+    return 0;
+}
+
+/*
+ * Get a decompressed block from the cache, on miss the least recently
+ * used entry is recycled.
+ * The returned data is valid until the caller sleeps.
+ */
+static const char *crfs_block_get(struct crfs_super_block *sb, uint32_t off,
+                                  uint32_t zlen, uint32_t len)
+{
+    struct crfs_cache_entry *ent;
+    const uint8_t *src;
+    uint8_t *zbuf = NULL;
+    int i, n;
+
+    for (i = 0; i < CRFS_CACHE_LEN; i++) {
+        if (sb->cache[i].off == off) {
+            sb->cache[i].stamp = ++sb->stamp;
+            return sb->cache[i].data;
+        }
+    }
+
+    if (sb->dax != 0) {
+        src = sb->bdev->direct(sb->base.dev, zlen, off);
+        if (src == NULL)
+            return NULL;
+    } else {
+        /* Private staging buffer, the read may sleep */
+        zbuf = kmalloc(CRFS_BLOCK_SIZE, 0);
+        if (zbuf == NULL)
+            return NULL;
+        if (crfs_raw_read(sb, zbuf, zlen, off) < 0) {
+            kfree(zbuf, CRFS_BLOCK_SIZE);
+            return NULL;
+        }
+        src = zbuf;
+    }
+
+    /* No sleep from here, the victim is chosen after the read */
+    ent = &sb->cache[0];
+    for (i = 1; i < CRFS_CACHE_LEN && ent->off != 0; i++) {
+        if (sb->cache[i].off == 0 || sb->cache[i].stamp < ent->stamp)
+            ent = &sb->cache[i];
+    }
+    if (ent->data == NULL)
+        ent->data = kmalloc(CRFS_BLOCK_SIZE, 0);
+    ent->off = 0;
+    n = (ent->data != NULL) ?
+        lz4_decompress(src, zlen, (uint8_t *)ent->data, len) : -1;
+    if (zbuf != NULL)
+        kfree(zbuf, CRFS_BLOCK_SIZE);
+    if (n != (int)len)
+        return NULL;
+    ent->off = off;
+    ent->stamp = ++sb->stamp;
+    return ent->data;
+}
+
+
+/******************************************************************************
+ *  Inode operations
+ ******************************************************************************/
+
+static ssize_t crfs_read(struct crfs_inode *ci, void *buf,
+                         size_t count, size_t off)
+{
+    struct crfs_super_block *sb;
+    const char *data;
+    uint32_t blk, zoff, zlen, len;
+    size_t left, boff, n;
+
+    /* Device special files data are not stored in the file system */
+    if (S_ISCHR(ci->base.mode) || S_ISBLK(ci->base.mode))
+        return dev_read(ci->base.mode & S_IFMT, ci->base.rdev,
+                        buf, count, off);
+
+    sb = CRFS_SB(ci->base.sb);
+    if (ci->base.size < off)
+        return 0; /* EOF */
+    if (ci->base.size < off + count)
+        count = ci->base.size - off;
+
+    left = count;
+    while (left > 0) {
+        blk = off / CRFS_BLOCK_SIZE;
+        boff = off % CRFS_BLOCK_SIZE;
+        n = MIN(left, CRFS_BLOCK_SIZE - boff);
+        len = MIN(CRFS_BLOCK_SIZE, ci->base.size - blk * CRFS_BLOCK_SIZE);
+        if (crfs_block_loc(ci, blk, &zoff, &zlen) < 0)
+            break;
+        if (zlen == len) {
+            /* Stored uncompressed */
+            if (crfs_raw_read(sb, buf, n, zoff + boff) < 0)
+                break;
+        } else {
+            data = crfs_block_get(sb, zoff, zlen, len);
+            if (data == NULL)
+                break;
+            memcpy(buf, data + boff, n);
+        }
+        left -= n;
+        off += n;
+        buf = (char *)buf + n;
+    }
+    return count - left;
+}
+
+static ssize_t crfs_write(struct crfs_inode *ci, const void *buf,
+                          size_t count, size_t off)
+{
+    if (S_ISCHR(ci->base.mode) || S_ISBLK(ci->base.mode))
+        return dev_write(ci->base.mode & S_IFMT, ci->base.rdev,
+                         buf, count, off);
+    return -EROFS;
+}
+
+static int crfs_mknod(struct inode *dir, const char *name,
+                      mode_t mode, dev_t dev)
+{
+    return -EROFS;
+}
+
+static int crfs_unlink(struct inode *dir, const char *name)
+{
+    return -EROFS;
+}
+
+static int crfs_truncate(struct inode *inod, size_t size)
+{
+    return -EROFS;
+}
+
+static void crfs_readahead(struct crfs_inode *ci, size_t off, size_t count)
+{
+    const struct crfs_super_block *sb = CRFS_SB(ci->base.sb);
+    uint32_t first, last, zoff, zlen, end;
+
+    /* Pointless if the image is accessed in place */
+    if (sb->dax != 0 || !S_ISREG(ci->base.mode) ||
+        off >= ci->base.size || count == 0)
+        return;
+    count = MIN(count, ci->base.size - off);
+    if (crfs_block_loc(ci, (off + count - 1) / CRFS_BLOCK_SIZE,
+                       &zoff, &zlen) < 0)
+        return;
+    end = zoff + zlen;
+    if (crfs_block_loc(ci, off / CRFS_BLOCK_SIZE, &zoff, &zlen) < 0)
+        return;
+    /* The compressed blocks of a file are stored contiguously */
+    if (end <= zoff)
+        return;
+    last = (end - 1) / CRFS_BLOCK_SIZE;
+    for (first = zoff / CRFS_BLOCK_SIZE; first <= last; first++)
+        bprefetch(sb->base.dev, first, CRFS_BLOCK_SIZE);
+    /* Dispatch the batch, adjacent blocks are merged */
+    blk_unplug(sb->base.dev);
+}
+
+static void *crfs_direct(struct crfs_inode *ci, size_t off, size_t count)
+{
+    const struct crfs_super_block *sb = CRFS_SB(ci->base.sb);
+    uint32_t blk, zoff, zlen, len;
+
+    /* Only within a single block stored uncompressed */
+    if (sb->dax == 0 || count == 0 || off + count > ci->base.size)
+        return NULL;
+    blk = off / CRFS_BLOCK_SIZE;
+    if ((off + count - 1) / CRFS_BLOCK_SIZE != blk)
+        return NULL;
+    len = MIN(CRFS_BLOCK_SIZE, ci->base.size - blk * CRFS_BLOCK_SIZE);
+    if (crfs_block_loc(ci, blk, &zoff, &zlen) < 0 || zlen != len)
+        return NULL;
+    return sb->bdev->direct(sb->base.dev, count,
+                            zoff + off % CRFS_BLOCK_SIZE);
+}
+
+
+/*
+ * Directory entry visitor, returns non zero to stop the iteration.
+ */
+typedef int (* crfs_dirent_visit_t)(const struct crfs_disk_dirent *de,
+                                    void *ctx);
+
+/*
+ * Visit the entries of a directory starting from the byte offset '*pos'.
+ * On return '*pos' is the offset of the entry that stopped the iteration
+ * (not consumed) or the directory size.
+ * Returns the value that stopped the iteration, 0 if all the entries have
+ * been visited or -EIO on error.
+ */
+static int crfs_dir_foreach(const struct crfs_inode *dir, size_t *pos,
+                            crfs_dirent_visit_t visit, void *ctx)
+{
+    const struct crfs_super_block *sb = CRFS_SB(dir->base.sb);
+    struct crfs_disk_dirent de;
+    int ret = 0;
+
+    while (*pos + CRFS_DIRENT_HDR_SIZE <= dir->base.size) {
+        if (crfs_raw_read(sb, &de, CRFS_DIRENT_HDR_SIZE,
+                          dir->offset + *pos) < 0)
+            return -EIO;
+        if (*pos + CRFS_DIRENT_HDR_SIZE + de.name_len > dir->base.size ||
+            crfs_raw_read(sb, de.name, de.name_len,
+                          dir->offset + *pos + CRFS_DIRENT_HDR_SIZE) < 0)
+            return -EIO;
+        if ((ret = visit(&de, ctx)) != 0)
+            break;
+        *pos += CRFS_DIRENT_HDR_SIZE + de.name_len;
+    }
+    if (ret == 0)
+        *pos = dir->base.size;
+    return ret;
+}
+
+struct dir_match {
+    const char  *name;
+    size_t      len;
+    ino_t       ino;
+};
+
+static int dir_match(const struct crfs_disk_dirent *de, void *ctx)
+{
+    struct dir_match *m = (struct dir_match *)ctx;
+
+    if (m->len == (size_t)de->name_len &&
+        memcmp(m->name, de->name, de->name_len) == 0) {
+        m->ino = de->ino;
+        return 1;
+    }
+    return 0;
+}
+
+static struct inode *crfs_lookup(struct inode *dir, const char *name)
+{
+    struct dir_match m;
+    struct inode *inod = NULL;
+    size_t pos = 0;
+
+    m.name = name;
+    m.len = strlen(name);
+    m.ino = 0;
+    crfs_dir_foreach((struct crfs_inode *)dir, &pos, dir_match, &m);
+    if (m.ino != 0) {
+        inod = iget(dir->sb, m.ino);
+        if (inod != NULL)
+            inod->ref--; /* iget incremented the counter... release it */
+    }
+    return inod;
+}
+
+static const struct inode_ops crfs_inode_ops = {
+    .read      = (inode_read_t)crfs_read,
+    .write     = (inode_write_t)crfs_write,
+    .mknod     = crfs_mknod,
+    .lookup    = crfs_lookup,
+    .unlink    = crfs_unlink,
+    .truncate  = crfs_truncate,
+    .readahead = (inode_readahead_t)crfs_readahead,
+    .direct    = (inode_direct_t)crfs_direct,
+};
+
+
+/******************************************************************************
+ *  Dentry operations
+ ******************************************************************************/
+
+struct dir_fill {
+    unsigned int    skip;   /* entries to skip */
+    unsigned int    count;  /* entries to fill */
+    unsigned int    n;      /* entries filled */
+    struct dirent   *dents;
+};
+
+static int dir_fill(const struct crfs_disk_dirent *de, void *ctx)
+{
+    struct dir_fill *f = (struct dir_fill *)ctx;
+    struct dirent *dent;
+    size_t n;
+
+    if (f->skip != 0) {
+        f->skip--;
+        return 0;
+    }
+    if (f->n == f->count)
+        return 1;   /* Full, the entry is left for the next call */
+    dent = &f->dents[f->n++];
+    n = MIN(de->name_len, NAME_MAX);
+    memcpy(dent->d_name, de->name, n);
+    dent->d_name[n] = '\0';
+    dent->d_ino = de->ino;
+    return 0;
+}
+
+static int crfs_dentry_readdir(struct dentry *dir, unsigned int i,
+                               struct dirent *dent)
+{
+    struct dir_fill f;
+    size_t pos = 0;
+    int ret;
+
+    f.skip = i;
+    f.count = 1;
+    f.n = 0;
+    f.dents = dent;
+    ret = crfs_dir_foreach((struct crfs_inode *)dir->inod, &pos,
+                           dir_fill, &f);
+    if (ret >= 0)
+        ret = (f.n == 1) ? 0 : -1;
+    return ret;
+}
+
+static int crfs_dentry_getdents(struct dentry *dir, size_t *pos,
+                                struct dirent *dents, unsigned int count)
+{
+    struct dir_fill f;
+    int ret;
+
+    f.skip = 0;
+    f.count = count;
+    f.n = 0;
+    f.dents = dents;
+    ret = crfs_dir_foreach((struct crfs_inode *)dir->inod, pos,
+                           dir_fill, &f);
+    if (ret >= 0)
+        ret = f.n;
+    return ret;
+}
+
+static const struct dentry_ops crfs_dentry_ops = {
+    .readdir  = crfs_dentry_readdir,
+    .getdents = crfs_dentry_getdents,
+};
+
+
+/******************************************************************************
+ *  Superblock operations
+ ******************************************************************************/
+
+static struct inode *crfs_super_inode_alloc(struct super_block *sb)
+{
+    struct inode *inod;
+
+    inod = (struct inode *)kmalloc(sizeof(struct crfs_inode), 0);
+    if (inod != NULL)
+        memset(inod, 0, sizeof(struct crfs_inode));
+    return inod;
+}
+
+static void crfs_super_inode_free(struct inode *inod)
+{
+    kfree(inod, sizeof(struct crfs_inode));
+}
+
+static int crfs_super_inode_read(struct inode *inod)
+{
+    const struct crfs_super_block *sb = CRFS_SB(inod->sb);
+    struct crfs_disk_inode disk_inod;
+
+    if (inod->ino == 0 || inod->ino > sb->ninodes)
+        return -1;
+    if (crfs_raw_read(sb, &disk_inod, sizeof(disk_inod), sb->itable +
+                      (inod->ino - 1) * sizeof(disk_inod)) < 0)
+        return -1;
+
+    inod->ops = &crfs_inode_ops;
+    inod->mode = disk_inod.mode;
+    inod->uid = disk_inod.uid;
+    inod->gid = disk_inod.gid;
+    inod->size = disk_inod.size;
+    inod->atime = disk_inod.mtime;
+    inod->mtime = disk_inod.mtime;
+    inod->ctime = disk_inod.mtime;
+    if (S_ISCHR(inod->mode) || S_ISBLK(inod->mode)) {
+        inod->rdev = disk_inod.offset;
+        inod->size = 0;
+    } else {
+        ((struct crfs_inode *)inod)->offset = disk_inod.offset;
+    }
+    return 0;
+}
+
+static const struct super_ops crfs_sb_ops = {
+    .inode_alloc = crfs_super_inode_alloc,
+    .inode_free  = crfs_super_inode_free,
+    .inode_read  = crfs_super_inode_read,
+};
+
+
+struct super_block *crfs_super_create(dev_t dev)
+{
+    struct crfs_super_block *sb;
+    struct crfs_disk_super dsb;
+    struct inode *iroot;
+    struct dentry *droot;
+    struct buf *b;
+
+    b = bread(dev, 0, CRFS_BLOCK_SIZE);
+    if (b == NULL)
+        return NULL;
+    memcpy(&dsb, b->data, sizeof(dsb));
+    brelse(b);
+
+    if (dsb.magic != CRFS_MAGIC || dsb.block_size != CRFS_BLOCK_SIZE ||
+        dsb.ninodes == 0 || dsb.itable < sizeof(dsb) ||
+        dsb.itable > dsb.size ||
+        dsb.ninodes > (dsb.size - dsb.itable) /
+                      sizeof(struct crfs_disk_inode))
+        return NULL;
+
+    sb = (struct crfs_super_block *)kmalloc(sizeof(*sb), 0);
+    if (sb == NULL)
+        return NULL;
+    memset(sb, 0, sizeof(*sb));
+    sb->base.dev = dev;
+    sb->size = dsb.size;
+    sb->ninodes = dsb.ninodes;
+    sb->itable = dsb.itable;
+    /* The super block was read, thus the driver is there */
+    sb->bdev = dev_ops_get(S_IFBLK, dev);
+    sb->dax = (sb->bdev->direct != NULL &&
+               sb->bdev->direct(dev, sb->size, 0) != NULL);
+
+    droot = dentry_create("/", NULL, &crfs_dentry_ops);
+    super_init(&sb->base, dev, droot, &crfs_sb_ops);
+
+    iroot = inode_create(&sb->base, CRFS_ROOT_INO, S_IFDIR, &crfs_inode_ops);
+    droot->inod = idup(iroot);
+
+    return &sb->base;
+}
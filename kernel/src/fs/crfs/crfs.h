@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_FS_CRFS_H_
+#define BEEOS_FS_CRFS_H_
+
+#include "fs/vfs.h"
+
+/**
+ * Create a compressed read-only file system super block.
+ *
+ * @param dev   Block device holding the image.
+ * @return      Super block or NULL if the device doesn't hold a valid image.
+ */
+struct super_block *crfs_super_create(dev_t dev);
+
+#endif /* BEEOS_FS_CRFS_H_ */
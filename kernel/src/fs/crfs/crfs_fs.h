@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Compressed read-only file system on-disk format.
+ * Shared by the kernel driver and the host image builder (mkinitrd).
+ *
+ * Layout (all fields little endian):
+ *   - super block at offset 0;
+ *   - inode table, 'ninodes' fixed size records (inode 'n' is the
+ *     record 'n - 1');
+ *   - data.
+ *
+ * Regular files data is split in CRFS_BLOCK_SIZE blocks, each compressed
+ * independently (LZ4 block format). The inode 'offset' points to a table
+ * of 'nblocks + 1' absolute offsets: the block 'i' is stored in the range
+ * [tab[i], tab[i + 1]). A block whose stored length equals its original
+ * length is not compressed.
+ *
+ * Directories data is a plain sequence of variable length entries.
+ * Device special files keep the device number in the 'offset' field.
+ */
+
+#ifndef BEEOS_FS_CRFS_FS_H_
+#define BEEOS_FS_CRFS_FS_H_
+
+#include <stdint.h>
+
+#define CRFS_MAGIC          0x53465243  /* "CRFS" */
+#define CRFS_BLOCK_SIZE     4096
+#define CRFS_ROOT_INO       1
+
+struct crfs_disk_super {
+    uint32_t magic;         /* CRFS_MAGIC */
+    uint32_t size;          /* image size in bytes */
+    uint32_t block_size;    /* uncompressed data block size */
+    uint32_t ninodes;       /* inode table entries */
+    uint32_t itable;        /* inode table offset */
+    uint32_t raw_size;      /* total uncompressed files size */
+};
+
+struct crfs_disk_inode {
+    uint16_t mode;
+    uint16_t uid;
+    uint16_t gid;
+    uint16_t pad;
+    uint32_t size;          /* file size (uncompressed) */
+    uint32_t offset;        /* data offset or device number */
+    uint32_t mtime;
+};
+
+struct crfs_disk_dirent {
+    uint32_t ino;
+    uint8_t  name_len;
+    char     name[255];     /* not null terminated */
+} __attribute__((packed));
+
+#define CRFS_DIRENT_HDR_SIZE    5
+
+#endif /* BEEOS_FS_CRFS_FS_H_ */
@@ -0,0 +1,2 @@
+
+local_sources := crfs.c
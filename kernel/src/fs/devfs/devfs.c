@@ -19,20 +19,19 @@
 
 #include "devfs.h"
 #include "dev.h"
-#include "driver/tty.h"
-#include "driver/ramdisk.h"
-#include "driver/random.h"
 #include "kmalloc.h"
 #include "kprintf.h"
 #include "list.h"
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
 
 
 
 struct devfs_inode {
     struct inode        base;
     struct list_link    link;
+    char                name[NAME_MAX];
 };
 
 static struct list_link devfs_nodes;
@@ -45,151 +44,26 @@ static ino_t devfs_ino = 0;
 static ssize_t devfs_inode_read(struct inode *inod, void *buf,
                                 size_t count, size_t off)
 {
-    ssize_t n;
-
-    switch (inod->rdev) {
-    case DEV_TTY:
-    case DEV_TTY0:
-    case DEV_TTY1:
-    case DEV_TTY2:
-    case DEV_TTY3:
-    case DEV_TTY4 :
-    case DEV_CONSOLE:
-        n = tty_read(inod->rdev, buf, count);
-        break;
-    case DEV_ZERO:
-        memset(buf, 0, count);
-        n = (ssize_t)count;
-        break;
-    case DEV_NULL:
-        n = (ssize_t)count;
-        break;
-    case DEV_INITRD:
-        n = ramdisk_read(buf, count, off);
-        break;
-    case DEV_MEM:
-        n = -1;
-        break;
-    case DEV_KMEM:
-        n = -1;
-        break;
-    case DEV_RANDOM:
-    case DEV_URANDOM:
-        n = random_read(buf, count);
-        break;
-    default:
-        n = -ENODEV;
-        break;
-    }
-    return n;
+    return dev_read(inod->mode & S_IFMT, inod->rdev, buf, count, off);
 }
 
 
 static ssize_t devfs_inode_write(struct inode *inod, const void *buf,
                                  size_t count, size_t off)
 {
-    ssize_t n;
-
-    switch (inod->rdev) {
-    case DEV_TTY:
-    case DEV_TTY0:
-    case DEV_TTY1:
-    case DEV_TTY2:
-    case DEV_TTY3:
-    case DEV_TTY4 :
-    case DEV_CONSOLE:
-        n = tty_write(inod->rdev, buf, count);
-        break;
-    case DEV_ZERO:
-    case DEV_NULL:
-        n = (ssize_t)count;
-        break;
-    case DEV_INITRD:
-        n = ramdisk_write(buf, count, off);
-        break;
-    case DEV_MEM:
-        n = -1;
-        break;
-    case DEV_KMEM:
-        n = -1;
-        break;
-    case DEV_RANDOM:
-    case DEV_URANDOM:
-        n = -1;
-        break;
-    default:
-        n = -ENODEV;
-        break;
-    }
-    return n;
+    return dev_write(inod->mode & S_IFMT, inod->rdev, buf, count, off);
 }
 
 
-#define NDEVS 13
-
-static struct {
-    const char *name;
-    dev_t       dev;
-} dev_name_map[NDEVS] = {
-    { "zero",    DEV_ZERO },
-    { "tty0",    DEV_TTY0 },
-    { "tty1",    DEV_TTY1 },
-    { "tty2",    DEV_TTY2 },
-    { "tty3",    DEV_TTY3 },
-    { "tty4",    DEV_TTY4 },
-    { "tty",     DEV_TTY  },
-    { "console", DEV_CONSOLE },
-    { "initrd",  DEV_INITRD },
-    { "mem",     DEV_MEM },
-    { "kmem",    DEV_KMEM },
-    { "random",  DEV_RANDOM },
-    { "urandom", DEV_URANDOM },
-};
-
-static dev_t name_to_dev(const char *name)
-{
-    int i;
-    dev_t dev = 0xFFFF;
-
-    for (i = 0; i < NDEVS; i++) {
-        if (strcmp(dev_name_map[i].name, name) == 0) {
-            dev = dev_name_map[i].dev;
-            break;
-        }
-    }
-    return dev;
-}
-
-static int devfs_mknod(struct inode *idir, mode_t mode, dev_t dev)
-{
-    struct inode *inod;
-    int res = -1;
-
-    inod = inode_create(idir->sb, ++devfs_ino, mode, idir->ops);
-    if (inod != NULL) {
-        if (S_ISBLK(mode) || S_ISCHR(mode))
-            inod->rdev = dev;
-        res = 0;
-    }
-    return res;
-}
-
 static struct inode *devfs_lookup(struct inode *dir, const char *name)
 {
     struct devfs_inode *curr;
     struct inode *inod = NULL;
     struct list_link *curr_link = devfs_nodes.next;
-    dev_t dev;
 
-#if 0
-    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
-        return dir;
-#endif
-
-    dev = name_to_dev(name);
     while (curr_link != &devfs_nodes) {
         curr = list_container(curr_link, struct devfs_inode, link);
-        if (curr->base.rdev == dev) {
+        if (strcmp(curr->name, name) == 0) {
             inod = &curr->base;
             break;
         }
@@ -198,6 +72,25 @@ static struct inode *devfs_lookup(struct inode *dir, const char *name)
     return inod;
 }
 
+/* The driver is bound at access time via the device switch */
+static int devfs_mknod(struct inode *idir, const char *name, mode_t mode,
+                       dev_t dev)
+{
+    struct inode *inod;
+
+    if (strlen(name) >= NAME_MAX)
+        return -ENAMETOOLONG;
+    if (devfs_lookup(idir, name) != NULL)
+        return -EEXIST;
+    inod = inode_create(idir->sb, ++devfs_ino, mode, idir->ops);
+    if (inod == NULL)
+        return -ENOMEM;
+    if (S_ISBLK(mode) || S_ISCHR(mode))
+        inod->rdev = dev;
+    strcpy(((struct devfs_inode *)inod)->name, name);
+    return 0;
+}
+
 
 static const struct inode_ops devfs_inode_ops = {
     .read    = devfs_inode_read,
@@ -217,6 +110,7 @@ static struct devfs_inode *devfs_sb_inode_alloc(struct super_block *sb)
         return NULL;
     list_init(&inod->link);
     list_insert_before(&devfs_nodes, &inod->link);
+    inod->name[0] = '\0';
     return inod;
 }
 
@@ -233,43 +127,6 @@ static const struct super_ops devfs_sb_ops = {
 
 
 
-static struct inode *dev_to_inode(dev_t dev)
-{
-    struct devfs_inode *inod = NULL;
-    struct list_link *curr = devfs_nodes.next;
-
-    while (curr != &devfs_nodes) {
-        inod = list_container(curr, struct devfs_inode, link);
-        if (inod->base.rdev == dev)
-            break;
-        curr = curr->next;
-    }
-    return (struct inode *)inod;
-}
-
-ssize_t devfs_read(dev_t dev, void *buf, size_t size, size_t off)
-{
-    ssize_t n = -1;
-    struct inode *inod;
-
-    inod = dev_to_inode(dev);
-    if (inod != NULL)
-        n = devfs_inode_read(inod, buf, size, off);
-    return n;
-}
-
-ssize_t devfs_write(dev_t dev, const void *buf, size_t size, size_t off)
-{
-    ssize_t n = -1;
-    struct inode *inod;
-
-    inod = dev_to_inode(dev);
-    if (inod != NULL)
-        n = devfs_inode_write(inod, buf, size, off);
-    return n;
-}
-
-
 static int devfs_dentry_readdir(struct dentry *dir, unsigned int i,
                                 struct dirent *dent)
 {
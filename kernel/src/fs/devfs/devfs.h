@@ -25,10 +25,6 @@
 
 struct super_block *devfs_super_create(dev_t dev);
 
-ssize_t devfs_read(dev_t dev, void *buf, size_t size, size_t off);
-
-ssize_t devfs_write(dev_t dev, const void *buf, size_t size, size_t off);
-
 struct super_block *devfs_sb_get(void);
 
 
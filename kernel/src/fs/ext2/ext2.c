@@ -19,11 +19,13 @@
 
 #include "ext2.h"
 #include "fs/vfs.h"
-#include "fs/devfs/devfs.h"
+#include "fs/buf.h"
+#include "driver/blkdev.h"
 #include "kmalloc.h"
+#include "proc.h"
 #include "dev.h"
 #include "util.h"
-#include "panic.h"
+#include <stddef.h>
 #include <errno.h>
 #include <string.h>
 #include <stdint.h>
@@ -35,6 +37,24 @@
 #define EXT2_BLK_DBL        13  /* Double indirect blocks index */
 #define EXT2_BLK_TPL        14  /* Triple indirect blocks index */
 
+#define EXT2_GOOD_OLD_REV           0   /* Original format */
+#define EXT2_DYNAMIC_REV            1   /* Variable inode sizes */
+
+#define EXT2_GOOD_OLD_INODE_SIZE    128
+#define EXT2_GOOD_OLD_FIRST_INO     11
+
+/* Directory entries file type (used if the feature is present) */
+#define EXT2_FEATURE_INCOMPAT_FILETYPE  0x0002
+
+#define EXT2_FT_UNKNOWN     0
+#define EXT2_FT_REG_FILE    1
+#define EXT2_FT_DIR         2
+#define EXT2_FT_CHRDEV      3
+#define EXT2_FT_BLKDEV      4
+#define EXT2_FT_FIFO        5
+#define EXT2_FT_SOCK        6
+#define EXT2_FT_SYMLINK     7
+
 /*
  * Unused macros reserved for future extensions or completeness.
  */
@@ -71,7 +91,16 @@ struct ext2_disk_super_block {
     uint32_t checkinterval;     /* maximum time between checks */
     uint32_t creator_os;        /* indicator of which OS created */
     uint32_t rev_level;         /* EXT2 revision level */
-    uint32_t reserved[236];     /* padding to 1024 bytesOS */
+    uint16_t def_resuid;        /* default uid for reserved blocks */
+    uint16_t def_resgid;        /* default gid for reserved blocks */
+    /* Revision 1 (EXT2_DYNAMIC_REV) fields */
+    uint32_t first_ino;         /* first non-reserved inode */
+    uint16_t inode_size;        /* size of inode structure */
+    uint16_t block_group_nr;    /* block group # of this superblock */
+    uint32_t feature_compat;    /* compatible feature set */
+    uint32_t feature_incompat;  /* incompatible feature set */
+    uint32_t feature_ro_compat; /* readonly-compatible feature set */
+    uint32_t reserved[229];     /* padding to 1024 bytes */
 };
 
 struct ext2_group_desc {
@@ -116,148 +145,1115 @@ struct ext2_disk_dirent {
     char     name[255];
 };
 
+#define EXT2_DIRENT_HDR_SIZE    offsetof(struct ext2_disk_dirent, name)
+
 struct ext2_super_block {
     struct super_block      base;
     uint32_t                block_size;
     uint32_t                inodes_per_group;
+    uint32_t                blocks_per_group;
     uint32_t                log_block_size;
+    uint32_t                inode_size;
+    uint32_t                first_ino;  /* first non-reserved inode */
+    uint32_t                first_data_block;
+    uint32_t                blocks_count;
+    uint32_t                free_blocks_count;
+    uint32_t                free_inodes_count;
+    uint32_t                feature_incompat;
+    uint32_t                gd_block;   /* first group descriptors block */
+    unsigned int            num_groups;
     struct ext2_group_desc *gd_table;
+    const struct dev_ops   *bdev;       /* block device driver */
+    int                     dax;        /* memory backed device */
 };
 
 struct ext2_inode {
     struct inode base;
     uint32_t blocks[15]; /* pointers to blocks */
+    uint16_t links;      /* hard links count */
+    uint8_t  unlinked;   /* release the on-disk inode when unreferenced */
+    uint32_t nsectors;   /* allocated 512-byte sectors (disk 'blocks') */
+    uint32_t run_lblk;   /* first logical block of the cached run */
+    uint32_t run_pblk;   /* first physical block of the cached run */
+    uint32_t run_len;    /* number of blocks in the cached run (0 = none) */
+    struct ext2_dir_index *dindex; /* directory index (NULL if not built) */
 };
 
 
 
-static int offset_to_block(size_t offset, const struct ext2_inode *inod,
-                           const struct ext2_super_block *sb)
+#define EXT2_SB(sb)     ((struct ext2_super_block *)(sb))
+
+static const struct inode_ops ext2_inode_ops;
+
+static int ext2_super_inode_write(struct inode *inod);
+
+
+/******************************************************************************
+ *  Blocks and inodes allocation
+ ******************************************************************************/
+
+/*
+ * Write back the super block free counters.
+ */
+static void ext2_super_sync(const struct ext2_super_block *sb)
+{
+    struct buf *b;
+    struct ext2_disk_super_block *dsb;
+
+    b = bread(sb->base.dev, 1, sizeof(struct ext2_disk_super_block));
+    if (b == NULL)
+        return;
+    dsb = (struct ext2_disk_super_block *)b->data;
+    dsb->free_blocks_count = sb->free_blocks_count;
+    dsb->free_inodes_count = sb->free_inodes_count;
+    bdirty(b);
+    brelse(b);
+}
+
+/*
+ * Write back the in-memory copy of a group descriptor.
+ */
+static void ext2_gd_sync(const struct ext2_super_block *sb, unsigned int group)
+{
+    struct buf *b;
+    size_t off = group * sizeof(struct ext2_group_desc);
+
+    b = bread(sb->base.dev, sb->gd_block + off / sb->block_size,
+              sb->block_size);
+    if (b == NULL)
+        return;
+    memcpy(b->data + off % sb->block_size, &sb->gd_table[group],
+           sizeof(struct ext2_group_desc));
+    bdirty(b);
+    brelse(b);
+}
+
+/*
+ * Find and set the first clear bit within the bits [first, nbits) of a
+ * bitmap.
+ * Returns the bit index or -1 if the bitmap is full (or on error).
+ */
+static int ext2_bitmap_alloc(const struct ext2_super_block *sb,
+                             uint32_t block, uint32_t first, uint32_t nbits)
 {
-    uint32_t triple_block, double_block, indirect_block, block;
-    uint8_t ind, dbl, tpl;
-    uint32_t *buf;
-    uint32_t shift;
+    struct buf *b;
+    uint8_t *map;
+    uint32_t i;
+    int res = -1;
 
-    shift = 10 + sb->log_block_size;
-    if (shift >= 8 * sizeof(size_t))
+    b = bread(sb->base.dev, block, sb->block_size);
+    if (b == NULL)
         return -1;
+    map = (uint8_t *)b->data;
+    for (i = first; i < nbits; i++) {
+        if (map[i >> 3] == 0xff) {
+            i |= 7;
+            continue;
+        }
+        if ((map[i >> 3] & (1 << (i & 7))) == 0) {
+            map[i >> 3] |= (1 << (i & 7));
+            bdirty(b);
+            res = i;
+            break;
+        }
+    }
+    brelse(b);
+    return res;
+}
 
-    /* Is direct? */
-    if (offset < EXT2_NDIR_BLOCKS * sb->block_size) {
-        ind = offset >> shift;
-        if (ind >= sizeof(inod->blocks)/sizeof(inod->blocks[0]))
-            return -1;
-        return inod->blocks[ind];
+/*
+ * Clear a bitmap bit.
+ * Returns 0 on success, -1 if the bit was already clear (or on error).
+ */
+static int ext2_bitmap_free(const struct ext2_super_block *sb,
+                            uint32_t block, uint32_t bit)
+{
+    struct buf *b;
+    uint8_t *map;
+    int res = -1;
+
+    b = bread(sb->base.dev, block, sb->block_size);
+    if (b == NULL)
+        return -1;
+    map = (uint8_t *)b->data;
+    if ((map[bit >> 3] & (1 << (bit & 7))) != 0) {
+        map[bit >> 3] &= ~(1 << (bit & 7));
+        bdirty(b);
+        res = 0;
     }
+    brelse(b);
+    return res;
+}
 
-    buf = (uint32_t *)kmalloc(sb->block_size, 0);
+/*
+ * Allocate a block, preferably within the given group.
+ * Returns the block number or 0 if the file system is full.
+ */
+static uint32_t ext2_balloc(struct ext2_super_block *sb, unsigned int goal)
+{
+    unsigned int i, g;
+    uint32_t nbits;
+    int bit;
+
+    for (i = 0; i < sb->num_groups; i++) {
+        g = (goal + i) % sb->num_groups;
+        if (sb->gd_table[g].free_blocks_count == 0)
+            continue;
+        /* The last group may be shorter */
+        nbits = MIN(sb->blocks_per_group, sb->blocks_count -
+                    sb->first_data_block - g * sb->blocks_per_group);
+        bit = ext2_bitmap_alloc(sb, sb->gd_table[g].block_bitmap, 0, nbits);
+        if (bit < 0)
+            continue;
+        sb->gd_table[g].free_blocks_count--;
+        ext2_gd_sync(sb, g);
+        sb->free_blocks_count--;
+        ext2_super_sync(sb);
+        return sb->first_data_block + g * sb->blocks_per_group + bit;
+    }
+    return 0;
+}
 
-    indirect_block = inod->blocks[EXT2_BLK_IND];
-    double_block = inod->blocks[EXT2_BLK_DBL];
-    triple_block = inod->blocks[EXT2_BLK_TPL];
+static void ext2_bfree(struct ext2_super_block *sb, uint32_t block)
+{
+    unsigned int g;
+    uint32_t bit;
+
+    if (block < sb->first_data_block || block >= sb->blocks_count)
+        return;
+    g = (block - sb->first_data_block) / sb->blocks_per_group;
+    bit = (block - sb->first_data_block) % sb->blocks_per_group;
+    if (ext2_bitmap_free(sb, sb->gd_table[g].block_bitmap, bit) < 0)
+        return;
+    bforget(sb->base.dev, block, sb->block_size);
+    sb->gd_table[g].free_blocks_count++;
+    ext2_gd_sync(sb, g);
+    sb->free_blocks_count++;
+    ext2_super_sync(sb);
+}
 
-    offset = (offset >> shift) - EXT2_NDIR_BLOCKS;
-    ind = offset;
-    dbl = offset >> 8;
-    tpl = offset >> 16;
+/*
+ * Allocate an inode number, preferably within the given group.
+ * Returns the inode number or 0 if there are no free inodes.
+ */
+static ino_t ext2_ialloc(struct ext2_super_block *sb, unsigned int goal,
+                         mode_t mode)
+{
+    unsigned int i, g;
+    uint32_t first;
+    int bit;
+
+    for (i = 0; i < sb->num_groups; i++) {
+        g = (goal + i) % sb->num_groups;
+        if (sb->gd_table[g].free_inodes_count == 0)
+            continue;
+        /* Skip the reserved inodes */
+        first = (g * sb->inodes_per_group < sb->first_ino - 1) ?
+                sb->first_ino - 1 - g * sb->inodes_per_group : 0;
+        bit = ext2_bitmap_alloc(sb, sb->gd_table[g].inode_bitmap, first,
+                                sb->inodes_per_group);
+        if (bit < 0)
+            continue;
+        sb->gd_table[g].free_inodes_count--;
+        if (S_ISDIR(mode))
+            sb->gd_table[g].used_dirs_count++;
+        ext2_gd_sync(sb, g);
+        sb->free_inodes_count--;
+        ext2_super_sync(sb);
+        return g * sb->inodes_per_group + bit + 1;
+    }
+    return 0;
+}
 
-    if (tpl != 0)
-        panic("ext2: required triple block %d", triple_block);
+static void ext2_ifree(struct ext2_super_block *sb, ino_t ino, mode_t mode)
+{
+    unsigned int g = (ino - 1) / sb->inodes_per_group;
+    uint32_t bit = (ino - 1) % sb->inodes_per_group;
+
+    if (ext2_bitmap_free(sb, sb->gd_table[g].inode_bitmap, bit) < 0)
+        return;
+    sb->gd_table[g].free_inodes_count++;
+    if (S_ISDIR(mode))
+        sb->gd_table[g].used_dirs_count--;
+    ext2_gd_sync(sb, g);
+    sb->free_inodes_count++;
+    ext2_super_sync(sb);
+}
 
-    if (dbl != 0)
-        panic("ext2: required double block %d", double_block);
 
-    if (devfs_read(sb->base.dev, buf, sb->block_size,
-                   indirect_block*sb->block_size) != sb->block_size)
-        return -1;
-    block = buf[ind];
+/******************************************************************************
+ *  Data blocks access
+ ******************************************************************************/
 
-    kfree(buf, sb->block_size);
+/*
+ * On memory backed devices (DAX) the file data is accessed in place,
+ * otherwise via the buffer cache. Metadata always goes through the cache.
+ */
 
+static int ext2_data_read(const struct ext2_super_block *sb, uint32_t block,
+                          void *buf, size_t off, size_t n)
+{
+    struct buf *b;
+    const char *ptr;
+
+    if (sb->dax != 0) {
+        ptr = sb->bdev->direct(sb->base.dev, sb->block_size,
+                               (size_t)block * sb->block_size);
+        if (ptr == NULL)
+            return -EIO;
+        memcpy(buf, ptr + off, n);
+    } else {
+        b = bread(sb->base.dev, block, sb->block_size);
+        if (b == NULL)
+            return -EIO;
+        memcpy(buf, b->data + off, n);
+        brelse(b);
+    }
+    return 0;
+}
+
+/*
+ * If 'buf' is NULL the range is zero filled.
+ */
+static int ext2_data_write(const struct ext2_super_block *sb, uint32_t block,
+                           const void *buf, size_t off, size_t n)
+{
+    struct buf *b;
+    char *ptr;
+
+    if (sb->dax != 0) {
+        ptr = sb->bdev->direct(sb->base.dev, sb->block_size,
+                               (size_t)block * sb->block_size);
+        if (ptr == NULL)
+            return -EIO;
+    } else {
+        /* Whole blocks are overwritten, don't read them */
+        if (n == sb->block_size)
+            b = bget(sb->base.dev, block, sb->block_size);
+        else
+            b = bread(sb->base.dev, block, sb->block_size);
+        if (b == NULL)
+            return -EIO;
+        ptr = b->data;
+    }
+    if (buf != NULL)
+        memcpy(ptr + off, buf, n);
+    else
+        memset(ptr + off, 0, n);
+    if (sb->dax == 0) {
+        bdirty(b);
+        brelse(b);
+    }
+    return 0;
+}
+
+
+/******************************************************************************
+ *  Block mapping
+ ******************************************************************************/
+
+/*
+ * Allocate a zero filled block for the inode and store its number in 'slot'.
+ * Returns the block number or a negative error number.
+ */
+static int ext2_block_new(struct ext2_inode *inod, uint32_t *slot)
+{
+    struct ext2_super_block *sb = EXT2_SB(inod->base.sb);
+    uint32_t block;
+
+    block = ext2_balloc(sb, (inod->base.ino - 1) / sb->inodes_per_group);
+    if (block == 0)
+        return -ENOSPC;
+    if (ext2_data_write(sb, block, NULL, 0, sb->block_size) < 0) {
+        ext2_bfree(sb, block);
+        return -EIO;
+    }
+
+    *slot = block;
+    inod->nsectors += sb->block_size / 512;
+    inod->run_len = 0;
     return block;
 }
 
+/*
+ * Walk the indirection tree rooted at 'block' down to the data block
+ * with index 'rel' (relative to the tree first block).
+ * When the leaf pointers block is reached, the run of physically
+ * contiguous blocks starting from the file block 'lblk' is recorded in the
+ * inode, thus the following sequential lookups are resolved without
+ * further reads.
+ */
+static int indirect_to_block(struct ext2_inode *inod, uint32_t block,
+                             uint32_t rel, int depth, uint32_t lblk,
+                             int create)
+{
+    const struct ext2_super_block *sb = EXT2_SB(inod->base.sb);
+    struct buf *b;
+    uint32_t *ptrs;
+    uint32_t nptrs, span, ind, len;
+    int i, res;
+
+    nptrs = sb->block_size / sizeof(uint32_t);
+    for (; depth > 0; depth--) {
+        span = 1;
+        for (i = 1; i < depth; i++)
+            span *= nptrs;
+        ind = rel / span;
+        rel %= span;
+
+        b = bread(sb->base.dev, block, sb->block_size);
+        if (b == NULL)
+            return -EIO;
+        ptrs = (uint32_t *)b->data;
+        if (ptrs[ind] == 0 && create != 0) {
+            res = ext2_block_new(inod, &ptrs[ind]);
+            if (res < 0) {
+                brelse(b);
+                return res;
+            }
+            bdirty(b);
+        }
+        block = ptrs[ind];
+        if (depth == 1 && block != 0) {
+            len = 1;
+            while (ind + len < nptrs && ptrs[ind + len] == block + len)
+                len++;
+            inod->run_lblk = lblk;
+            inod->run_pblk = block;
+            inod->run_len = len;
+        }
+        brelse(b);
+        if (block == 0)
+            return 0;   /* Hole */
+    }
+    return block;
+}
+
+/*
+ * Get the device block mapped to the file block 'lblk'.
+ * If 'create' is set the missing blocks (data and indirect) are allocated.
+ * Returns the block number, 0 for holes or a negative error number.
+ */
+static int ext2_bmap(struct ext2_inode *inod, uint32_t lblk, int create)
+{
+    const struct ext2_super_block *sb = EXT2_SB(inod->base.sb);
+    uint32_t rel, nptrs;
+    int depth, slot, res;
+
+    /* Is direct? */
+    if (lblk < EXT2_NDIR_BLOCKS) {
+        if (inod->blocks[lblk] == 0 && create != 0)
+            return ext2_block_new(inod, &inod->blocks[lblk]);
+        return inod->blocks[lblk];
+    }
+
+    /* Is within the cached run? */
+    if (lblk - inod->run_lblk < inod->run_len)
+        return inod->run_pblk + (lblk - inod->run_lblk);
+
+    nptrs = sb->block_size / sizeof(uint32_t);
+    rel = lblk - EXT2_NDIR_BLOCKS;
+    if (rel < nptrs) {
+        depth = 1;
+        slot = EXT2_BLK_IND;
+    } else if ((rel -= nptrs) < nptrs * nptrs) {
+        depth = 2;
+        slot = EXT2_BLK_DBL;
+    } else if ((rel -= nptrs * nptrs) / nptrs < nptrs * nptrs) {
+        depth = 3;
+        slot = EXT2_BLK_TPL;
+    } else {
+        return -EFBIG;
+    }
+
+    if (inod->blocks[slot] == 0) {
+        if (create == 0)
+            return 0;   /* Hole */
+        res = ext2_block_new(inod, &inod->blocks[slot]);
+        if (res < 0)
+            return res;
+    }
+    return indirect_to_block(inod, inod->blocks[slot], rel, depth, lblk,
+                             create);
+}
+
+/*
+ * Release the blocks of an indirection tree whose (relative) index is
+ * greater than or equal to 'keep'. If nothing is kept, the pointers block
+ * itself is released and the slot cleared.
+ */
+static void ext2_free_tree(struct ext2_inode *inod, uint32_t *slot,
+                           int depth, uint32_t keep)
+{
+    struct ext2_super_block *sb = EXT2_SB(inod->base.sb);
+    struct buf *b;
+    uint32_t *ptrs;
+    uint32_t nptrs, span, i, base;
+    int k;
+
+    if (*slot == 0)
+        return;
+    nptrs = sb->block_size / sizeof(uint32_t);
+    span = 1;
+    for (k = 1; k < depth; k++)
+        span *= nptrs;
+
+    b = bread(sb->base.dev, *slot, sb->block_size);
+    if (b == NULL)
+        return;
+    ptrs = (uint32_t *)b->data;
+    for (i = 0, base = 0; i < nptrs; i++, base += span) {
+        if (ptrs[i] == 0 || base + span <= keep)
+            continue;
+        if (depth == 1) {
+            ext2_bfree(sb, ptrs[i]);
+            inod->nsectors -= sb->block_size / 512;
+            ptrs[i] = 0;
+        } else {
+            ext2_free_tree(inod, &ptrs[i], depth - 1,
+                           (keep > base) ? keep - base : 0);
+        }
+    }
+    bdirty(b);
+    brelse(b);
+
+    if (keep == 0) {
+        ext2_bfree(sb, *slot);
+        inod->nsectors -= sb->block_size / 512;
+        *slot = 0;
+    }
+}
+
+static int ext2_truncate(struct inode *inod, size_t size)
+{
+    struct ext2_inode *ei = (struct ext2_inode *)inod;
+    struct ext2_super_block *sb = EXT2_SB(inod->sb);
+    uint32_t keep, nptrs, i;
+    int block;
+
+    if (size < inod->size) {
+        nptrs = sb->block_size / sizeof(uint32_t);
+        keep = (size + sb->block_size - 1) / sb->block_size;
+
+        for (i = keep; i < EXT2_NDIR_BLOCKS; i++) {
+            if (ei->blocks[i] != 0) {
+                ext2_bfree(sb, ei->blocks[i]);
+                ei->nsectors -= sb->block_size / 512;
+                ei->blocks[i] = 0;
+            }
+        }
+        keep = (keep > EXT2_NDIR_BLOCKS) ? keep - EXT2_NDIR_BLOCKS : 0;
+        ext2_free_tree(ei, &ei->blocks[EXT2_BLK_IND], 1, keep);
+        keep = (keep > nptrs) ? keep - nptrs : 0;
+        ext2_free_tree(ei, &ei->blocks[EXT2_BLK_DBL], 2, keep);
+        keep = (keep > nptrs * nptrs) ? keep - nptrs * nptrs : 0;
+        ext2_free_tree(ei, &ei->blocks[EXT2_BLK_TPL], 3, keep);
+        ei->run_len = 0;
+
+        /* Clear the tail of the last block, it may be exposed again */
+        if (size % sb->block_size != 0) {
+            block = ext2_bmap(ei, size / sb->block_size, 0);
+            if (block > 0)
+                ext2_data_write(sb, block, NULL, size % sb->block_size,
+                                sb->block_size - size % sb->block_size);
+        }
+    }
+    inod->size = size;
+    return ext2_super_inode_write(inod);
+}
+
+
 /******************************************************************************
- *  Dentry operations
+ *  Inode operations
  ******************************************************************************/
 
 static ssize_t ext2_read(struct ext2_inode *inod, void *buf,
                          size_t count, size_t off)
 {
     const struct ext2_super_block *sb;
-    int left;
+    size_t left;
     int block;
-    size_t ext2_off, block_off, file_off;
-    ssize_t n;
+    size_t block_off;
+    size_t n;
+
+    /* Device special files data are not stored in the file system */
+    if (S_ISCHR(inod->base.mode) || S_ISBLK(inod->base.mode))
+        return dev_read(inod->base.mode & S_IFMT, inod->base.rdev,
+                        buf, count, off);
 
-    sb = (struct ext2_super_block *)inod->base.sb;
+    sb = EXT2_SB(inod->base.sb);
 
     if (inod->base.size < off)
         return 0; /* EOF */
     if (inod->base.size < off + count)
         count = inod->base.size - off;
 
-    file_off = off;
     left = count;
     while (left > 0) {
-        block = offset_to_block(file_off, inod, sb);
+        block = ext2_bmap(inod, off / sb->block_size, 0);
         if (block < 0)
             break;
-        block_off = off % sb->block_size; /* used just by the first block */
-        ext2_off = block * sb->block_size + block_off;
+        block_off = off % sb->block_size;
         n = MIN(left, sb->block_size - block_off);
-        if (devfs_read(sb->base.dev, buf, n, ext2_off) != n)
+        if (block == 0)
+            memset(buf, 0, n); /* Hole */
+        else if (ext2_data_read(sb, block, buf, block_off, n) < 0)
             break;
 
         left -= n;
-        file_off += n;
+        off += n;
         buf = (char *)buf + n;
-        off = 0;
     }
-    return count-left;
+    return count - left;
 }
 
-static struct inode *ext2_lookup(struct inode *dir, const char *name)
+static void ext2_readahead(struct ext2_inode *inod, size_t off, size_t count)
 {
-    struct ext2_disk_dirent *curr;
-    struct ext2_disk_dirent *dirbuf;
-    int count;
-    struct inode *inod = NULL;
+    const struct ext2_super_block *sb = EXT2_SB(inod->base.sb);
+    uint32_t lblk, last;
+    int block;
 
-    dirbuf = (struct ext2_disk_dirent *)kmalloc(dir->size, 0);
-    if (dirbuf == NULL)
+    /* Pointless if the data is accessed in place */
+    if (sb->dax != 0 || !S_ISREG(inod->base.mode) ||
+        off >= inod->base.size || count == 0)
+        return;
+    count = MIN(count, inod->base.size - off);
+    last = (off + count - 1) / sb->block_size;
+    for (lblk = off / sb->block_size; lblk <= last; lblk++) {
+        block = ext2_bmap(inod, lblk, 0);
+        if (block < 0)
+            break;
+        if (block > 0)
+            bprefetch(sb->base.dev, block, sb->block_size);
+    }
+    /* Dispatch the batch, adjacent blocks are merged */
+    blk_unplug(sb->base.dev);
+}
+
+static void *ext2_direct(struct ext2_inode *inod, size_t off, size_t count)
+{
+    const struct ext2_super_block *sb = EXT2_SB(inod->base.sb);
+    uint32_t lblk, last;
+    int first, block;
+
+    if (sb->dax == 0 || count == 0 || off + count > inod->base.size)
+        return NULL;
+    last = (off + count - 1) / sb->block_size;
+    lblk = off / sb->block_size;
+    first = ext2_bmap(inod, lblk, 0);
+    if (first <= 0)
         return NULL;
+    /* The blocks must be physically contiguous */
+    while (++lblk <= last) {
+        block = ext2_bmap(inod, lblk, 0);
+        if (block != first + (int)(lblk - off / sb->block_size))
+            return NULL;
+    }
+    return sb->bdev->direct(sb->base.dev, count,
+                            (size_t)first * sb->block_size +
+                            off % sb->block_size);
+}
+
+static ssize_t ext2_write(struct ext2_inode *inod, const void *buf,
+                          size_t count, size_t off)
+{
+    const struct ext2_super_block *sb;
+    size_t left;
+    int block;
+    size_t block_off;
+    size_t n;
+    int res = 0;
 
-    if (devfs_read(dir->sb->dev, dirbuf, dir->size,
-                   ((struct ext2_inode *)dir)->blocks[0] * 1024) != dir->size)
-        goto end;
-
-    count = dir->size;
-    curr = dirbuf;
-    while(count >= sizeof(struct ext2_disk_dirent)) {
-        /* dirent->name is not null terminated */
-        if(strlen(name) == (size_t)curr->name_len &&
-           memcmp(name, curr->name, curr->name_len) == 0) {
-            inod = iget(dir->sb, curr->ino);
-            if (inod != NULL)
-                inod->ref--; /* iget incremented the counter... release it */
+    if (S_ISCHR(inod->base.mode) || S_ISBLK(inod->base.mode))
+        return dev_write(inod->base.mode & S_IFMT, inod->base.rdev,
+                         buf, count, off);
+
+    sb = EXT2_SB(inod->base.sb);
+
+    left = count;
+    while (left > 0) {
+        block = ext2_bmap(inod, off / sb->block_size, 1);
+        if (block <= 0) {
+            res = (block < 0) ? block : -EIO;
             break;
         }
-        if((curr->rec_len) == 0)
+        block_off = off % sb->block_size;
+        n = MIN(left, sb->block_size - block_off);
+        res = ext2_data_write(sb, block, buf, block_off, n);
+        if (res < 0)
             break;
-        count -= curr->rec_len;
-        curr = (struct ext2_disk_dirent *)((char *)curr + curr->rec_len);
+
+        left -= n;
+        off += n;
+        buf = (const char *)buf + n;
+    }
+
+    if (off > inod->base.size)
+        inod->base.size = off;
+    ext2_super_inode_write(&inod->base);
+    return (left < count) ? (ssize_t)(count - left) : res;
+}
+
+/*
+ * Directory entries visitor.
+ * Returns 0 to continue the iteration, any other value stops it.
+ */
+typedef int (* ext2_dirent_visit_t)(const struct ext2_disk_dirent *de,
+                                    void *ctx);
+
+/*
+ * Visit the in-use entries of a directory, block by block, via the
+ * buffer cache, starting from the byte offset '*pos'.
+ * Entries never span a block boundary.
+ * On return '*pos' is the offset of the entry that stopped the iteration
+ * (not consumed) or the directory size.
+ * Returns the value that stopped the iteration, 0 if all the entries have
+ * been visited or -EIO on error.
+ */
+static int ext2_dir_foreach(struct ext2_inode *dir, size_t *pos,
+                            ext2_dirent_visit_t visit, void *ctx)
+{
+    const struct ext2_super_block *sb;
+    const struct ext2_disk_dirent *de;
+    struct buf *b;
+    int block;
+    int ret = 0;
+    size_t off, boff;
+
+    sb = EXT2_SB(dir->base.sb);
+    while (*pos < dir->base.size && ret == 0) {
+        off = ALIGN_DOWN(*pos, sb->block_size);
+        block = ext2_bmap(dir, off / sb->block_size, 0);
+        if (block <= 0)
+            return -EIO;
+        b = bread(sb->base.dev, block, sb->block_size);
+        if (b == NULL)
+            return -EIO;
+        boff = *pos - off;
+        while (boff + EXT2_DIRENT_HDR_SIZE <= sb->block_size) {
+            de = (const struct ext2_disk_dirent *)(b->data + boff);
+            if (de->rec_len < EXT2_DIRENT_HDR_SIZE ||
+                boff + de->rec_len > sb->block_size)
+                break;  /* Corrupted */
+            if (de->ino != 0 && (ret = visit(de, ctx)) != 0)
+                break;
+            boff += de->rec_len;
+        }
+        brelse(b);
+        *pos = (ret == 0) ? off + sb->block_size : off + boff;
+    }
+    if (*pos > dir->base.size)
+        *pos = dir->base.size;
+    return ret;
+}
+
+
+/*
+ * In-memory directory index.
+ * Maps entry names to inode numbers. Built on the first lookup and
+ * dropped whenever the directory changes.
+ */
+
+struct ext2_dir_entry {
+    struct htable_link      hlink;      /* link within the index table */
+    struct ext2_dir_entry   *next;      /* next in the index entries list */
+    ino_t                   ino;        /* inode number */
+    uint8_t                 name_len;   /* name length */
+    char                    name[1];    /* name (not null terminated) */
+};
+
+struct ext2_dir_index {
+    unsigned int            bits;       /* hash table bits */
+    struct ext2_dir_entry   *entries;   /* all the entries */
+    struct htable_link      *htable[1]; /* hash table (1 << bits) */
+};
+
+#define DIR_ENTRY_SIZE(name_len) \
+    (offsetof(struct ext2_dir_entry, name) + (name_len))
+
+#define DIR_INDEX_SIZE(bits) \
+    (offsetof(struct ext2_dir_index, htable) + \
+     sizeof(struct htable_link *) * (1 << (bits)))
+
+#define DIR_INDEX_BITS_MIN  3
+#define DIR_INDEX_BITS_MAX  10
+
+/* Bytes per directory entry estimate, used to size the index table. */
+#define DIR_ENTRY_AVG_SIZE  16
+
+static uint32_t name_hash(const char *name, size_t len)
+{
+    uint32_t h = 5381;
+
+    while (len-- > 0)
+        h = (h << 5) + h + (uint8_t)*name++;
+    return h;
+}
+
+static int dir_index_add(const struct ext2_disk_dirent *de, void *ctx)
+{
+    struct ext2_dir_index *index = (struct ext2_dir_index *)ctx;
+    struct ext2_dir_entry *ent;
+
+    ent = (struct ext2_dir_entry *)kmalloc(DIR_ENTRY_SIZE(de->name_len), 0);
+    if (ent == NULL)
+        return -ENOMEM;
+    ent->ino = de->ino;
+    ent->name_len = de->name_len;
+    memcpy(ent->name, de->name, de->name_len);
+    ent->next = index->entries;
+    index->entries = ent;
+    htable_insert(index->htable, &ent->hlink,
+                  name_hash(ent->name, ent->name_len), index->bits);
+    return 0;
+}
+
+static void ext2_dir_index_drop(struct ext2_inode *dir)
+{
+    struct ext2_dir_index *index = dir->dindex;
+    struct ext2_dir_entry *ent;
+
+    if (index == NULL)
+        return;
+    dir->dindex = NULL;
+    while ((ent = index->entries) != NULL) {
+        index->entries = ent->next;
+        kfree(ent, DIR_ENTRY_SIZE(ent->name_len));
+    }
+    kfree(index, DIR_INDEX_SIZE(index->bits));
+}
+
+static struct ext2_dir_index *ext2_dir_index_get(struct ext2_inode *dir)
+{
+    struct ext2_dir_index *index;
+    unsigned int bits;
+    size_t pos;
+
+    if (dir->dindex != NULL)
+        return dir->dindex;
+
+    pos = 0;
+    bits = fnzb(dir->base.size / DIR_ENTRY_AVG_SIZE) + 1;
+    bits = MAX(bits, DIR_INDEX_BITS_MIN);
+    bits = MIN(bits, DIR_INDEX_BITS_MAX);
+    index = (struct ext2_dir_index *)kmalloc(DIR_INDEX_SIZE(bits), 0);
+    if (index == NULL)
+        return NULL;
+    index->bits = bits;
+    index->entries = NULL;
+    htable_init(index->htable, bits);
+
+    dir->dindex = index;
+    if (ext2_dir_foreach(dir, &pos, dir_index_add, index) != 0)
+        ext2_dir_index_drop(dir);
+    return dir->dindex;
+}
+
+
+struct dir_match {
+    const char  *name;
+    size_t      len;
+    ino_t       ino;
+};
+
+static int dir_match(const struct ext2_disk_dirent *de, void *ctx)
+{
+    struct dir_match *m = (struct dir_match *)ctx;
+
+    /* dirent->name is not null terminated */
+    if (m->len == (size_t)de->name_len &&
+        memcmp(m->name, de->name, de->name_len) == 0) {
+        m->ino = de->ino;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Get the inode number of a directory entry, 0 if not found.
+ * The inode is not instantiated.
+ */
+static ino_t ext2_dir_find(struct ext2_inode *dir, const char *name)
+{
+    struct ext2_dir_index *index;
+    const struct ext2_dir_entry *ent;
+    const struct htable_link *lnk;
+    struct dir_match m;
+    size_t pos = 0;
+
+    m.name = name;
+    m.len = strlen(name);
+    m.ino = 0;
+
+    index = ext2_dir_index_get(dir);
+    if (index != NULL) {
+        lnk = htable_lookup(index->htable, name_hash(name, m.len),
+                            index->bits);
+        while (lnk != NULL) {
+            ent = struct_ptr(lnk, struct ext2_dir_entry, hlink);
+            if (ent->name_len == m.len &&
+                memcmp(ent->name, name, m.len) == 0) {
+                m.ino = ent->ino;
+                break;
+            }
+            lnk = lnk->next;
+        }
+    } else {
+        /* Not enough memory for the index, fallback to a linear scan */
+        ext2_dir_foreach(dir, &pos, dir_match, &m);
+    }
+    return m.ino;
+}
+
+static struct inode *ext2_lookup(struct inode *dir, const char *name)
+{
+    struct inode *inod = NULL;
+    ino_t ino;
+
+    ino = ext2_dir_find((struct ext2_inode *)dir, name);
+    if (ino != 0) {
+        inod = iget(dir->sb, ino);
+        if (inod != NULL)
+            inod->ref--; /* iget incremented the counter... release it */
     }
-end:
-    kfree(dirbuf, dir->size);
     return inod;
 }
 
 
+
+/*
+ * Directory entries modification.
+ * The entry record length is the minimum required, 4 bytes aligned.
+ */
+#define DIRENT_REC_LEN(name_len) \
+    ALIGN_UP(EXT2_DIRENT_HDR_SIZE + (name_len), 4)
+
+static uint8_t ext2_file_type(mode_t mode)
+{
+    if (S_ISREG(mode))
+        return EXT2_FT_REG_FILE;
+    if (S_ISDIR(mode))
+        return EXT2_FT_DIR;
+    if (S_ISCHR(mode))
+        return EXT2_FT_CHRDEV;
+    if (S_ISBLK(mode))
+        return EXT2_FT_BLKDEV;
+    if (S_ISFIFO(mode))
+        return EXT2_FT_FIFO;
+    return EXT2_FT_UNKNOWN;
+}
+
+static void dirent_set(const struct ext2_super_block *sb,
+                       struct ext2_disk_dirent *de, const char *name,
+                       size_t len, ino_t ino, mode_t mode)
+{
+    de->ino = ino;
+    de->name_len = len;
+    de->file_type = (sb->feature_incompat & EXT2_FEATURE_INCOMPAT_FILETYPE) ?
+                    ext2_file_type(mode) : 0;
+    memcpy(de->name, name, len);
+}
+
+/*
+ * Add an entry to a directory.
+ * The first entry with enough slack space is split, if none is found
+ * a new block is appended to the directory.
+ */
+static int ext2_dir_add(struct ext2_inode *dir, const char *name,
+                        ino_t ino, mode_t mode)
+{
+    const struct ext2_super_block *sb = EXT2_SB(dir->base.sb);
+    struct ext2_disk_dirent *de, *nde;
+    struct buf *b;
+    size_t len = strlen(name);
+    size_t need = DIRENT_REC_LEN(len);
+    size_t off, boff, used;
+    int block;
+
+    if (len > NAME_MAX || len > 255)
+        return -ENAMETOOLONG;
+
+    for (off = 0; off < dir->base.size; off += sb->block_size) {
+        block = ext2_bmap(dir, off / sb->block_size, 0);
+        if (block <= 0)
+            return -EIO;
+        b = bread(sb->base.dev, block, sb->block_size);
+        if (b == NULL)
+            return -EIO;
+        for (boff = 0; boff + EXT2_DIRENT_HDR_SIZE <= sb->block_size;
+             boff += de->rec_len) {
+            de = (struct ext2_disk_dirent *)(b->data + boff);
+            if (de->rec_len < EXT2_DIRENT_HDR_SIZE ||
+                boff + de->rec_len > sb->block_size)
+                break;  /* Corrupted */
+            used = (de->ino != 0) ? DIRENT_REC_LEN(de->name_len) : 0;
+            if (de->rec_len - used < need)
+                continue;
+            if (used != 0) {
+                nde = (struct ext2_disk_dirent *)((char *)de + used);
+                nde->rec_len = de->rec_len - used;
+                de->rec_len = used;
+                de = nde;
+            }
+            dirent_set(sb, de, name, len, ino, mode);
+            bdirty(b);
+            brelse(b);
+            ext2_dir_index_drop(dir);
+            return 0;
+        }
+        brelse(b);
+    }
+
+    /* No room, append a new block */
+    block = ext2_bmap(dir, dir->base.size / sb->block_size, 1);
+    if (block <= 0)
+        return (block < 0) ? block : -EIO;
+    b = bread(sb->base.dev, block, sb->block_size);
+    if (b == NULL)
+        return -EIO;
+    de = (struct ext2_disk_dirent *)b->data;
+    de->rec_len = sb->block_size;
+    dirent_set(sb, de, name, len, ino, mode);
+    bdirty(b);
+    brelse(b);
+    dir->base.size += sb->block_size;
+    ext2_dir_index_drop(dir);
+    return ext2_super_inode_write(&dir->base);
+}
+
+/*
+ * Remove an entry from a directory.
+ * The entry space is merged into the previous entry of the same block,
+ * the first entry of a block is just marked as unused.
+ * Returns the removed entry inode number or a negative error number.
+ */
+static int ext2_dir_remove(struct ext2_inode *dir, const char *name)
+{
+    const struct ext2_super_block *sb = EXT2_SB(dir->base.sb);
+    struct ext2_disk_dirent *de, *prev;
+    struct buf *b;
+    size_t len = strlen(name);
+    size_t off, boff;
+    int block;
+    ino_t ino;
+
+    for (off = 0; off < dir->base.size; off += sb->block_size) {
+        block = ext2_bmap(dir, off / sb->block_size, 0);
+        if (block <= 0)
+            return -EIO;
+        b = bread(sb->base.dev, block, sb->block_size);
+        if (b == NULL)
+            return -EIO;
+        prev = NULL;
+        for (boff = 0; boff + EXT2_DIRENT_HDR_SIZE <= sb->block_size;
+             boff += de->rec_len) {
+            de = (struct ext2_disk_dirent *)(b->data + boff);
+            if (de->rec_len < EXT2_DIRENT_HDR_SIZE ||
+                boff + de->rec_len > sb->block_size)
+                break;  /* Corrupted */
+            if (de->ino != 0 && de->name_len == len &&
+                memcmp(de->name, name, len) == 0) {
+                ino = de->ino;
+                if (prev != NULL)
+                    prev->rec_len += de->rec_len;
+                else
+                    de->ino = 0;
+                bdirty(b);
+                brelse(b);
+                ext2_dir_index_drop(dir);
+                return ino;
+            }
+            prev = de;
+        }
+        brelse(b);
+    }
+    return -ENOENT;
+}
+
+static int ext2_mknod(struct inode *idir, const char *name, mode_t mode,
+                      dev_t dev)
+{
+    struct ext2_super_block *sb = EXT2_SB(idir->sb);
+    struct ext2_inode *inod;
+    ino_t ino;
+    int res;
+
+    /* Directories require the '.' and '..' entries, not supported yet */
+    if (!S_ISREG(mode) && !S_ISCHR(mode) && !S_ISBLK(mode) &&
+        !S_ISFIFO(mode))
+        return -EPERM;
+    if (ext2_dir_find((struct ext2_inode *)idir, name) != 0)
+        return -EEXIST;
+
+    ino = ext2_ialloc(sb, (idir->ino - 1) / sb->inodes_per_group, mode);
+    if (ino == 0)
+        return -ENOSPC;
+
+    inod = (struct ext2_inode *)iget(&sb->base, ino);
+    if (inod == NULL) {
+        ext2_ifree(sb, ino, mode);
+        return -ENOMEM;
+    }
+    /* The inode was just read from a released slot, reset it */
+    memset(inod->blocks, 0, sizeof(inod->blocks));
+    inod->base.mode = mode;
+    inod->base.uid = current->euid;
+    inod->base.gid = current->egid;
+    inod->base.size = 0;
+    inod->base.rdev = (S_ISCHR(mode) || S_ISBLK(mode)) ? dev : 0;
+    inod->nsectors = 0;
+    inod->links = 1;
+    inod->run_len = 0;
+
+    res = ext2_super_inode_write(&inod->base);
+    if (res == 0)
+        res = ext2_dir_add((struct ext2_inode *)idir, name, ino, mode);
+    if (res < 0)
+        inod->unlinked = 1;
+    iput(&inod->base);
+    return res;
+}
+
+static int ext2_unlink(struct inode *idir, const char *name)
+{
+    struct ext2_inode *inod;
+    int ino;
+
+    ino = ext2_dir_find((struct ext2_inode *)idir, name);
+    if (ino == 0)
+        return -ENOENT;
+    inod = (struct ext2_inode *)iget(idir->sb, ino);
+    if (inod == NULL)
+        return -EIO;
+    if (S_ISDIR(inod->base.mode)) {
+        iput(&inod->base);
+        return -EISDIR;
+    }
+    ino = ext2_dir_remove((struct ext2_inode *)idir, name);
+    if (ino < 0) {
+        iput(&inod->base);
+        return ino;
+    }
+
+    if (inod->links > 0)
+        inod->links--;
+    if (inod->links == 0)
+        inod->unlinked = 1; /* Released with the last reference */
+    ext2_super_inode_write(&inod->base);
+    iput(&inod->base);
+    return 0;
+}
+
+
 static const struct inode_ops ext2_inode_ops = {
-    .read   = (inode_read_t)ext2_read,
-    .lookup = ext2_lookup,
+    .read      = (inode_read_t)ext2_read,
+    .write     = (inode_write_t)ext2_write,
+    .mknod     = ext2_mknod,
+    .lookup    = ext2_lookup,
+    .unlink    = ext2_unlink,
+    .truncate  = ext2_truncate,
+    .readahead = (inode_readahead_t)ext2_readahead,
+    .direct    = (inode_direct_t)ext2_direct,
 };
 
 
@@ -265,58 +1261,74 @@ static const struct inode_ops ext2_inode_ops = {
  *  Dentry operations
  ******************************************************************************/
 
-static int ext2_readdir(struct inode *dir, unsigned int i,
-                        struct dirent *dent)
+static void dirent_fill(struct dirent *dent,
+                        const struct ext2_disk_dirent *de)
 {
-    struct ext2_disk_dirent *curr;
-    struct ext2_disk_dirent *dirbuf;
-    size_t count, n;
-    int ret = -1;
+    size_t n;
 
-    dirbuf = (struct ext2_disk_dirent *)kmalloc(dir->size, 0);
-    if (dirbuf == NULL)
-        return -ENOMEM;
+    n = MIN(de->name_len, NAME_MAX);
+    memcpy(dent->d_name, de->name, n);
+    dent->d_name[n] = '\0';
+    dent->d_ino = de->ino;
+}
 
-    ret = devfs_read(dir->sb->dev, dirbuf, dir->size,
-                    ((struct ext2_inode *)dir)->blocks[0] * 1024);
-    if (ret != dir->size) {
-        if (ret >= 0)
-            ret = -EIO;
-        goto end;
-    }
-
-    count = dir->size;
-    curr = dirbuf;
-    n = 0;
-    while(count >= sizeof(struct ext2_disk_dirent)) {
-        if (n++ == i) {
-            n = MIN(curr->name_len, NAME_MAX);
-            memcpy(&dent->d_name, curr->name, n);
-            dent->d_name[n] = '\0';
-            dent->d_ino = curr->ino;
-            ret = 0;
-            break;
-        }
-        if((curr->rec_len) == 0)
-            break;
-        count -= curr->rec_len;
-        curr = (struct ext2_disk_dirent *)((char *)curr + curr->rec_len);
-    }
+struct dir_fill {
+    unsigned int    skip;   /* entries to skip */
+    unsigned int    count;  /* entries to fill */
+    unsigned int    n;      /* entries filled */
+    struct dirent   *dents;
+};
 
-end:
-    kfree(dirbuf, dir->size);
-    return ret;
-}
+static int dir_fill(const struct ext2_disk_dirent *de, void *ctx)
+{
+    struct dir_fill *f = (struct dir_fill *)ctx;
 
+    if (f->skip != 0) {
+        f->skip--;
+        return 0;
+    }
+    if (f->n == f->count)
+        return 1;   /* Full, the entry is left for the next call */
+    dirent_fill(&f->dents[f->n++], de);
+    return 0;
+}
 
 static int ext2_dentry_readdir(struct dentry *dir, unsigned int i,
                                struct dirent *dent)
 {
-    return ext2_readdir(dir->inod, i, dent);
+    struct dir_fill f;
+    size_t pos = 0;
+    int ret;
+
+    f.skip = i;
+    f.count = 1;
+    f.n = 0;
+    f.dents = dent;
+    ret = ext2_dir_foreach((struct ext2_inode *)dir->inod, &pos, dir_fill, &f);
+    if (ret >= 0)
+        ret = (f.n == 1) ? 0 : -1;
+    return ret;
+}
+
+static int ext2_dentry_getdents(struct dentry *dir, size_t *pos,
+                                struct dirent *dents, unsigned int count)
+{
+    struct dir_fill f;
+    int ret;
+
+    f.skip = 0;
+    f.count = count;
+    f.n = 0;
+    f.dents = dents;
+    ret = ext2_dir_foreach((struct ext2_inode *)dir->inod, pos, dir_fill, &f);
+    if (ret >= 0)
+        ret = f.n;
+    return ret;
 }
 
 static const struct dentry_ops ext2_dentry_ops = {
-    .readdir = ext2_dentry_readdir
+    .readdir  = ext2_dentry_readdir,
+    .getdents = ext2_dentry_getdents,
 };
 
 
@@ -332,33 +1344,56 @@ static struct inode *ext2_super_inode_alloc(struct super_block *sb)
 
     inod = (struct inode *)kmalloc(sizeof(struct ext2_inode), 0);
     if (inod != NULL)
-        memset(inod, 0, sizeof(*inod));
+        memset(inod, 0, sizeof(struct ext2_inode));
     return inod;
 }
 
 static void ext2_super_inode_free(struct inode *inod)
 {
+    struct ext2_inode *ei = (struct ext2_inode *)inod;
+
+    if (ei->unlinked != 0) {
+        if (S_ISREG(inod->mode) || S_ISDIR(inod->mode))
+            ext2_truncate(inod, 0);
+        ext2_ifree(EXT2_SB(inod->sb), inod->ino, inod->mode);
+    }
+    ext2_dir_index_drop(ei);
     kfree(inod, sizeof(struct ext2_inode));
 }
 
 /*
- * Fetch inode information from the device.
+ * Get the buffer holding an inode on-disk structure.
+ * On success '*ind' is set to the structure offset within the buffer.
  */
-static int ext2_super_inode_read(struct inode *inod)
+static struct buf *ext2_inode_buf(const struct inode *inod, size_t *ind)
 {
-    int n;
-    struct ext2_disk_inode disk_inod;
-    const struct ext2_super_block *sb = (struct ext2_super_block *) inod->sb;
+    const struct ext2_super_block *sb = EXT2_SB(inod->sb);
     int group = ((inod->ino - 1) / sb->inodes_per_group);
     const struct ext2_group_desc *gd = &sb->gd_table[group];
     int table_index = (inod->ino - 1 ) % sb->inodes_per_group;
-    int blockno = ((table_index * 128) / 1024 ) + gd->inode_table;
-    int ind = table_index % (1024 /128);
+    int blockno = ((table_index * sb->inode_size) / sb->block_size) +
+                  gd->inode_table;
 
-    n = devfs_read(sb->base.dev, &disk_inod, sizeof(disk_inod),
-                   blockno * 1024 + ind*sizeof(disk_inod));
-    if (n != sizeof(disk_inod))
+    /* Extra fields of bigger inodes are left untouched */
+    *ind = (table_index % (sb->block_size / sb->inode_size)) *
+           sb->inode_size;
+    return bread(sb->base.dev, blockno, sb->block_size);
+}
+
+/*
+ * Fetch inode information from the device.
+ */
+static int ext2_super_inode_read(struct inode *inod)
+{
+    struct buf *b;
+    struct ext2_disk_inode disk_inod;
+    size_t ind;
+
+    b = ext2_inode_buf(inod, &ind);
+    if (b == NULL)
         return -1;
+    memcpy(&disk_inod, b->data + ind, sizeof(disk_inod));
+    brelse(b);
 
     inod->ops = &ext2_inode_ops;
     inod->mode = disk_inod.mode;
@@ -378,16 +1413,53 @@ static int ext2_super_inode_read(struct inode *inod)
 
     memcpy(((struct ext2_inode *)inod)->blocks, disk_inod.block,
             sizeof(disk_inod.block));
+    ((struct ext2_inode *)inod)->links = disk_inod.links_count;
+    ((struct ext2_inode *)inod)->nsectors = disk_inod.blocks;
 
     return 0;
 }
 
+/*
+ * Update the on-disk inode (in the buffer cache).
+ */
+static int ext2_super_inode_write(struct inode *inod)
+{
+    struct ext2_inode *ei = (struct ext2_inode *)inod;
+    struct ext2_disk_inode *disk_inod;
+    struct buf *b;
+    size_t ind;
+
+    b = ext2_inode_buf(inod, &ind);
+    if (b == NULL)
+        return -EIO;
+    disk_inod = (struct ext2_disk_inode *)(b->data + ind);
+    disk_inod->mode = inod->mode;
+    disk_inod->uid = inod->uid;
+    disk_inod->gid = inod->gid;
+    disk_inod->size = inod->size;
+    disk_inod->atime = inod->atime;
+    disk_inod->mtime = inod->mtime;
+    disk_inod->ctime = inod->ctime;
+    disk_inod->links_count = ei->links;
+    disk_inod->blocks = ei->nsectors;
+    disk_inod->dtime = 0;
+    if (S_ISCHR(inod->mode) || S_ISBLK(inod->mode)) {
+        memset(disk_inod->block, 0, sizeof(disk_inod->block));
+        disk_inod->block[0] = inod->rdev;
+    } else {
+        memcpy(disk_inod->block, ei->blocks, sizeof(disk_inod->block));
+    }
+    bdirty(b);
+    brelse(b);
+    return 0;
+}
 
 static const struct super_ops ext2_sb_ops =
 {
     .inode_alloc = ext2_super_inode_alloc,
     .inode_free  = ext2_super_inode_free,
     .inode_read  = ext2_super_inode_read,
+    .inode_write = ext2_super_inode_write,
 };
 
 
@@ -402,32 +1474,74 @@ struct super_block *ext2_super_create(dev_t dev)
     struct dentry *droot;
     unsigned int num_groups;
     struct ext2_disk_super_block dsb;
-    uint32_t gd_block;
+    struct buf *b;
+    size_t off, len;
 
-    if (devfs_read(dev, &dsb, sizeof(dsb), 1024) != sizeof(dsb))
+    /* The super block is always 1024 bytes from the device start */
+    b = bread(dev, 1, sizeof(dsb));
+    if (b == NULL)
         return NULL;
+    memcpy(&dsb, b->data, sizeof(dsb));
+    brelse(b);
 
     if (dsb.magic != EXT2_MAGIC)
         return NULL;
+    if ((1024 << dsb.log_block_size) > BUF_SIZE_MAX)
+        return NULL;    /* Not cacheable */
+    if (dsb.rev_level >= EXT2_DYNAMIC_REV &&
+        (dsb.inode_size < EXT2_GOOD_OLD_INODE_SIZE ||
+         (dsb.inode_size & (dsb.inode_size - 1)) != 0 ||
+         dsb.inode_size > (1024 << dsb.log_block_size)))
+        return NULL;
 
     sb = (struct ext2_super_block *)kmalloc(sizeof(struct ext2_super_block), 0);
     if (sb == NULL)
         return NULL;
 
     sb->inodes_per_group = dsb.inodes_per_group;
+    sb->blocks_per_group = dsb.blocks_per_group;
     sb->base.dev = dev;
     sb->log_block_size = dsb.log_block_size;
     sb->block_size = 1024 << dsb.log_block_size;
-    gd_block = (dsb.log_block_size == 0) ? (uint32_t)3 : (uint32_t)2;
-    num_groups = (dsb.blocks_count - 1) / dsb.blocks_per_group + 1;
+    if (dsb.rev_level >= EXT2_DYNAMIC_REV) {
+        sb->inode_size = dsb.inode_size;
+        sb->first_ino = dsb.first_ino;
+    } else {
+        sb->inode_size = EXT2_GOOD_OLD_INODE_SIZE;
+        sb->first_ino = EXT2_GOOD_OLD_FIRST_INO;
+    }
+    sb->first_data_block = dsb.first_data_block;
+    sb->blocks_count = dsb.blocks_count;
+    sb->free_blocks_count = dsb.free_blocks_count;
+    sb->free_inodes_count = dsb.free_inodes_count;
+    sb->feature_incompat = (dsb.rev_level >= EXT2_DYNAMIC_REV) ?
+                           dsb.feature_incompat : 0;
+    /*
+     * Group descriptors follow the super block: block 2 with 1 KiB blocks
+     * (block 0 is the boot block), block 1 otherwise.
+     */
+    sb->gd_block = dsb.first_data_block + 1;
+    num_groups = (dsb.blocks_count - dsb.first_data_block - 1) /
+                 dsb.blocks_per_group + 1;
+    sb->num_groups = num_groups;
+    /* The super block was read, thus the driver is there */
+    sb->bdev = dev_ops_get(S_IFBLK, dev);
+    sb->dax = (sb->bdev->direct != NULL &&
+               sb->bdev->direct(dev, sb->block_size, 0) != NULL);
 
     n = sizeof(struct ext2_group_desc) * num_groups;
     sb->gd_table = (struct ext2_group_desc *)kmalloc(n, 0);
     if (sb->gd_table == NULL)
         return NULL;
 
-    if (devfs_read(dev, sb->gd_table, n, sb->block_size*(gd_block-1)) != n)
-        return NULL;
+    for (off = 0; off < n; off += len) {
+        b = bread(dev, sb->gd_block + off / sb->block_size, sb->block_size);
+        if (b == NULL)
+            return NULL;
+        len = MIN(sb->block_size, n - off);
+        memcpy((char *)sb->gd_table + off, b->data, len);
+        brelse(b);
+    }
 
     droot = dentry_create("/", NULL, &ext2_dentry_ops);
     super_init(&sb->base, dev, droot, &ext2_sb_ops);
@@ -0,0 +1,510 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Process file system.
+ *
+ * Kernel and processes statistics as text files, whose content is
+ * generated on read. Inode numbers encode the process ID and the file
+ * type, thus nothing is stored.
+ */
+
+#include "procfs.h"
+#include "fs/vfs.h"
+#include "mm/frame.h"
+#include "proc.h"
+#include "timer.h"
+#include "kmalloc.h"
+#include "util.h"
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include "arch/x86/paging.h"
+#include "arch/x86/tsc.h"
+#include "isr.h"
+
+#define PROCFS_DEV          0x00FF  /* Anonymous device number */
+
+/* Generated content buffer size */
+#define PROC_BUF_SIZE       4096
+
+/*
+ * Inode numbers.
+ * Process entries are '((pid + 1) << 4) | type', global entries have
+ * the process part set to zero.
+ */
+#define PROC_INO(pid, type) ((ino_t)((((pid) + 1) << 4) | (type)))
+#define PROC_INO_PID(ino)   ((pid_t)((ino) >> 4) - 1)
+#define PROC_INO_TYPE(ino)  ((ino) & 0x0F)
+#define PROC_PID_MAX        4094    /* Greater pids are not listed */
+
+#define PROC_ROOT_INO       PROC_INO(-1, 1)
+
+/* Generated content */
+struct proc_buf {
+    char    *data;
+    size_t  len;
+};
+
+/* Entry generating its content */
+struct proc_entry {
+    const char  *name;
+    void        (* show)(struct proc_buf *pb, const struct task *t);
+};
+
+static struct super_block *procfs_sb;
+
+static const struct inode_ops procfs_inode_ops;
+static const struct dentry_ops procfs_dentry_ops;
+
+
+static void proc_printf(struct proc_buf *pb, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(pb->data + pb->len, PROC_BUF_SIZE - pb->len, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        pb->len = MIN(pb->len + n, PROC_BUF_SIZE - 1);
+}
+
+/* Fixed point value with two decimals */
+#define FIXED_INT(v)    ((unsigned int)((v) >> LOAD_FSHIFT))
+#define FIXED_FRAC(v)   ((unsigned int)((((v) & (LOAD_FIXED_1 - 1)) * 100) \
+                                        >> LOAD_FSHIFT))
+
+
+/******************************************************************************
+ *  Global entries
+ ******************************************************************************/
+
+static void show_meminfo(struct proc_buf *pb, const struct task *t)
+{
+    const struct zone_st *zone;
+    size_t total = 0, free = 0, low_total = 0, low_free = 0;
+    size_t zfree, n;
+    unsigned int i, order;
+
+    for (i = 0; (zone = frame_zone_get(i)) != NULL; i++) {
+        zfree = 0;
+        for (order = 0; order <= zone->buddy.order_max; order++) {
+            n = buddy_free_count(&zone->buddy, order);
+            zfree += (n << order) * zone->frame_size;
+        }
+        total += zone->size;
+        free += zfree;
+        if (zone->flags == ZONE_LOW) {
+            low_total += zone->size;
+            low_free += zfree;
+        }
+    }
+    proc_printf(pb, "MemTotal: %u kB\n", (unsigned int)(total / 1024));
+    proc_printf(pb, "MemFree:  %u kB\n", (unsigned int)(free / 1024));
+    proc_printf(pb, "LowTotal: %u kB\n", (unsigned int)(low_total / 1024));
+    proc_printf(pb, "LowFree:  %u kB\n", (unsigned int)(low_free / 1024));
+}
+
+static void show_buddyinfo(struct proc_buf *pb, const struct task *t)
+{
+    const struct zone_st *zone;
+    unsigned int i, order;
+
+    for (i = 0; (zone = frame_zone_get(i)) != NULL; i++) {
+        proc_printf(pb, "Zone %s", (zone->flags == ZONE_LOW) ? "low " : "high");
+        for (order = 0; order <= zone->buddy.order_max; order++)
+            proc_printf(pb, " %u", buddy_free_count(&zone->buddy, order));
+        proc_printf(pb, "\n");
+    }
+}
+
+/* Seconds since boot and idle task time */
+static void show_uptime(struct proc_buf *pb, const struct task *t)
+{
+    unsigned int idle = (unsigned int)(tsc_to_usecs(ktask.stime) / 10000);
+
+    proc_printf(pb, "%u.%02u %u.%02u\n",
+                (unsigned int)(timer_ticks / CLOCKS_PER_SEC),
+                (unsigned int)(timer_ticks % CLOCKS_PER_SEC) * 100 /
+                CLOCKS_PER_SEC, idle / 100, idle % 100);
+}
+
+static void show_loadavg(struct proc_buf *pb, const struct task *t)
+{
+    const struct task *curr = &ktask;
+    unsigned int running = 0, total = 0;
+    pid_t last = 0;
+
+    do {
+        if (curr->state == TASK_RUNNING)
+            running++;
+        total++;
+        last = MAX(last, curr->pid);
+        curr = list_container(curr->tasks.next, struct task, tasks);
+    } while (curr != &ktask);
+    proc_printf(pb, "%u.%02u %u.%02u %u.%02u %u/%u %d\n",
+                FIXED_INT(sched_loadavg[0]), FIXED_FRAC(sched_loadavg[0]),
+                FIXED_INT(sched_loadavg[1]), FIXED_FRAC(sched_loadavg[1]),
+                FIXED_INT(sched_loadavg[2]), FIXED_FRAC(sched_loadavg[2]),
+                running, total, last);
+}
+
+/* Interrupts counts: IRQ lines, local timer, page faults and syscalls */
+static void show_interrupts(struct proc_buf *pb, const struct task *t)
+{
+    unsigned int i;
+
+    for (i = ISR_IRQ0; i < ISR_IRQ0 + 16; i++) {
+        if (isr_count(i) != 0)
+            proc_printf(pb, "IRQ%-3u %u\n", i - ISR_IRQ0,
+                        (unsigned int)isr_count(i));
+    }
+    proc_printf(pb, "LOC    %u\n", (unsigned int)isr_count(ISR_LAPIC_TIMER));
+    proc_printf(pb, "PF     %u\n", (unsigned int)isr_count(ISR_PAGE_FAULT));
+    proc_printf(pb, "SYS    %u\n", (unsigned int)isr_count(ISR_SYSCALL));
+}
+
+/* Indexed by inode type, the first is the root directory */
+static const struct proc_entry proc_global[] = {
+    { NULL,         NULL },
+    { NULL,         NULL },
+    { "meminfo",    show_meminfo },
+    { "buddyinfo",  show_buddyinfo },
+    { "uptime",     show_uptime },
+    { "loadavg",    show_loadavg },
+    { "interrupts", show_interrupts },
+};
+
+#define PROC_GLOBAL_FIRST   2
+#define PROC_GLOBAL_NUM     (sizeof(proc_global) / sizeof(*proc_global))
+
+
+/******************************************************************************
+ *  Process entries
+ ******************************************************************************/
+
+static char task_state(const struct task *t)
+{
+    switch (t->state) {
+    case TASK_RUNNING:
+        return 'R';
+    case TASK_SLEEPING:
+        return 'S';
+    case TASK_ZOMBIE:
+        return 'Z';
+    default:
+        return 'U';
+    }
+}
+
+static unsigned int task_nfds(const struct task *t)
+{
+    unsigned int i, n = 0;
+
+    for (i = 0; i < OPEN_MAX; i++) {
+        if (t->fds[i].fil != NULL)
+            n++;
+    }
+    return n;
+}
+
+/*
+ * Single line, space separated:
+ * pid state ppid pgid uid usage brk rss faults fds name
+ */
+static void show_stat(struct proc_buf *pb, const struct task *t)
+{
+    proc_printf(pb, "%d %c %d %d %u %u %u %u %u %u %s\n",
+                t->pid, task_state(t), t->pptr->pid, t->pgid, t->uid,
+                (unsigned int)sched_acct_ticks(t->utime + t->stime),
+                (unsigned int)t->brk,
+                page_dir_rss(t->arch.pgdir), (unsigned int)t->faults,
+                task_nfds(t), t->comm);
+}
+
+static void show_status(struct proc_buf *pb, const struct task *t)
+{
+    unsigned int i;
+
+    proc_printf(pb, "Name:   %s\n", t->comm);
+    proc_printf(pb, "State:  %c\n", task_state(t));
+    proc_printf(pb, "Pid:    %d\n", t->pid);
+    proc_printf(pb, "PPid:   %d\n", t->pptr->pid);
+    proc_printf(pb, "PGid:   %d\n", t->pgid);
+    proc_printf(pb, "Uid:    %u %u\n", t->uid, t->euid);
+    proc_printf(pb, "Gid:    %u %u\n", t->gid, t->egid);
+    proc_printf(pb, "Nice:   %d\n", t->nice);
+    proc_printf(pb, "Policy: %s %d\n", (t->policy == SCHED_FIFO) ? "FIFO" :
+                (t->policy == SCHED_RR) ? "RR" : "OTHER", t->rt_priority);
+    proc_printf(pb, "Utime:  %u us\n", (unsigned int)tsc_to_usecs(t->utime));
+    proc_printf(pb, "Stime:  %u us\n", (unsigned int)tsc_to_usecs(t->stime));
+    proc_printf(pb, "Csw:    %u voluntary, %u involuntary\n",
+                (unsigned int)t->nvcsw, (unsigned int)t->nivcsw);
+    proc_printf(pb, "Brk:    %x\n", (unsigned int)t->brk);
+    proc_printf(pb, "RSS:    %u kB\n",
+                page_dir_rss(t->arch.pgdir) * (PAGE_SIZE / 1024));
+    proc_printf(pb, "Faults: %u\n", (unsigned int)t->faults);
+    proc_printf(pb, "FDs:   ");
+    for (i = 0; i < OPEN_MAX; i++) {
+        if (t->fds[i].fil != NULL)
+            proc_printf(pb, " %u", i);
+    }
+    proc_printf(pb, "\n");
+}
+
+/* Indexed by inode type, the first is the process directory */
+static const struct proc_entry proc_task[] = {
+    { NULL,         NULL },
+    { "stat",       show_stat },
+    { "status",     show_status },
+};
+
+#define PROC_TASK_FIRST     1
+#define PROC_TASK_NUM       (sizeof(proc_task) / sizeof(*proc_task))
+
+/*
+ * Get the task of a process entry, NULL if is gone.
+ */
+static struct task *proc_task_get(ino_t ino)
+{
+    pid_t pid = PROC_INO_PID(ino);
+
+    return (pid >= 0) ? task_find(pid) : NULL;
+}
+
+
+/******************************************************************************
+ *  Inode operations
+ ******************************************************************************/
+
+static ssize_t procfs_read(struct inode *inod, void *buf,
+                           size_t count, size_t off)
+{
+    const struct proc_entry *ent;
+    const struct task *t = NULL;
+    struct proc_buf pb;
+
+    if (PROC_INO_PID(inod->ino) < 0) {
+        ent = &proc_global[PROC_INO_TYPE(inod->ino)];
+    } else {
+        t = proc_task_get(inod->ino);
+        if (t == NULL)
+            return -ESRCH;
+        ent = &proc_task[PROC_INO_TYPE(inod->ino)];
+    }
+
+    /* Always generated from scratch, the data may change between reads */
+    pb.data = kmalloc(PROC_BUF_SIZE, 0);
+    if (pb.data == NULL)
+        return -ENOMEM;
+    pb.len = 0;
+    ent->show(&pb, t);
+    if (off < pb.len) {
+        count = MIN(count, pb.len - off);
+        memcpy(buf, pb.data + off, count);
+    } else {
+        count = 0;
+    }
+    kfree(pb.data, PROC_BUF_SIZE);
+    return count;
+}
+
+static ssize_t procfs_write(struct inode *inod, const void *buf,
+                            size_t count, size_t off)
+{
+    return -EPERM;
+}
+
+static struct inode *procfs_lookup(struct inode *dir, const char *name)
+{
+    struct inode *inod;
+    const char *s;
+    ino_t ino = 0;
+    pid_t pid = 0;
+    unsigned int i;
+
+    if (dir->ino == PROC_ROOT_INO) {
+        for (i = PROC_GLOBAL_FIRST; i < PROC_GLOBAL_NUM; i++) {
+            if (strcmp(name, proc_global[i].name) == 0)
+                ino = PROC_INO(-1, i);
+        }
+        if (ino == 0 && *name != '\0') {
+            for (s = name; *s >= '0' && *s <= '9' && pid <= PROC_PID_MAX; s++)
+                pid = pid * 10 + (*s - '0');
+            if (*s == '\0' && pid <= PROC_PID_MAX && task_find(pid) != NULL)
+                ino = PROC_INO(pid, 0);
+        }
+    } else if (proc_task_get(dir->ino) != NULL) {
+        for (i = PROC_TASK_FIRST; i < PROC_TASK_NUM; i++) {
+            if (strcmp(name, proc_task[i].name) == 0)
+                ino = dir->ino | i;
+        }
+    }
+    if (ino == 0)
+        return NULL;
+    inod = iget(dir->sb, ino);
+    if (inod != NULL)
+        inod->ref--; /* iget incremented the counter... release it */
+    return inod;
+}
+
+static const struct inode_ops procfs_inode_ops = {
+    .read   = procfs_read,
+    .write  = procfs_write,
+    .lookup = procfs_lookup,
+};
+
+
+/******************************************************************************
+ *  Dentry operations
+ ******************************************************************************/
+
+static void dirent_set(struct dirent *dent, ino_t ino, const char *name)
+{
+    dent->d_ino = ino;
+    strncpy(dent->d_name, name, NAME_MAX);
+    dent->d_name[NAME_MAX] = '\0';
+}
+
+/*
+ * The directory position is the entry index, '.' and '..' included.
+ * Processes are listed after the global entries, in the tasks list order.
+ */
+static int procfs_dentry_getdents(struct dentry *dir, size_t *pos,
+                                  struct dirent *dents, unsigned int count)
+{
+    const struct inode *inod = dir->inod;
+    const struct task *t;
+    unsigned int n = 0;
+    size_t i;
+    char name[12];
+
+    if (inod->ino != PROC_ROOT_INO && proc_task_get(inod->ino) == NULL)
+        return 0;   /* The process is gone */
+
+    for (; n < count; (*pos)++) {
+        if (*pos == 0) {
+            dirent_set(&dents[n++], inod->ino, ".");
+        } else if (*pos == 1) {
+            dirent_set(&dents[n++], PROC_ROOT_INO, "..");
+        } else if (inod->ino != PROC_ROOT_INO) {
+            i = *pos - 2 + PROC_TASK_FIRST;
+            if (i >= PROC_TASK_NUM)
+                break;
+            dirent_set(&dents[n++], inod->ino | i, proc_task[i].name);
+        } else if (*pos - 2 + PROC_GLOBAL_FIRST < PROC_GLOBAL_NUM) {
+            i = *pos - 2 + PROC_GLOBAL_FIRST;
+            dirent_set(&dents[n++], PROC_INO(-1, i), proc_global[i].name);
+        } else {
+            /* Tasks, the list may change between calls */
+            i = *pos - 2 - (PROC_GLOBAL_NUM - PROC_GLOBAL_FIRST);
+            t = &ktask;
+            while (i-- > 0) {
+                t = list_container(t->tasks.next, struct task, tasks);
+                if (t == &ktask)
+                    break;
+            }
+            if (i != (size_t)-1)
+                break;
+            if (t->pid <= PROC_PID_MAX) {
+                snprintf(name, sizeof(name), "%d", t->pid);
+                dirent_set(&dents[n++], PROC_INO(t->pid, 0), name);
+            }
+        }
+    }
+    return n;
+}
+
+static int procfs_dentry_readdir(struct dentry *dir, unsigned int i,
+                                 struct dirent *dent)
+{
+    size_t pos = i;
+
+    return (procfs_dentry_getdents(dir, &pos, dent, 1) == 1) ? 0 : -1;
+}
+
+/*
+ * Entries of terminated processes are stale.
+ */
+static int procfs_dentry_revalidate(struct dentry *dent)
+{
+    return (PROC_INO_PID(dent->inod->ino) < 0 ||
+            proc_task_get(dent->inod->ino) != NULL);
+}
+
+static const struct dentry_ops procfs_dentry_ops = {
+    .readdir    = procfs_dentry_readdir,
+    .getdents   = procfs_dentry_getdents,
+    .revalidate = procfs_dentry_revalidate,
+};
+
+
+/******************************************************************************
+ *  Superblock operations
+ ******************************************************************************/
+
+static int procfs_super_inode_read(struct inode *inod)
+{
+    if (PROC_INO_TYPE(inod->ino) == 0 || inod->ino == PROC_ROOT_INO)
+        inod->mode = S_IFDIR | 0555;
+    else
+        inod->mode = S_IFREG | 0444;
+    inod->ops = &procfs_inode_ops;
+    return 0;
+}
+
+static const struct super_ops procfs_sb_ops = {
+    .inode_read = procfs_super_inode_read,
+};
+
+
+struct super_block *procfs_super_create(dev_t dev)
+{
+    struct inode *iroot;
+    struct dentry *droot;
+
+    if (procfs_sb != NULL)
+        return procfs_sb;
+
+    procfs_sb = kmalloc(sizeof(*procfs_sb), 0);
+    if (procfs_sb == NULL)
+        return NULL;
+    droot = dentry_create("/", NULL, &procfs_dentry_ops);
+    if (droot == NULL) {
+        kfree(procfs_sb, sizeof(*procfs_sb));
+        procfs_sb = NULL;
+        return NULL;
+    }
+    super_init(procfs_sb, PROCFS_DEV, droot, &procfs_sb_ops);
+    iroot = inode_create(procfs_sb, PROC_ROOT_INO, S_IFDIR, &procfs_inode_ops);
+    droot->inod = idup(iroot);
+    return procfs_sb;
+}
+
+void procfs_task_exit(pid_t pid)
+{
+    char name[12];
+
+    if (procfs_sb == NULL || pid > PROC_PID_MAX)
+        return;
+    snprintf(name, sizeof(name), "%d", pid);
+    dentry_drop(procfs_sb->root, name);
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_FS_PROCFS_H_
+#define BEEOS_FS_PROCFS_H_
+
+#include "fs/vfs.h"
+
+/**
+ * Get the process file system super block.
+ * There is a single instance, created by the first call.
+ *
+ * @param dev   Ignored.
+ * @return      Super block or NULL if out of memory.
+ */
+struct super_block *procfs_super_create(dev_t dev);
+
+/**
+ * Drop the cached directory of a reaped process.
+ *
+ * @param pid   Process identifier.
+ */
+void procfs_task_exit(pid_t pid);
+
+#endif /* BEEOS_FS_PROCFS_H_ */
@@ -1,3 +1,3 @@
 
-local_sources := vfs.c
-dirs := devfs ext2
+local_sources := vfs.c buf.c
+dirs := devfs ext2 crfs tmpfs procfs
@@ -0,0 +1,467 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Memory file system.
+ *
+ * Files data lives in page frames, indexed by a per inode pages table
+ * (zero entries are holes). Frames are taken from any zone and mapped
+ * on access, the low memory is left to the kernel. Inodes and directory
+ * entries exist only in memory: each directory entry holds a reference
+ * to its inode, dropped on unlink, thus an inode is released with its
+ * last user.
+ */
+
+#include "tmpfs.h"
+#include "fs/vfs.h"
+#include "mm/frame.h"
+#include "kmalloc.h"
+#include "proc.h"
+#include "dev.h"
+#include "list.h"
+#include "util.h"
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+#include "arch/x86/paging.h"
+#include "arch/x86/paging_bits.h"
+
+/*
+ * Anonymous device numbers, major 0 (minor 0 is the devfs).
+ * Inodes are cached by device, thus each instance requires its own.
+ */
+#define TMPFS_DEV_FIRST     0x0001
+#define TMPFS_DEV_LAST      0x00FE  /* 0x00FF is the procfs */
+
+struct tmpfs_super_block {
+    struct super_block  base;
+    size_t              pages_max;  /* size limit */
+    size_t              pages;      /* pages in use */
+    ino_t               ino_next;   /* last assigned inode number */
+};
+
+struct tmpfs_dirent {
+    struct list_link    link;
+    struct inode        *inod;
+    char                name[NAME_MAX];
+};
+
+struct tmpfs_inode {
+    struct inode        base;
+    ino_t               parent;     /* parent directory inode number */
+    struct list_link    entries;    /* directory entries */
+    uint32_t            *pages;     /* file data frames table */
+    size_t              npages;     /* pages table length */
+};
+
+#define TMPFS_SB(sb)    ((struct tmpfs_super_block *)(sb))
+
+static dev_t tmpfs_dev = TMPFS_DEV_FIRST - 1;
+
+static const struct inode_ops tmpfs_inode_ops;
+static const struct dentry_ops tmpfs_dentry_ops;
+
+
+/******************************************************************************
+ *  Data pages
+ ******************************************************************************/
+
+static void tmpfs_page_free(struct tmpfs_inode *ti, size_t i)
+{
+    if (ti->pages[i] != 0) {
+        frame_free((void *)ti->pages[i], 0);
+        ti->pages[i] = 0;
+        TMPFS_SB(ti->base.sb)->pages--;
+    }
+}
+
+/*
+ * Get the page 'i' frame, allocated if not present. Zero if out of space.
+ */
+static uint32_t tmpfs_page_get(struct tmpfs_inode *ti, size_t i)
+{
+    struct tmpfs_super_block *sb = TMPFS_SB(ti->base.sb);
+    uint32_t *pages;
+    size_t n;
+    char *frame, *page;
+
+    if (i >= ti->npages) {
+        /* Grow the table, at least doubling it */
+        n = MAX(i + 1, ti->npages * 2);
+        pages = kmalloc(n * sizeof(*pages), 0);
+        if (pages == NULL)
+            return 0;
+        memset(pages, 0, n * sizeof(*pages));
+        if (ti->pages != NULL) {
+            memcpy(pages, ti->pages, ti->npages * sizeof(*pages));
+            kfree(ti->pages, ti->npages * sizeof(*pages));
+        }
+        ti->pages = pages;
+        ti->npages = n;
+    }
+    if (ti->pages[i] == 0) {
+        if (sb->pages >= sb->pages_max)
+            return 0;
+        frame = frame_alloc(0, 0);
+        if (frame == NULL)
+            return 0;
+        page = page_map_tmp((uint32_t)frame);
+        if (page == NULL) {
+            frame_free(frame, 0);
+            return 0;
+        }
+        memset(page, 0, PAGE_SIZE);
+        page_unmap_tmp();
+        ti->pages[i] = (uint32_t)frame;
+        sb->pages++;
+    }
+    return ti->pages[i];
+}
+
+
+/******************************************************************************
+ *  Inode operations
+ ******************************************************************************/
+
+static ssize_t tmpfs_read(struct tmpfs_inode *ti, void *buf,
+                          size_t count, size_t off)
+{
+    size_t left, i, poff, n;
+    char *page;
+
+    /* Device special files data are not stored in the file system */
+    if (S_ISCHR(ti->base.mode) || S_ISBLK(ti->base.mode))
+        return dev_read(ti->base.mode & S_IFMT, ti->base.rdev,
+                        buf, count, off);
+
+    if (ti->base.size < off)
+        return 0; /* EOF */
+    if (ti->base.size < off + count)
+        count = ti->base.size - off;
+
+    left = count;
+    while (left > 0) {
+        i = off / PAGE_SIZE;
+        poff = off % PAGE_SIZE;
+        n = MIN(left, PAGE_SIZE - poff);
+        if (i < ti->npages && ti->pages[i] != 0) {
+            page = page_map_tmp(ti->pages[i]);
+            if (page == NULL)
+                break;
+            memcpy(buf, page + poff, n);
+            page_unmap_tmp();
+        } else {
+            memset(buf, 0, n); /* Hole */
+        }
+        left -= n;
+        off += n;
+        buf = (char *)buf + n;
+    }
+    if (left == count && count != 0)
+        return -ENOMEM;
+    return count - left;
+}
+
+static ssize_t tmpfs_write(struct tmpfs_inode *ti, const void *buf,
+                           size_t count, size_t off)
+{
+    size_t left, poff, n;
+    uint32_t frame;
+    char *page;
+
+    if (S_ISCHR(ti->base.mode) || S_ISBLK(ti->base.mode))
+        return dev_write(ti->base.mode & S_IFMT, ti->base.rdev,
+                         buf, count, off);
+
+    left = count;
+    while (left > 0) {
+        frame = tmpfs_page_get(ti, off / PAGE_SIZE);
+        if (frame == 0)
+            break;
+        page = page_map_tmp(frame);
+        if (page == NULL)
+            break;
+        poff = off % PAGE_SIZE;
+        n = MIN(left, PAGE_SIZE - poff);
+        memcpy(page + poff, buf, n);
+        page_unmap_tmp();
+        left -= n;
+        off += n;
+        buf = (const char *)buf + n;
+    }
+    if (off > ti->base.size)
+        ti->base.size = off;
+    if (left == count && count != 0)
+        return -ENOSPC;
+    return count - left;
+}
+
+static int tmpfs_truncate(struct tmpfs_inode *ti, size_t size)
+{
+    size_t i, n;
+    char *page;
+
+    if (!S_ISREG(ti->base.mode))
+        return -EINVAL;
+    if (size < ti->base.size) {
+        n = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+        /* Clear the last page tail, may be exposed by a later extension */
+        if (size % PAGE_SIZE != 0 && n - 1 < ti->npages &&
+            ti->pages[n - 1] != 0) {
+            page = page_map_tmp(ti->pages[n - 1]);
+            if (page == NULL)
+                return -ENOMEM;
+            memset(page + size % PAGE_SIZE, 0,
+                   PAGE_SIZE - size % PAGE_SIZE);
+            page_unmap_tmp();
+        }
+        for (i = n; i < ti->npages; i++)
+            tmpfs_page_free(ti, i);
+    }
+    ti->base.size = size;   /* Extension is a hole */
+    return 0;
+}
+
+static struct tmpfs_dirent *tmpfs_dirent_find(struct tmpfs_inode *dir,
+                                              const char *name)
+{
+    struct list_link *curr;
+    struct tmpfs_dirent *ent;
+
+    for (curr = dir->entries.next; curr != &dir->entries;
+         curr = curr->next) {
+        ent = list_container(curr, struct tmpfs_dirent, link);
+        if (strcmp(ent->name, name) == 0)
+            return ent;
+    }
+    return NULL;
+}
+
+static struct inode *tmpfs_lookup(struct inode *dir, const char *name)
+{
+    struct tmpfs_dirent *ent;
+
+    ent = tmpfs_dirent_find((struct tmpfs_inode *)dir, name);
+    return (ent != NULL) ? ent->inod : NULL;
+}
+
+static int tmpfs_mknod(struct inode *idir, const char *name, mode_t mode,
+                       dev_t dev)
+{
+    struct tmpfs_super_block *sb = TMPFS_SB(idir->sb);
+    struct tmpfs_dirent *ent;
+    struct inode *inod;
+
+    if (!S_ISREG(mode) && !S_ISDIR(mode) && !S_ISCHR(mode) &&
+        !S_ISBLK(mode) && !S_ISFIFO(mode))
+        return -EPERM;
+    if (strlen(name) >= NAME_MAX)
+        return -ENAMETOOLONG;
+    if (tmpfs_dirent_find((struct tmpfs_inode *)idir, name) != NULL)
+        return -EEXIST;
+
+    ent = kmalloc(sizeof(*ent), 0);
+    if (ent == NULL)
+        return -ENOMEM;
+    inod = inode_create(&sb->base, ++sb->ino_next, mode, &tmpfs_inode_ops);
+    if (inod == NULL) {
+        kfree(ent, sizeof(*ent));
+        return -ENOMEM;
+    }
+    inod->uid = current->euid;
+    inod->gid = current->egid;
+    inod->rdev = (S_ISCHR(mode) || S_ISBLK(mode)) ? dev : 0;
+    ((struct tmpfs_inode *)inod)->parent = idir->ino;
+
+    /* The directory entry reference */
+    ent->inod = idup(inod);
+    strcpy(ent->name, name);
+    list_insert_before(&((struct tmpfs_inode *)idir)->entries, &ent->link);
+    return 0;
+}
+
+static int tmpfs_unlink(struct inode *idir, const char *name)
+{
+    struct tmpfs_dirent *ent;
+    struct tmpfs_inode *ti;
+
+    ent = tmpfs_dirent_find((struct tmpfs_inode *)idir, name);
+    if (ent == NULL)
+        return -ENOENT;
+    ti = (struct tmpfs_inode *)ent->inod;
+    if (S_ISDIR(ti->base.mode) && !list_empty(&ti->entries))
+        return -ENOTEMPTY;
+    list_delete(&ent->link);
+    /* Released here if not in use */
+    iput(ent->inod);
+    kfree(ent, sizeof(*ent));
+    return 0;
+}
+
+static const struct inode_ops tmpfs_inode_ops = {
+    .read      = (inode_read_t)tmpfs_read,
+    .write     = (inode_write_t)tmpfs_write,
+    .mknod     = tmpfs_mknod,
+    .lookup    = tmpfs_lookup,
+    .unlink    = tmpfs_unlink,
+    .truncate  = (inode_truncate_t)tmpfs_truncate,
+};
+
+
+/******************************************************************************
+ *  Dentry operations
+ ******************************************************************************/
+
+/*
+ * The directory position is the entry index, '.' and '..' included.
+ */
+static int tmpfs_dentry_getdents(struct dentry *dir, size_t *pos,
+                                 struct dirent *dents, unsigned int count)
+{
+    struct tmpfs_inode *ti = (struct tmpfs_inode *)dir->inod;
+    const struct list_link *curr;
+    const struct tmpfs_dirent *ent;
+    unsigned int n = 0;
+    size_t i;
+
+    while (n < count && *pos < 2) {
+        strcpy(dents[n].d_name, (*pos == 0) ? "." : "..");
+        dents[n].d_ino = (*pos == 0) ? ti->base.ino : ti->parent;
+        n++;
+        (*pos)++;
+    }
+    curr = ti->entries.next;
+    for (i = 2; i < *pos && curr != &ti->entries; i++)
+        curr = curr->next;
+    while (n < count && curr != &ti->entries) {
+        ent = list_container_const(curr, struct tmpfs_dirent, link);
+        strcpy(dents[n].d_name, ent->name);
+        dents[n].d_ino = ent->inod->ino;
+        n++;
+        (*pos)++;
+        curr = curr->next;
+    }
+    return n;
+}
+
+static int tmpfs_dentry_readdir(struct dentry *dir, unsigned int i,
+                                struct dirent *dent)
+{
+    size_t pos = i;
+
+    return (tmpfs_dentry_getdents(dir, &pos, dent, 1) == 1) ? 0 : -1;
+}
+
+static const struct dentry_ops tmpfs_dentry_ops = {
+    .readdir  = tmpfs_dentry_readdir,
+    .getdents = tmpfs_dentry_getdents,
+};
+
+
+/******************************************************************************
+ *  Superblock operations
+ ******************************************************************************/
+
+static struct inode *tmpfs_super_inode_alloc(struct super_block *sb)
+{
+    struct tmpfs_inode *ti;
+
+    ti = kmalloc(sizeof(*ti), 0);
+    if (ti != NULL) {
+        memset(ti, 0, sizeof(*ti));
+        list_init(&ti->entries);
+    }
+    return &ti->base;
+}
+
+static void tmpfs_super_inode_free(struct inode *inod)
+{
+    struct tmpfs_inode *ti = (struct tmpfs_inode *)inod;
+    size_t i;
+
+    for (i = 0; i < ti->npages; i++)
+        tmpfs_page_free(ti, i);
+    if (ti->pages != NULL)
+        kfree(ti->pages, ti->npages * sizeof(*ti->pages));
+    kfree(ti, sizeof(*ti));
+}
+
+static const struct super_ops tmpfs_sb_ops = {
+    .inode_alloc = tmpfs_super_inode_alloc,
+    .inode_free  = tmpfs_super_inode_free,
+};
+
+
+struct super_block *tmpfs_super_create(dev_t dev)
+{
+    struct tmpfs_super_block *sb;
+    struct inode *iroot;
+    struct dentry *droot;
+
+    if (tmpfs_dev == TMPFS_DEV_LAST)
+        return NULL;
+    sb = kmalloc(sizeof(*sb), 0);
+    if (sb == NULL)
+        return NULL;
+    memset(sb, 0, sizeof(*sb));
+    sb->pages_max = TMPFS_SIZE_DEFAULT / PAGE_SIZE;
+
+    droot = dentry_create("/", NULL, &tmpfs_dentry_ops);
+    if (droot == NULL) {
+        kfree(sb, sizeof(*sb));
+        return NULL;
+    }
+    super_init(&sb->base, ++tmpfs_dev, droot, &tmpfs_sb_ops);
+
+    iroot = inode_create(&sb->base, ++sb->ino_next, S_IFDIR | 0777,
+                         &tmpfs_inode_ops);
+    if (iroot == NULL) {
+        tmpfs_dev--;
+        dentry_delete(droot);
+        kfree(sb, sizeof(*sb));
+        return NULL;
+    }
+    ((struct tmpfs_inode *)iroot)->parent = iroot->ino;
+    droot->inod = idup(iroot);
+    return &sb->base;
+}
+
+int tmpfs_options(struct super_block *sb, const char *data)
+{
+    size_t size = 0;
+
+    if (data == NULL || *data == '\0')
+        return 0;
+    if (strncmp(data, "size=", 5) != 0)
+        return -EINVAL;
+    for (data += 5; *data >= '0' && *data <= '9'; data++)
+        size = size * 10 + (*data - '0');
+    if (*data == 'k' || *data == 'K') {
+        size *= 1024;
+        data++;
+    } else if (*data == 'm' || *data == 'M') {
+        size *= 1024 * 1024;
+        data++;
+    }
+    if (*data != '\0' || size < PAGE_SIZE)
+        return -EINVAL;
+    if (sb != NULL)
+        TMPFS_SB(sb)->pages_max = size / PAGE_SIZE;
+    return 0;
+}
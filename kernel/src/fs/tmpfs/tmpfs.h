@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_FS_TMPFS_H_
+#define BEEOS_FS_TMPFS_H_
+
+#include "fs/vfs.h"
+
+/** Default size limit of a tmpfs instance. */
+#define TMPFS_SIZE_DEFAULT  (1024 * 1024)
+
+/**
+ * Create a new, empty, tmpfs instance.
+ * Each call creates an independent file system.
+ *
+ * @param dev   Ignored, an anonymous device number is assigned.
+ * @return      Super block or NULL if out of memory.
+ */
+struct super_block *tmpfs_super_create(dev_t dev);
+
+/**
+ * Parse the mount options.
+ * The only option supported is "size=<bytes>[k|m]" (size limit).
+ *
+ * @param sb    tmpfs super block, NULL to only check the options.
+ * @param data  Options string (may be NULL).
+ * @return      0 on success, -EINVAL on bad options.
+ */
+int tmpfs_options(struct super_block *sb, const char *data);
+
+#endif /* BEEOS_FS_TMPFS_H_ */
@@ -18,12 +18,17 @@
  */
 
 #include "fs/vfs.h"
+#include "fs/buf.h"
 #include "fs/devfs/devfs.h"   /* devfs_super_create */
-#include "fs/ext2/ext2.h"    /* ext2_super_create */
+#include "fs/ext2/ext2.h"     /* ext2_super_create */
+#include "fs/crfs/crfs.h"     /* crfs_super_create */
+#include "fs/tmpfs/tmpfs.h"   /* tmpfs_super_create */
+#include "fs/procfs/procfs.h" /* procfs_super_create */
 #include "mm/slab.h"
 #include "kmalloc.h"
 #include "proc.h"
 #include "panic.h"
+#include "util.h"
 #include <limits.h>
 #include <errno.h>
 
@@ -31,11 +36,14 @@
 #include "kprintf.h"
 #endif
 
-#define FS_LIST_LEN 2
+#define FS_LIST_LEN 5
 
 static const struct vfs_type fs_list[FS_LIST_LEN] = {
-    { "ext2", ext2_super_create },
-    { "dev",  devfs_super_create }
+    { "ext2",  ext2_super_create },
+    { "crfs",  crfs_super_create },
+    { "tmpfs", tmpfs_super_create },
+    { "proc",  procfs_super_create },
+    { "dev",   devfs_super_create }
 };
 
 
@@ -74,7 +82,54 @@ static struct htable_link *inode_htable[1 << INODE_HTABLE_BITS];
 
 struct file *fs_file_alloc(void)
 {
-    return (struct file *)slab_cache_alloc(&file_cache, 0);
+    struct file *fil;
+
+    fil = (struct file *)slab_cache_alloc(&file_cache, 0);
+    if (fil != NULL) {
+        fil->ra_next = 0;
+        fil->ra_end = 0;
+        fil->ra_win = 0;
+    }
+    return fil;
+}
+
+/*
+ * Readahead window bounds. The max is kept well below the buffer cache
+ * capacity, otherwise the prefetched blocks evict each other.
+ */
+#define RA_WIN_MIN  (4 * 1024)
+#define RA_WIN_MAX  (32 * 1024)
+
+void vfs_readahead(struct file *fil, size_t count)
+{
+    struct inode *inod = fil->dent->inod;
+    size_t off = fil->off;
+    size_t start, end;
+
+    if (inod->ops->readahead == NULL)
+        return;
+
+    if (off != fil->ra_next) {
+        /* Random access, wait for a sequential read to restart */
+        fil->ra_win = 0;
+        fil->ra_end = off;
+        fil->ra_next = off + count;
+        return;
+    }
+    fil->ra_next = off + count;
+
+    /* Sequential, refill when less than half window is left ahead */
+    if (fil->ra_win != 0 && off + count + fil->ra_win / 2 <= fil->ra_end)
+        return;
+    fil->ra_win = (fil->ra_win == 0) ? RA_WIN_MIN :
+                  MIN(2 * fil->ra_win, RA_WIN_MAX);
+    start = MAX(fil->ra_end, off);
+    end = off + count + fil->ra_win;
+    if (end > inod->size)
+        end = inod->size;
+    if (start < end)
+        inod->ops->readahead(inod, start, end - start);
+    fil->ra_end = MAX(end, start);
 }
 
 void fs_file_free(struct file *fil)
@@ -175,6 +230,26 @@ struct inode *iget(struct super_block *sb, ino_t ino)
 }
 
 
+int vfs_getdents(struct dentry *dir, size_t *pos, struct dirent *dents,
+                 unsigned int count)
+{
+    unsigned int n;
+
+    if (!S_ISDIR(dir->inod->mode))
+        return -ENOTDIR;
+    if (dir->ops->getdents != NULL)
+        return dir->ops->getdents(dir, pos, dents, count);
+    if (dir->ops->readdir == NULL)
+        return -EINVAL;
+    for (n = 0; n < count; n++) {
+        if (dir->ops->readdir(dir, *pos, &dents[n]) != 0)
+            break;
+        (*pos)++;
+    }
+    return n;
+}
+
+
 /*
  * Copy the next path element from path into name.
  * Return a pointer to the element following the copied one.
@@ -230,6 +305,7 @@ struct dentry *dentry_create(const char *name, struct dentry *parent,
     list_init(&de->child);  /* Empty children list */
     list_insert_before(&de->parent->child, &de->link); /* Insert in the parent child  list */
     de->mounted = 0;
+    de->unlinked = 0;
     de->ops = ops;
     return de;
 }
@@ -272,12 +348,65 @@ static struct dentry *dentry_lookup(const struct dentry *dir, const char *name)
 }
 
 
+static void dentry_invalidate(struct dentry *dent);
+
+/*
+ * Release a detached unused entry.
+ * Unused children are released as well, the ones in use are detached
+ * and released by their last dput.
+ */
+static void dentry_release(struct dentry *dent)
+{
+    struct list_link *curr;
+    struct dentry *child;
+
+    curr = dent->child.next;
+    while (curr != &dent->child) {
+        child = list_container(curr, struct dentry, link);
+        curr = curr->next;
+        if (child->ref == 0 && child->mounted == 0) {
+            dentry_invalidate(child);
+        } else {
+            list_delete(&child->link);
+            child->unlinked = 1;
+            child->parent = NULL;
+        }
+    }
+    iput(dent->inod);
+    dentry_delete(dent);
+}
+
+/*
+ * Detach a stale entry, released with its last reference.
+ */
+static void dentry_invalidate(struct dentry *dent)
+{
+    list_delete(&dent->link);
+    dent->unlinked = 1;
+    if (dent->ref == 0)
+        dentry_release(dent);
+}
+
+void dentry_drop(struct dentry *dir, const char *name)
+{
+    struct dentry *dent;
+
+    dent = dentry_lookup(dir, name);
+    if (dent != NULL && dent->mounted == 0)
+        dentry_invalidate(dent);
+}
+
 struct dentry *dget(struct dentry *dir, const char *name)
 {
     struct dentry *dent;
     struct inode  *inod;
 
     dent = dentry_lookup(dir, name);
+    if (dent != NULL && dent->mounted == 0 && dent->ops->revalidate != NULL &&
+        dent->ops->revalidate(dent) == 0) {
+        dentry_invalidate(dent);
+        dent = NULL;
+    }
     if (dent == NULL) {
         inod = vfs_lookup(dir->inod, name);
         if (inod == NULL)
@@ -333,6 +462,12 @@ void dput(struct dentry *dent)
         kprintf("WARNING dref < 0\n");
 #endif
 
+    /* Detached dentries don't outlive their users */
+    if (dent->ref == 0 && dent->unlinked != 0) {
+        dentry_release(dent);
+        return;
+    }
+
 #if 0
     if (dent->ref == 0 && dentry_can_delete(dent) != 0) {
         if (dent->inod != NULL)
@@ -343,8 +478,43 @@ void dput(struct dentry *dent)
 }
 
 
+int vfs_unlink(struct dentry *dir, const char *name)
+{
+    struct dentry *dent;
+    int ret;
+
+    if (!S_ISDIR(dir->inod->mode))
+        return -ENOTDIR;
+    if (dir->inod->ops->unlink == NULL)
+        return -EPERM;
+    dent = dentry_lookup(dir, name);
+    if (dent != NULL && dent->mounted != 0)
+        return -EBUSY;
+    if (dent != NULL && dent->inod->textref != 0)
+        return -ETXTBSY;
+
+    ret = dir->inod->ops->unlink(dir->inod, name);
+    if (ret == 0 && dent != NULL) {
+        /* Not reachable by name anymore */
+        list_delete(&dent->link);
+        dent->unlinked = 1;
+        if (dent->ref == 0)
+            dentry_release(dent);
+    }
+    return ret;
+}
+
+
+/*
+ * Mounts are indexed twice, by mount point and by mount root, so that
+ * crossing a mount boundary in both directions doesn't require a scan.
+ * The key is the dentry address.
+ */
+#define MOUNT_HTABLE_BITS   4
+static struct htable_link *mntpt_htable[1 << MOUNT_HTABLE_BITS];
+static struct htable_link *mroot_htable[1 << MOUNT_HTABLE_BITS];
 
-static struct list_link mounts;
+#define DENTRY_KEY(dent)    ((long long)(uintptr_t)(dent))
 
 int do_mount(struct dentry *mntpt, struct dentry *root)
 {
@@ -355,30 +525,61 @@ int do_mount(struct dentry *mntpt, struct dentry *root)
         return -1;
     mnt->mntpt = ddup(mntpt);
     mnt->root  = ddup(root);
-    list_insert_after(&mounts, &mnt->link);
+    htable_insert(mntpt_htable, &mnt->mntpt_hlink, DENTRY_KEY(mntpt),
+                  MOUNT_HTABLE_BITS);
+    htable_insert(mroot_htable, &mnt->root_hlink, DENTRY_KEY(root),
+                  MOUNT_HTABLE_BITS);
     mntpt->mounted = 1;
     return 0;
 }
 
+/*
+ * Most recent mount with the given mount point.
+ * New entries are inserted in the bucket head, thus the first match wins.
+ */
+static const struct vfsmount *mount_by_mntpt(const struct dentry *mntpt)
+{
+    const struct htable_link *lnk;
+    const struct vfsmount *mnt;
+
+    lnk = htable_lookup(mntpt_htable, DENTRY_KEY(mntpt), MOUNT_HTABLE_BITS);
+    while (lnk != NULL) {
+        mnt = struct_ptr(lnk, struct vfsmount, mntpt_hlink);
+        if (mnt->mntpt == mntpt)
+            return mnt;
+        lnk = lnk->next;
+    }
+    return NULL;
+}
+
+/*
+ * Most recent mount with the given mount root.
+ */
+static const struct vfsmount *mount_by_root(const struct dentry *root)
+{
+    const struct htable_link *lnk;
+    const struct vfsmount *mnt;
+
+    lnk = htable_lookup(mroot_htable, DENTRY_KEY(root), MOUNT_HTABLE_BITS);
+    while (lnk != NULL) {
+        mnt = struct_ptr(lnk, struct vfsmount, root_hlink);
+        if (mnt->root == root)
+            return mnt;
+        lnk = lnk->next;
+    }
+    return NULL;
+}
+
 
 static struct dentry *follow_up(struct dentry *root)
 {
     struct dentry *res = root;
-    const struct list_link *curr;
     const struct vfsmount *mnt;
 
-    /* TODO: this is not efficient... use a hash map here */
-    curr = mounts.next;
-    while (curr != &mounts) {
-        mnt = list_container(curr, struct vfsmount, link);
-        if (mnt->root == res) {
-            dput(mnt->mntpt);
-            res = ddup(mnt->mntpt);
-            /* Reiterate to see if this is a also mount point */
-            curr = mounts.next;
-        } else {
-            curr = curr->next;
-        }
+    /* Reiterate while the mount point is also a mount root */
+    while ((mnt = mount_by_root(res)) != NULL) {
+        dput(mnt->mntpt);
+        res = ddup(mnt->mntpt);
     }
     return res;
 }
@@ -386,27 +587,50 @@ static struct dentry *follow_up(struct dentry *root)
 static struct dentry *follow_down(struct dentry *mntpt)
 {
     struct dentry *res = mntpt;
-    const struct list_link *curr;
     const struct vfsmount *mnt;
 
-    /* TODO: this is not efficient... use a hash map here */
-    curr = mounts.next;
-    while (curr != &mounts) {
-        mnt = list_container(curr, struct vfsmount, link);
-        if (mnt->mntpt == res) {
-            dput(res);
-            res = ddup(mnt->root);
-            /* Reiterate to see if this is a also mount point */
-            curr = mounts.next;
-        } else {
-            curr = curr->next;
-        }
+    /* Reiterate while the mount root is also a mount point */
+    while ((mnt = mount_by_mntpt(res)) != NULL) {
+        dput(res);
+        res = ddup(mnt->root);
     }
     return res;
 }
 
 
 
+int path_split(const char *path, char *parent, char *name)
+{
+    size_t i, end;
+
+    end = strlen(path);
+    while (end > 0 && path[end - 1] == '/')
+        end--;    /* Trailing slashes */
+    i = end;
+    while (i > 0 && path[i - 1] != '/')
+        i--;
+    if (end - i >= NAME_MAX)
+        return -ENAMETOOLONG;
+    if (end == i) {
+        strcpy(name, ".");
+    } else {
+        memcpy(name, path + i, end - i);
+        name[end - i] = '\0';
+    }
+
+    if (i == 0) {
+        strcpy(parent, ".");
+    } else {
+        while (i > 1 && path[i - 1] == '/')
+            i--;
+        if (i >= PATH_MAX)
+            return -ENAMETOOLONG;
+        memcpy(parent, path, i);
+        parent[i] = '\0';
+    }
+    return 0;
+}
+
 struct dentry *named(const char *path)
 {
     char name[NAME_MAX];
@@ -427,7 +651,8 @@ struct dentry *named(const char *path)
         } else if (strcmp(name, "..") == 0) {
             if (strcmp(dent->name, "/") == 0)
                 dent = follow_up(dent);
-            tmp = ddup(dent->parent);
+            /* Detached from a stale parent */
+            tmp = (dent->parent != NULL) ? ddup(dent->parent) : NULL;
         } else {
             if (dent->mounted != 0)
                 dent = follow_down(dent);
@@ -455,6 +680,10 @@ int dentry_path(struct dentry *dent, char *buf, size_t size)
     do {
         if (strcmp(curr->name, "/") == 0)
             curr = follow_up(curr);
+        if (curr->parent == NULL) {
+            res = -ENOENT;
+            break;
+        }
         if (curr == curr->parent)
             break;
 
@@ -491,5 +720,8 @@ void vfs_init(void)
 
     htable_init(inode_htable, INODE_HTABLE_BITS);
 
-    list_init(&mounts);
+    htable_init(mntpt_htable, MOUNT_HTABLE_BITS);
+    htable_init(mroot_htable, MOUNT_HTABLE_BITS);
+
+    buf_init();
 }
@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <errno.h>
 
 /*
  * Superblock declarations
@@ -88,6 +89,7 @@ struct inode {
     ino_t       ino;    /**< Inode number */
     size_t      size;   /**< File size in bytes. */
     int         ref;    /**< Reference counter. */
+    int         textref; /**< Processes running it with direct text */
     time_t      atime;  /**< Access time */
     time_t      mtime;  /**< Modification time */
     time_t      ctime;  /**< Creation time */
@@ -102,15 +104,38 @@ typedef int (* inode_read_t)(struct inode *inode, void *buf,
 typedef int (* inode_write_t)(struct inode *inode, const void *buf,
                               size_t count, size_t off);
 
-typedef int (* inode_mknod_t)(struct inode *idir, mode_t mode, dev_t dev);
+typedef int (* inode_mknod_t)(struct inode *idir, const char *name,
+                              mode_t mode, dev_t dev);
 
 typedef struct inode *(* inode_lookup_t)(struct inode *udir, const char *name);
 
+typedef int (* inode_unlink_t)(struct inode *idir, const char *name);
+
+typedef int (* inode_truncate_t)(struct inode *inode, size_t size);
+
+/*
+ * Start fetching the data in the range [off, off + count) into the
+ * file system cache. Just a hint, errors are ignored.
+ */
+typedef void (* inode_readahead_t)(struct inode *inode, size_t off,
+                                   size_t count);
+
+/*
+ * Get a pointer to the file data in the range [off, off + count), if
+ * stored contiguously in memory (e.g. on a ramdisk), NULL otherwise.
+ */
+typedef void *(* inode_direct_t)(struct inode *inode, size_t off,
+                                 size_t count);
+
 struct inode_ops {
     inode_read_t    read;
     inode_write_t   write;
     inode_mknod_t   mknod;
     inode_lookup_t  lookup;
+    inode_unlink_t  unlink;
+    inode_truncate_t truncate;
+    inode_readahead_t readahead;
+    inode_direct_t  direct;
 };
 
 
@@ -126,14 +151,32 @@ struct dentry {
     struct list_link  child;           /**< Children list (if is a dir) */
     struct list_link  link;            /**< Siblings link */
     unsigned char     mounted;         /**< Set to 1 if is a mount point */
+    unsigned char     unlinked;        /**< Set to 1 if removed from parent */
     const struct dentry_ops *ops;      /**< Dentry vfs operations */
 };
 
 typedef int (* dentry_readdir_t)(struct dentry *dir, unsigned int i,
                                  struct dirent *dent);
 
+/*
+ * Fill up to 'count' entries starting from the opaque directory position
+ * 'pos', which is advanced past the returned entries.
+ * Returns the number of entries, 0 at the end of the directory.
+ */
+typedef int (* dentry_getdents_t)(struct dentry *dir, size_t *pos,
+                                  struct dirent *dents, unsigned int count);
+
+/*
+ * Check if a cached entry is still valid, for file systems whose
+ * entries may disappear without an unlink (e.g. procfs).
+ * Returns zero if the entry is stale.
+ */
+typedef int (* dentry_revalidate_t)(struct dentry *dent);
+
 struct dentry_ops {
-    dentry_readdir_t readdir; /**< Read directory */
+    dentry_readdir_t    readdir;    /**< Read directory */
+    dentry_getdents_t   getdents;   /**< Read directory entries (optional) */
+    dentry_revalidate_t revalidate; /**< Check a cached entry (optional) */
 };
 
 
@@ -142,8 +185,11 @@ struct file {
     unsigned int   flags;   /**< File status flags and access modes. */
     unsigned int   ref;     /**< Reference counter. */
     mode_t         mode;    /**< File mode when a new file is created */
-    size_t         off;     /**< File position. */
+    size_t         off;     /**< File position (cursor for directories). */
     struct dentry *dent;    /**< Dentry reference. */
+    size_t         ra_next; /**< Expected offset of a sequential read. */
+    size_t         ra_end;  /**< End of the data already read ahead. */
+    size_t         ra_win;  /**< Readahead window (0 if not sequential). */
 };
 
 struct filedesc {
@@ -152,9 +198,10 @@ struct filedesc {
 };
 
 struct vfsmount {
-    struct dentry    *mntpt; /**< mount point */
-    struct dentry    *root;  /**< mount root */
-    struct list_link  link;  /**< link in the mounts list */
+    struct dentry      *mntpt;       /**< mount point */
+    struct dentry      *root;        /**< mount root */
+    struct htable_link  mntpt_hlink; /**< link in the mount points table */
+    struct htable_link  root_hlink;  /**< link in the mount roots table */
 };
 
 
@@ -179,15 +226,49 @@ static inline struct inode *vfs_lookup(struct inode *idir, const char *name)
     return iret;
 }
 
-static inline int vfs_mknod(struct inode *idir, mode_t mode, dev_t dev)
+static inline int vfs_mknod(struct inode *idir, const char *name,
+                            mode_t mode, dev_t dev)
 {
     int ret = -1;
 
     if (S_ISDIR(idir->mode) && idir->ops->mknod)
-        ret = idir->ops->mknod(idir, mode, dev);
+        ret = idir->ops->mknod(idir, name, mode, dev);
     return ret;
 }
 
+static inline void *vfs_direct(struct inode *node, size_t off, size_t count)
+{
+    void *ptr = NULL;
+
+    if (S_ISREG(node->mode) && node->ops->direct)
+        ptr = node->ops->direct(node, off, count);
+    return ptr;
+}
+
+static inline int vfs_truncate(struct inode *node, size_t size)
+{
+    int ret = -EINVAL;
+
+    if (node->textref != 0)
+        ret = -ETXTBSY;
+    else if (S_ISDIR(node->mode))
+        ret = -EISDIR;
+    else if (node->ops->truncate)
+        ret = node->ops->truncate(node, size);
+    return ret;
+}
+
+/**
+ * Remove a directory entry.
+ * The cached dentry, if any, is detached and released with its last
+ * reference, thus open files are still usable.
+ *
+ * @param dir   Parent directory dentry.
+ * @param name  Entry name.
+ * @return      0 on success or a negative error number.
+ */
+int vfs_unlink(struct dentry *dir, const char *name);
+
 static inline ssize_t vfs_read(struct inode *node, void *buf,
         size_t count, size_t offset)
 {
@@ -203,7 +284,9 @@ static inline ssize_t vfs_write(struct inode *node, const void *buf,
 {
     int ret = -1;
 
-    if (!S_ISDIR(node->mode) && node->ops->write)
+    if (node->textref != 0)
+        ret = -ETXTBSY;
+    else if (!S_ISDIR(node->mode) && node->ops->write)
         ret = node->ops->write(node, buf, count, offset);
     return ret;
 }
@@ -220,6 +303,22 @@ static inline int vfs_readdir(struct dentry *dir, int i, struct dirent *dent)
 }
 
 
+/**
+ * Read a batch of directory entries.
+ * If the file system doesn't provide a 'getdents' operation, 'pos' is
+ * interpreted as the index of the next entry to be fetched via 'readdir'.
+ *
+ * @param dir   Directory dentry.
+ * @param pos   Directory position, updated on return.
+ * @param dents Destination entries buffer.
+ * @param count Max number of entries.
+ * @return      Number of entries read, 0 at end of directory or a
+ *              negative error number.
+ */
+int vfs_getdents(struct dentry *dir, size_t *pos, struct dirent *dents,
+                 unsigned int count);
+
+
 struct inode *inode_create(struct super_block *sb, ino_t ino, mode_t mode,
                            const struct inode_ops *ops);
 
@@ -247,9 +346,30 @@ struct dentry *dentry_create(const char *name, struct dentry *parent,
 
 void dentry_delete(struct dentry *dent);
 
+/**
+ * Drop a cached child entry gone behind the vfs back (e.g. a procfs
+ * process directory). If in use it's released by the last dput.
+ *
+ * @param dir   Parent directory entry.
+ * @param name  Child name.
+ */
+void dentry_drop(struct dentry *dir, const char *name);
+
 
 struct dentry *named(const char *path);
 
+/**
+ * Split a path in parent directory and last element name.
+ * If the path has no directory part the parent is the current directory.
+ *
+ * @param path      Path.
+ * @param parent    Parent destination buffer (PATH_MAX).
+ * @param name      Name destination buffer (NAME_MAX).
+ * @return          0 on success, -ENAMETOOLONG if the parent or the name
+ *                  don't fit in the buffers.
+ */
+int path_split(const char *path, char *parent, char *name);
+
 struct dentry *dget(struct dentry *dir, const char *name);
 
 void dput(struct dentry *dent);
@@ -264,11 +384,48 @@ static inline struct dentry *ddup(struct dentry *dent)
     return dent;
 }
 
+/**
+ * Pin an executable whose data pages are directly mapped as process text.
+ * Until released, the file can't be written, truncated or unlinked
+ * (-ETXTBSY), thus the mapped blocks are never changed nor reused.
+ *
+ * @param dent  Executable dentry.
+ * @return      The dentry, with a new reference.
+ */
+static inline struct dentry *vfs_text_get(struct dentry *dent)
+{
+    dent->inod->textref++;
+    return ddup(dent);
+}
+
+/**
+ * Release an executable pinned by vfs_text_get.
+ *
+ * @param dent  Executable dentry.
+ */
+static inline void vfs_text_put(struct dentry *dent)
+{
+    dent->inod->textref--;
+    dput(dent);
+}
+
 int dentry_path(struct dentry *dent, char *buf, size_t size);
 
 
 struct file *fs_file_alloc(void);
 
+/**
+ * Readahead hook, to be called before reading 'count' bytes from the
+ * current file position.
+ * Sequential reads open an adaptive window (doubled every time half of it
+ * has been consumed) that is prefetched via the inode 'readahead' op.
+ * Any seek resets the window.
+ *
+ * @param fil   Open file.
+ * @param count Bytes that are going to be read.
+ */
+void vfs_readahead(struct file *fil, size_t count);
+
 void fs_file_free(struct file *fil);
 
 
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "hrtimer.h"
+
+/* Sorted by expiration time */
+static struct list_link hrtimer_queue;
+
+static int hrtimer_hw;
+
+/**
+ * Architecture dependent one-shot timer initialization.
+ * Returns a negative value if not available.
+ */
+int hrtimer_arch_init(void);
+
+/**
+ * Program the one-shot timer to fire after the given nanoseconds.
+ * Longer delays than supported by the hardware fire earlier.
+ */
+void hrtimer_arch_program(uint64_t nsecs);
+
+
+static void hrtimer_program(void)
+{
+    const struct hrtimer_event *hr;
+    uint64_t now;
+
+    if (hrtimer_hw == 0 || list_empty(&hrtimer_queue))
+        return;
+    hr = list_container(hrtimer_queue.next, struct hrtimer_event, link);
+    now = timer_monotonic();
+    hrtimer_arch_program(hr->expires > now ? hr->expires - now : 0);
+}
+
+void hrtimer_event_init(struct hrtimer_event *hr, timer_event_t *fn,
+                        void *data, uint64_t expires)
+{
+    list_init(&hr->link);
+    hr->func = fn;
+    hr->data = data;
+    hr->expires = expires;
+}
+
+void hrtimer_event_add(struct hrtimer_event *hr)
+{
+    struct list_link *curr;
+    const struct hrtimer_event *next;
+
+    list_delete(&hr->link);
+    curr = hrtimer_queue.next;
+    while (curr != &hrtimer_queue) {
+        next = list_container(curr, struct hrtimer_event, link);
+        if (hr->expires < next->expires)
+            break;
+        curr = curr->next;
+    }
+    list_insert_before(curr, &hr->link);
+    /* New first event */
+    if (hrtimer_queue.next == &hr->link)
+        hrtimer_program();
+}
+
+/*
+ * The hardware timer is left armed, a spurious expiration finds nothing
+ * to fire and reprograms for the next event.
+ */
+void hrtimer_event_del(struct hrtimer_event *hr)
+{
+    list_delete(&hr->link);
+}
+
+int hrtimer_available(void)
+{
+    return hrtimer_hw;
+}
+
+void hrtimer_update(void)
+{
+    struct hrtimer_event *hr;
+    uint64_t now = timer_monotonic();
+
+    while (!list_empty(&hrtimer_queue)) {
+        hr = list_container(hrtimer_queue.next, struct hrtimer_event, link);
+        if (hr->expires > now)
+            break;
+        list_delete(&hr->link);
+        hr->func(hr->data);
+    }
+    hrtimer_program();
+}
+
+void hrtimer_init(void)
+{
+    list_init(&hrtimer_queue);
+    hrtimer_hw = (hrtimer_arch_init() == 0);
+}
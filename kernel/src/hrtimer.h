@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_HRTIMER_H_
+#define BEEOS_HRTIMER_H_
+
+#include "timer.h"
+#include "list.h"
+#include <stdint.h>
+
+/*
+ * High resolution timers.
+ * Events expiring with nanosecond resolution, driven by a one-shot
+ * hardware timer (the local APIC timer on x86). The queue is kept sorted
+ * by expiration time, thus it is meant for few short lived events (e.g.
+ * the sub-tick remainder of a sleep), everything else should use the
+ * timer wheel.
+ */
+
+/** High resolution timer event structure. */
+struct hrtimer_event {
+    struct list_link link;      /**< Link used when in the global queue. */
+    timer_event_t    *func;     /**< Timer event function callback. */
+    void             *data;     /**< User context data. */
+    uint64_t         expires;   /**< Expiration time, monotonic nanoseconds */
+};
+
+/**
+ * Initialize the high resolution timer event structure.
+ *
+ * @param hr        High resolution timer event context.
+ * @param fn        Timer event function callback.
+ * @param data      Data pointer to be passed to the callback.
+ * @param expires   Expiration time, in monotonic nanoseconds.
+ */
+void hrtimer_event_init(struct hrtimer_event *hr, timer_event_t *fn,
+                        void *data, uint64_t expires);
+
+/**
+ * Adds an event to the high resolution timers queue.
+ * An already expired event fires as soon as possible.
+ *
+ * @param hr        High resolution timer event context.
+ */
+void hrtimer_event_add(struct hrtimer_event *hr);
+
+/**
+ * Removes an event from the high resolution timers queue.
+ *
+ * @param hr        High resolution timer event context.
+ */
+void hrtimer_event_del(struct hrtimer_event *hr);
+
+/**
+ * Check if high resolution timers are backed by an hardware timer.
+ * If not, the events are fired by the periodic tick.
+ *
+ * @return  Non zero if available.
+ */
+int hrtimer_available(void);
+
+/**
+ * Fires the expired events and programs the hardware timer for the
+ * next one. Called by the hardware timer interrupt handler.
+ */
+void hrtimer_update(void);
+
+/**
+ * Initialize the high resolution timers.
+ */
+void hrtimer_init(void);
+
+#endif /* BEEOS_HRTIMER_H_ */
@@ -22,14 +22,18 @@
 #include "proc.h"
 #include "panic.h"
 #include "kprintf.h"
+#include "timer.h"
 
 #include "arch/x86/pic.h"
 
 
 int need_resched;
 
-#define HANDLERS_NUM    49
+/* Exceptions, IRQs and local APIC vectors, the syscall uses the last slot */
+#define HANDLERS_NUM    65
+#define SYSCALL_SLOT    (HANDLERS_NUM - 1)
 static isr_handler_t isr_handlers[HANDLERS_NUM];
+static unsigned long isr_counts[HANDLERS_NUM];
 
 
 /* ISR arch independent dispatcher */
@@ -47,12 +51,19 @@ void isr_handler(struct isr_frame *ifr)
     previfr = current->arch.ifr;
     current->arch.ifr = ifr;
 
+    /* Restart the periodic tick, if stopped by the idle */
+    timer_idle_exit();
+
+    /* Time spent so far, in user mode if coming from there */
+    sched_acct((ifr->cs & 0x3) == 0x3);
+
     num = ifr->int_no;
     if (num == ISR_SYSCALL)
-        num = 48;
+        num = SYSCALL_SLOT;
 
     if (num >= HANDLERS_NUM || isr_handlers[num] == NULL)
         panic("unhandled interrupt %d\n", num);
+    isr_counts[num]++;
 
     isr_handlers[num]();
 
@@ -74,17 +85,28 @@ void isr_handler(struct isr_frame *ifr)
             current->arch.sfr == NULL && (ifr->cs & 0x3) == 0x3)
         do_signal();
 
+    /* Time spent in the kernel, the user mode time starts now */
+    if ((ifr->cs & 0x3) == 0x3)
+        sched_acct(0);
+
     /* Eventually restore the previous ifr */
     current->arch.ifr = previfr;
 }
 
+unsigned long isr_count(unsigned int num)
+{
+    if (num == ISR_SYSCALL)
+        num = SYSCALL_SLOT;
+    return (num < HANDLERS_NUM) ? isr_counts[num] : 0;
+}
+
 /*
  * Registers an interrupt handler
  */
 void isr_register_handler(unsigned int num, isr_handler_t func)
 {
     if (num == ISR_SYSCALL)
-        num = 48;
+        num = SYSCALL_SLOT;
     if (num < HANDLERS_NUM) {
         isr_handlers[num] = func;
         /* TODO: the following is ARCH specific code */
@@ -30,6 +30,14 @@ typedef void (*isr_handler_t)(void);
 
 void isr_register_handler(unsigned int num, isr_handler_t func);
 
+/**
+ * Number of handled interrupts.
+ *
+ * @param num   Interrupt vector.
+ * @return      Interrupts count since boot.
+ */
+unsigned long isr_count(unsigned int num);
+
 void isr_init(void);
 
 #endif /* BEEOS_ISR_H_ */
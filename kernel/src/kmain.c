@@ -26,14 +26,18 @@
 #include "proc.h"
 #include "mm/slab.h"
 #include "driver/tty.h"
+#include "driver/mem.h"
 #include "fs/vfs.h"
 #include "fs/devfs/devfs.h"
 #include "proc/task.h"
 #include "dev.h"
 
 
-#define ROOT_FS_TYPE    "ext2"
-#define ROOT_DEV        DEV_INITRD
+/* Root device candidates, the first one holding a valid fs is used */
+static const dev_t root_devs[] = { DEV_HDA, DEV_VDA, DEV_INITRD };
+
+/* Root file system types, tried in order on each device */
+static const char *root_fs_types[] = { "ext2", "crfs" };
 
 /* Init process entry point (arch defined) */
 void init(void);
@@ -42,6 +46,7 @@ void init(void);
 static void mount_root(void)
 {
     const struct super_block *sb;
+    unsigned int i, j;
 
     /*
      * DEVFS is temporary mounted as system root.
@@ -62,7 +67,16 @@ static void mount_root(void)
      * Initialization finished
      */
 
-    sb = vfs_super_create(ROOT_DEV, ROOT_FS_TYPE);
+    sb = NULL;
+    for (i = 0; i < sizeof(root_devs) / sizeof(*root_devs); i++) {
+        for (j = 0; j < sizeof(root_fs_types) / sizeof(*root_fs_types); j++) {
+            sb = vfs_super_create(root_devs[i], root_fs_types[j]);
+            if (sb != NULL)
+                break;
+        }
+        if (sb != NULL)
+            break;
+    }
     if (sb == NULL)
         panic("Unable to create root file system");
 
@@ -86,6 +100,7 @@ void kmain(void)
     vfs_init();
     scheduler_init();
     tty_init();
+    mem_init();
     syscall_init();
 
     /* Finish machine specific initialization */
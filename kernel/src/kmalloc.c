@@ -67,20 +67,26 @@ static unsigned long next_pow2(unsigned long val)
     return v;
 }
 
+/* Early heap size, enough for the low memory zone descriptors */
+#define KSBRK_SIZE  0x10000
+
 /*
  * Very primitive memory allocation form.
  * This is used silently used if the memory system has not been initialized.
+ * The heap is within the kernel image, thus a boot module placed just
+ * after the kernel is never overwritten.
  */
 static void *ksbrk(intptr_t increment)
 {
     void *ptr;
-    extern char kend;        /* Defined in the linker script. */
-    static char *kbrk = NULL;
-
-    if (kbrk == NULL)
-        kbrk = (char *)ALIGN_UP((uintptr_t)&kend, sizeof(uintptr_t));
-    ptr = kbrk;
-    kbrk += ALIGN_UP(increment, sizeof(uintptr_t));
+    static uintptr_t heap[KSBRK_SIZE / sizeof(uintptr_t)];
+    static size_t kbrk = 0;
+
+    increment = ALIGN_UP(increment, sizeof(uintptr_t));
+    if (increment > KSBRK_SIZE - kbrk)
+        return NULL;
+    ptr = (char *)heap + kbrk;
+    kbrk += increment;
     return ptr;
 }
 
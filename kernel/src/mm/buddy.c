@@ -190,6 +190,19 @@ e0: return -1;
 /*
  * Dump buddy status
  */
+unsigned int buddy_free_count(const struct buddy_sys *ctx, unsigned int order)
+{
+    const struct list_link *link;
+    unsigned int n = 0;
+
+    if (order > ctx->order_max)
+        return 0;
+    for (link = ctx->free_area[order].list.next;
+         link != &ctx->free_area[order].list; link = link->next)
+        n++;
+    return n;
+}
+
 void buddy_dump(const struct buddy_sys *ctx, char *base)
 {
     unsigned int i;
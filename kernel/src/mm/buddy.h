@@ -89,6 +89,15 @@ struct frame *buddy_alloc(const struct buddy_sys *ctx, unsigned int order);
 void buddy_free(const struct buddy_sys *ctx, const struct frame *frm,
                 unsigned int order);
 
+/**
+ * Number of free chunks of the specified order.
+ *
+ * @param ctx       Buddy system context pointer.
+ * @param order     Chunk order.
+ * @return          Free chunks count.
+ */
+unsigned int buddy_free_count(const struct buddy_sys *ctx, unsigned int order);
+
 /**
  * Prints buddy system status.
  *
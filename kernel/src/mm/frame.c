@@ -95,6 +95,15 @@ int frame_zone_add(void *addr, size_t size, size_t frame_size, int flags)
 }
 
 
+const struct zone_st *frame_zone_get(unsigned int i)
+{
+    const struct zone_st *zone = zone_list;
+
+    while (zone != NULL && i-- > 0)
+        zone = zone->next;
+    return zone;
+}
+
 void frame_dump(void)
 {
     const struct zone_st *zone;
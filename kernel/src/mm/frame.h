@@ -51,6 +51,14 @@ void frame_free(void *ptr, unsigned int order);
  */
 int frame_zone_add(void *addr, size_t size, size_t frame_size, int flags);
 
+/**
+ * Get a memory zone descriptor (e.g. for statistics).
+ *
+ * @param i     Zone index.
+ * @return      Zone descriptor or NULL if there is no such zone.
+ */
+const struct zone_st *frame_zone_get(unsigned int i);
+
 /**
  * Frame allocator dump function.
  */
@@ -21,20 +21,126 @@
 #define BEEOS_PROC_H_
 
 #include "proc/task.h"
+#include <sched.h>
 
 /* Default process timeslice (milliseconds) */
 #define SCHED_TIMESLICE     100
 
+/* Nice values range, lower values have higher priority */
+#define SCHED_NICE_MIN      (-20)
+#define SCHED_NICE_MAX      19
+
+/*
+ * Runqueue priorities, lower values first: the real-time static
+ * priorities (SCHED_RT_PRIO_MAX to SCHED_RT_PRIO_MIN) are followed by
+ * the nice values of the time sharing tasks.
+ */
+#define SCHED_PRIO_NUM      (SCHED_RT_PRIO_MAX + \
+                             SCHED_NICE_MAX - SCHED_NICE_MIN + 1)
+
 extern struct task *current;
 extern struct task ktask;
 
 extern int need_resched;
 
+/*
+ * Load average, exponentially decaying averages of the runnable tasks
+ * over 1, 5 and 15 minutes, in LOAD_FSHIFT bits fixed point.
+ */
+#define LOAD_FSHIFT         11
+#define LOAD_FIXED_1        (1 << LOAD_FSHIFT)
+#define LOAD_FREQ_SECS      5   /* Sampling period */
+
+extern unsigned long sched_loadavg[3];
+
+/**
+ * Sample the runnable tasks and update the load average.
+ * Called by the timer every LOAD_FREQ_SECS seconds.
+ */
+void sched_load_update(void);
+
 
 void scheduler(void);
 
 void scheduler_init(void);
 
+/**
+ * Timeslice of a task, scaled by its nice value.
+ * From twice the default (nice -20) to a twentieth of it (nice 19).
+ * Real-time tasks get the default one.
+ *
+ * @param t     Task.
+ * @return      Timeslice in clock ticks.
+ */
+int sched_timeslice(const struct task *t);
+
+/**
+ * Insert a new runnable task in the runqueue.
+ *
+ * @param t     Task in the TASK_RUNNING state.
+ */
+void sched_enqueue(struct task *t);
+
+/**
+ * Wake up a sleeping task.
+ * The task is set to TASK_RUNNING and inserted in the runqueue.
+ * Nothing is done if the task is already running.
+ * A reschedule is requested if the task has higher priority than the
+ * current one.
+ *
+ * @param t     Task.
+ */
+void sched_wakeup(struct task *t);
+
+/**
+ * Change the nice value of a task, moving it within the runqueue.
+ *
+ * @param t     Task.
+ * @param nice  New nice value (SCHED_NICE_MIN to SCHED_NICE_MAX).
+ */
+void sched_nice_set(struct task *t, int nice);
+
+/**
+ * Change the scheduling policy and the real-time priority of a task,
+ * moving it within the runqueue.
+ *
+ * @param t         Task.
+ * @param policy    SCHED_OTHER, SCHED_FIFO or SCHED_RR.
+ * @param rt_prio   Real-time priority (zero for SCHED_OTHER).
+ */
+void sched_policy_set(struct task *t, int policy, int rt_prio);
+
+/**
+ * Timer tick accounting of the current task timeslice.
+ * A reschedule is requested when the slice is over, SCHED_FIFO tasks
+ * have no slice.
+ */
+void sched_tick(void);
+
+/**
+ * CPU time accounting.
+ * Charges the time elapsed since the previous accounting point to the
+ * current task. Called at kernel entry (user time if coming from user
+ * mode), before returning to user mode and at context switches (system
+ * time).
+ *
+ * @param user  Charge as user time.
+ */
+void sched_acct(int user);
+
+/**
+ * Convert accounted CPU time to clock ticks.
+ *
+ * @param cycles    Accounted time.
+ * @return          Clock ticks.
+ */
+clock_t sched_acct_ticks(uint64_t cycles);
+
+/**
+ * Number of runnable tasks, the current one included but not the idle.
+ */
+unsigned int sched_nr_running(void);
+
 /**
  * Process pending (non masked) signals.
  */
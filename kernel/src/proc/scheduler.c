@@ -23,11 +23,45 @@
 #include "timer.h"
 #include "kmalloc.h"
 #include "panic.h"
+#include "timepage.h"
+#include "arch/x86/tsc.h"
 
 
 struct task ktask;
 struct task *current = &ktask;
 
+/*
+ * Runqueue.
+ * Runnable tasks are kept in per priority lists, a bitmap marks the non
+ * empty ones, thus the next task is found in constant time.
+ * Tasks that consumed their timeslice move to the expired array, the
+ * arrays are swapped when the active one is empty: every runnable task
+ * gets its (nice scaled) slice before any other gets another one.
+ * Real-time tasks never expire, their lists come first and are always
+ * in the active array.
+ * The running task is not in the runqueue.
+ */
+
+#define BITMAP_WORDS    ((SCHED_PRIO_NUM + 31) / 32)
+
+struct prio_array {
+    unsigned int        count;                  /* Queued tasks */
+    uint32_t            bitmap[BITMAP_WORDS];   /* Non empty lists */
+    struct list_link    queue[SCHED_PRIO_NUM];  /* Per priority lists */
+};
+
+static struct prio_array arrays[2];
+static struct prio_array *active = &arrays[0];
+static struct prio_array *expired = &arrays[1];
+
+unsigned long sched_loadavg[3];
+
+/* Last CPU time accounting point */
+static uint64_t acct_stamp;
+
+/* exp(-LOAD_FREQ_SECS / (60 * minutes)) in fixed point */
+static const unsigned long load_exp[3] = { 1884, 2014, 2037 };
+
 
 static int sigpop(sigset_t *sigpend, const sigset_t *sigmask)
 {
@@ -85,31 +119,202 @@ int do_signal(void)
 }
 
 
+static int task_prio(const struct task *t)
+{
+    if (t->policy != SCHED_OTHER)
+        return SCHED_RT_PRIO_MAX - t->rt_priority;
+    return SCHED_RT_PRIO_MAX + t->nice - SCHED_NICE_MIN;
+}
+
+/*
+ * Insert at the tail of the priority list, or at the head for a
+ * preempted real-time task that must resume first.
+ */
+static void prio_array_insert(struct prio_array *arr, struct task *t,
+                              int head)
+{
+    int prio = task_prio(t);
+
+    if (head != 0)
+        list_insert_after(&arr->queue[prio], &t->run);
+    else
+        list_insert_before(&arr->queue[prio], &t->run);
+    arr->bitmap[prio / 32] |= (1U << (prio % 32));
+    arr->count++;
+    t->array = arr;
+}
+
+static void prio_array_remove(struct prio_array *arr, struct task *t)
+{
+    int prio = task_prio(t);
+
+    list_delete(&t->run);
+    if (list_empty(&arr->queue[prio]))
+        arr->bitmap[prio / 32] &= ~(1U << (prio % 32));
+    arr->count--;
+    t->array = NULL;
+}
+
+/*
+ * Highest priority queued task, NULL if the array is empty.
+ */
+static struct task *prio_array_first(const struct prio_array *arr)
+{
+    int i;
+
+    for (i = 0; i < BITMAP_WORDS; i++) {
+        if (arr->bitmap[i] != 0)
+            return list_container(
+                    arr->queue[i * 32 + __builtin_ctz(arr->bitmap[i])].next,
+                    struct task, run);
+    }
+    return NULL;
+}
+
+int sched_timeslice(const struct task *t)
+{
+    int ticks;
+
+    if (t->policy != SCHED_OTHER)
+        return msecs_to_ticks(SCHED_TIMESLICE);
+    ticks = msecs_to_ticks(SCHED_TIMESLICE * (SCHED_NICE_MAX + 1 - t->nice) /
+                           (SCHED_NICE_MAX + 1));
+    return (ticks > 0) ? ticks : 1;
+}
+
+static void enqueue(struct task *t, int preempted)
+{
+    if (t->policy != SCHED_OTHER) {
+        if (t->counter <= 0) {
+            t->counter = sched_timeslice(t);
+            preempted = 0; /* Round robin */
+        }
+        prio_array_insert(active, t, preempted);
+    } else if (t->counter > 0) {
+        prio_array_insert(active, t, 0);
+    } else {
+        t->counter = sched_timeslice(t);
+        prio_array_insert(expired, t, 0);
+    }
+}
+
+void sched_enqueue(struct task *t)
+{
+    enqueue(t, 0);
+}
+
+void sched_wakeup(struct task *t)
+{
+    if (t->state == TASK_RUNNING)
+        return;
+    t->state = TASK_RUNNING;
+    if (t == current)
+        return; /* Not yet switched away */
+    sched_enqueue(t);
+    if (t->array == active &&
+        (current == &ktask || task_prio(t) < task_prio(current)))
+        need_resched = 1;
+}
+
+void sched_nice_set(struct task *t, int nice)
+{
+    struct prio_array *arr = t->array;
+
+    if (arr != NULL)
+        prio_array_remove(arr, t);
+    t->nice = nice;
+    if (t->counter > sched_timeslice(t))
+        t->counter = sched_timeslice(t);
+    if (arr != NULL)
+        prio_array_insert(arr, t, 0);
+}
+
+void sched_policy_set(struct task *t, int policy, int rt_prio)
+{
+    struct prio_array *arr = t->array;
+
+    if (arr != NULL)
+        prio_array_remove(arr, t);
+    t->policy = policy;
+    t->rt_priority = rt_prio;
+    t->counter = sched_timeslice(t);
+    if (arr != NULL)
+        enqueue(t, 0);
+    if (t == current)
+        need_resched = 1;   /* May be no longer the highest priority */
+}
+
+void sched_tick(void)
+{
+    if (current->policy == SCHED_FIFO && current != &ktask)
+        return;
+    if (current->counter-- <= 0)
+        need_resched = 1;
+}
+
+void sched_acct(int user)
+{
+    uint64_t now = tsc_read();
+
+    if (user != 0)
+        current->utime += now - acct_stamp;
+    else
+        current->stime += now - acct_stamp;
+    acct_stamp = now;
+    timepage_cpu_set(current->utime + current->stime, now);
+}
+
+clock_t sched_acct_ticks(uint64_t cycles)
+{
+    return (clock_t)(tsc_to_usecs(cycles) / (1000000 / CLOCKS_PER_SEC));
+}
+
+unsigned int sched_nr_running(void)
+{
+    unsigned int n = active->count + expired->count;
+
+    if (current != &ktask && current->state == TASK_RUNNING)
+        n++;
+    return n;
+}
+
 void scheduler(void)
 {
     struct task *curr;
     struct task *next;
-    static clock_t prev_clock;
+    struct prio_array *arr;
 
     curr = current;
-    next = list_container(current->tasks.next,
-            struct task, tasks);
+    if (curr != &ktask && curr->state == TASK_RUNNING)
+        enqueue(curr, 1);
 
-    while (next->state != TASK_RUNNING && next != current)
-        next = list_container(next->tasks.next, struct task, tasks);
+    if (active->count == 0) {
+        arr = active;
+        active = expired;
+        expired = arr;
+    }
 
-    if (next == current) {
+    next = prio_array_first(active);
+    if (next != NULL) {
+        prio_array_remove(active, next);
+    } else {
         /* Nothing to run... run the idle() task */
         ktask.state = TASK_RUNNING;
+        ktask.counter = sched_timeslice(&ktask);
         next = &ktask;
     }
 
     /* Update CPU usage statistics */
-    current->usage += (timer_ticks - prev_clock);
-    prev_clock = timer_ticks;
+    sched_acct(0);
+    if (next != curr) {
+        if (curr->state == TASK_RUNNING)
+            curr->nivcsw++;
+        else
+            curr->nvcsw++;
+    }
 
     current = next;
-    current->counter = msecs_to_ticks(SCHED_TIMESLICE);
+    timepage_cpu_set(next->utime + next->stime, acct_stamp);
 
     /*
      * Should be the last call... the following can return in another place.
@@ -118,12 +323,30 @@ void scheduler(void)
     task_arch_switch(&curr->arch, &next->arch);
 }
 
+void sched_load_update(void)
+{
+    unsigned long running;
+    int i;
+
+    running = sched_nr_running() * LOAD_FIXED_1;
+    for (i = 0; i < 3; i++)
+        sched_loadavg[i] = (sched_loadavg[i] * load_exp[i] +
+                            running * (LOAD_FIXED_1 - load_exp[i])) >>
+                           LOAD_FSHIFT;
+}
+
 void scheduler_init(void)
 {
     int i;
 
     current = &ktask;
 
+    for (i = 0; i < SCHED_PRIO_NUM; i++) {
+        list_init(&arrays[0].queue[i]);
+        list_init(&arrays[1].queue[i]);
+    }
+    acct_stamp = tsc_read();
+
     /* Set to zero: uids, gids, pids... */
     memset(&ktask, 0, sizeof(ktask));
     ktask.cwd = NULL;
@@ -135,9 +358,12 @@ void scheduler_init(void)
     list_init(&ktask.children);
     list_init(&ktask.condw);
     list_init(&ktask.timers);
+    list_init(&ktask.run);
     if (task_arch_init(&ktask.arch, NULL) < 0)
         panic("Task 0 init failure");
 
+    strcpy(ktask.comm, "idle");
+
     sigemptyset(&ktask.sigmask);
     sigemptyset(&ktask.sigpend);
     for (i = 0; i < SIGNALS_NUM; i++) {
@@ -20,6 +20,7 @@
 #include "task.h"
 #include "proc.h"
 #include "fs/vfs.h"
+#include "fs/procfs/procfs.h"
 #include "timer.h"
 #include "kmalloc.h"
 #include "panic.h"
@@ -36,11 +37,23 @@ void task_signal(struct task *tsk, int sig)
         if (tsk->state == TASK_SLEEPING) {
             if (!list_empty(&tsk->condw))
                 list_delete(&tsk->condw);
-            tsk->state = TASK_RUNNING;
+            sched_wakeup(tsk);
         }
     }
 }
 
+struct task *task_find(pid_t pid)
+{
+    struct task *t = current;
+
+    do {
+        if (t->pid == pid)
+            return t;
+        t = list_container(t->tasks.next, struct task, tasks);
+    } while (t != current);
+    return NULL;
+}
+
 int task_init(struct task *tsk, task_entry_t entry)
 {
     static pid_t next_pid = 1;
@@ -63,6 +76,7 @@ int task_init(struct task *tsk, task_entry_t entry)
     /* file system */
     tsk->cwd = ddup(current->cwd);
     tsk->root = ddup(current->root);
+    tsk->exe = (current->exe != NULL) ? vfs_text_get(current->exe) : NULL;
 
     /* duplicate valid file descriptors */
     memset(tsk->fds, 0, sizeof(tsk->fds));
@@ -75,12 +89,23 @@ int task_init(struct task *tsk, task_entry_t entry)
 
     /* memory */
     tsk->brk = current->brk;
+    tsk->faults = 0;
 
     /* sheduler */
-    tsk->usage = 0;
+    tsk->utime = 0;
+    tsk->stime = 0;
+    tsk->cutime = 0;
+    tsk->cstime = 0;
+    tsk->nvcsw = 0;
+    tsk->nivcsw = 0;
     tsk->state = TASK_RUNNING;
-    tsk->counter = msecs_to_ticks(SCHED_TIMESLICE);
+    tsk->nice = current->nice;
+    tsk->policy = current->policy;
+    tsk->rt_priority = current->rt_priority;
+    tsk->counter = sched_timeslice(tsk);
     tsk->exit_code = 0;
+    list_init(&tsk->run);
+    tsk->array = NULL;
 
     list_init(&tsk->tasks);
     list_init(&tsk->children);
@@ -111,7 +136,12 @@ int task_init(struct task *tsk, task_entry_t entry)
     /* Controlling terminal */
     tsk->tty = current->tty;
 
-    return task_arch_init(&tsk->arch, entry);
+    memcpy(tsk->comm, current->comm, sizeof(tsk->comm));
+
+    if (task_arch_init(&tsk->arch, entry) < 0)
+        return -1;
+    sched_enqueue(tsk);
+    return 0;
 }
 
 
@@ -119,6 +149,8 @@ void task_deinit(struct task *tsk)
 {
     dput(tsk->cwd);
     dput(tsk->root);
+    if (tsk->exe != NULL)
+        vfs_text_put(tsk->exe);
     task_arch_deinit(&tsk->arch);
 }
 
@@ -141,6 +173,7 @@ struct task *task_create(task_entry_t entry)
 
 void task_delete(struct task *tsk)
 {
+    procfs_task_exit(tsk->pid);
     task_deinit(tsk);
     kfree(tsk, sizeof(struct task));
 }
@@ -36,6 +36,10 @@
 
 #define SIGNALS_NUM     (SIGUNUSED+1)
 
+#define TASK_COMM_LEN   16
+
+struct prio_array;
+
 /** Process structure. */
 struct task {
     struct task_arch    arch;           /**< Architecture specific data. */
@@ -50,10 +54,16 @@ struct task {
     int                 state;          /**< Process state. */
     struct dentry       *cwd;           /**< Current working directory. */
     struct dentry       *root;          /**< File system root. */
+    struct dentry       *exe;           /**< Pinned directly mapped text */
     struct filedesc     fds[OPEN_MAX];  /**< Open files. */
     struct list_link    tasks;          /**< Tasks list link. */
     struct cond         chld_exit;      /**< Child exit condition */
     int                 counter;        /**< Remaining time slice for sched */
+    int                 nice;           /**< Nice value (scheduling priority) */
+    int                 policy;         /**< Scheduling policy */
+    int                 rt_priority;    /**< Real-time static priority */
+    struct list_link    run;            /**< Runqueue link */
+    struct prio_array   *array;         /**< Runqueue array (NULL if none) */
     int                 exit_code;      /**< Exit status */
     struct task         *pptr;          /**< Parent process */
     struct list_link    children;       /**< Children list (vertical) */
@@ -66,7 +76,14 @@ struct task {
     struct timer_event  alarm;          /**< Alarm timer event (pre-allocated) */
     struct list_link    condw;          /**< Conditional wait */
     dev_t               tty;            /**< Controlling terminal */
-    clock_t             usage;          /**< CPU time in clock ticks */
+    uint64_t            utime;          /**< User CPU time (TSC cycles) */
+    uint64_t            stime;          /**< System CPU time (TSC cycles) */
+    uint64_t            cutime;         /**< Waited children user time */
+    uint64_t            cstime;         /**< Waited children system time */
+    unsigned long       nvcsw;          /**< Voluntary context switches */
+    unsigned long       nivcsw;         /**< Involuntary context switches */
+    unsigned long       faults;         /**< Page faults count */
+    char                comm[TASK_COMM_LEN];    /**< Executable name */
 };
 
 
@@ -82,6 +99,14 @@ void task_delete(struct task *tsk);
 
 void task_signal(struct task *tsk, int sig);
 
+/**
+ * Find a task by process identifier.
+ *
+ * @param pid   Process ID.
+ * @return      Task or NULL if there is no such process.
+ */
+struct task *task_find(pid_t pid);
+
 
 int task_arch_init(struct task_arch *tsk, task_entry_t entry);
 
@@ -4,7 +4,10 @@ local_sources := kmain.c \
 				 panic.c \
 				 isr.c \
 				 elf.c \
-				 timer.c
+				 timer.c \
+				 hrtimer.c \
+				 timepage.c \
+				 dev.c
 
 dirs := driver fs mm proc sync sys ipc
 
@@ -45,7 +45,7 @@ void cond_signal(struct cond *cv)
         return;
     t = struct_ptr(cv->queue.next, struct task, condw);
     list_delete(&t->condw);
-    t->state = TASK_RUNNING;
+    sched_wakeup(t);
 }
 
 void cond_broadcast(struct cond *cv)
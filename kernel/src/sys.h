@@ -24,6 +24,7 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <signal.h>
+#include <dirent.h>
 
 
 void sys_exit(int status);
@@ -103,6 +104,39 @@ unsigned int sys_clock(void);
 
 int sys_info(void);
 
+int sys_getdents(int fd, struct dirent *dirp, unsigned int count);
+
+int sys_unlink(const char *pathname);
+
+void sys_sync(void);
+
+int sys_fsync(int fd);
+
+int sys_ftruncate(int fd, off_t length);
+
+int sys_getpriority(int which, id_t who);
+
+int sys_setpriority(int which, id_t who, int prio);
+
+struct sched_param;
+
+int sys_sched_setscheduler(pid_t pid, int policy,
+                           const struct sched_param *param);
+
+int sys_sched_getscheduler(pid_t pid);
+
+int sys_sched_getparam(pid_t pid, struct sched_param *param);
+
+struct tms;
+
+unsigned int sys_times(struct tms *buf);
+
+struct rusage;
+
+int sys_getrusage(int who, struct rusage *usage);
+
+int sys_clock_gettime(clockid_t id, struct timespec *ts);
+
 
 void syscall_init(void);
 
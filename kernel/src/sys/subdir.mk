@@ -35,5 +35,18 @@ local_sources := syscall.c \
 				 sys_chdir.c \
 				 sys_alarm.c \
 				 sys_mount.c \
-				 sys_clock.c
+				 sys_clock.c \
+				 sys_getdents.c \
+				 sys_unlink.c \
+				 sys_sync.c \
+				 sys_fsync.c \
+				 sys_ftruncate.c \
+				 sys_getpriority.c \
+				 sys_setpriority.c \
+				 sys_sched_setscheduler.c \
+				 sys_sched_getscheduler.c \
+				 sys_sched_getparam.c \
+				 sys_times.c \
+				 sys_getrusage.c \
+				 sys_clock_gettime.c
 
@@ -22,5 +22,5 @@
 
 unsigned int sys_clock(void)
 {
-    return (unsigned int)current->usage;
+    return (unsigned int)sched_acct_ticks(current->utime + current->stime);
 }
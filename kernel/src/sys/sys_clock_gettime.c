@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "timer.h"
+#include "arch/x86/paging.h"
+#include <time.h>
+#include <errno.h>
+
+int sys_clock_gettime(clockid_t id, struct timespec *ts)
+{
+    uint64_t nsecs = timer_monotonic();
+
+    if (page_user_writable(ts, sizeof(*ts)) < 0)
+        return -EFAULT;
+    switch (id) {
+    case CLOCK_MONOTONIC:
+        ts->tv_sec = 0;
+        break;
+    case CLOCK_REALTIME:
+        ts->tv_sec = timer_realtime_base;
+        break;
+    default:
+        return -EINVAL;
+    }
+    ts->tv_sec += (time_t)(nsecs / NSECS_PER_SEC);
+    ts->tv_nsec = (long)(nsecs % NSECS_PER_SEC);
+    return 0;
+}
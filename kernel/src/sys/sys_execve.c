@@ -23,6 +23,7 @@
 #include "kmalloc.h"
 #include "kprintf.h"
 #include "proc.h"
+#include "timepage.h"
 #include "arch/x86/paging.h"
 #include <sys/types.h>
 #include <stddef.h>
@@ -98,10 +99,56 @@ static void stack_init(uintptr_t *base, const char * const argv[],
     base[2] = (uintptr_t)&base[4+base[0]] + delta;
 }
 
-static int segment_init(const struct elf_prog_hdr *ph, struct inode *inod)
+/*
+ * Map a page of a read-only segment directly to the file data, if the
+ * file system keeps it in memory (e.g. ext2 on a ramdisk).
+ * Only pages entirely filled with page aligned file data are candidates.
+ * Returns non-zero if the page has been mapped.
+ */
+static int segment_map_direct(const struct elf_prog_hdr *ph,
+                              struct inode *inod, uint32_t vaddr)
+{
+    void *ptr;
+
+    if ((ph->flags & ELF_PROG_FLAG_WRITE) != 0 || vaddr < ph->vaddr ||
+        vaddr + PAGE_SIZE > ph->vaddr + ph->filesz)
+        return 0;
+    ptr = vfs_direct(inod, ph->offset + (vaddr - ph->vaddr), PAGE_SIZE);
+    if (ptr == NULL || ((uintptr_t)ptr & (PAGE_SIZE - 1)) != 0)
+        return 0;
+    return ((int)page_map_shared((char *)vaddr,
+                                 (uint32_t)virt_to_phys(ptr)) >= 0);
+}
+
+/*
+ * Read the segment file data within [start, end) virtual addresses.
+ */
+static int segment_read(const struct elf_prog_hdr *ph, struct inode *inod,
+                        uint32_t start, uint32_t end)
+{
+    int ret;
+
+    start = MAX(start, ph->vaddr);
+    end = MIN(end, ph->vaddr + ph->filesz);
+    if (start >= end)
+        return 0;
+    ret = vfs_read(inod, (void *)start, end - start,
+                   ph->offset + (start - ph->vaddr));
+    if (ret != (int)(end - start) && ret >= 0)
+        ret = -EIO;
+    return ret;
+}
+
+/*
+ * Map and fill a segment, 'direct' is incremented for every page mapped
+ * directly to the file data.
+ */
+static int segment_init(const struct elf_prog_hdr *ph, struct inode *inod,
+                        int *direct)
 {
     int ret = 0;
     uint32_t vaddr;
+    uint32_t start;
 
     if (ph->memsz < ph->filesz || KVBASE <= ph->vaddr + ph->memsz)
         return -ENOEXEC;
@@ -113,21 +160,24 @@ static int segment_init(const struct elf_prog_hdr *ph, struct inode *inod)
         current->brk = ph->vaddr + ph->memsz;
     }
 
-    for (vaddr = ALIGN_DOWN(ph->vaddr, PAGE_SIZE);
-         vaddr < ph->vaddr + ph->memsz;
-         vaddr += PAGE_SIZE) {
+    /*
+     * Privately mapped pages are filled by reading the runs of consecutive
+     * pages in one go, starting from 'start'.
+     */
+    start = ALIGN_DOWN(ph->vaddr, PAGE_SIZE);
+    for (vaddr = start; vaddr < ph->vaddr + ph->memsz; vaddr += PAGE_SIZE) {
+        if (segment_map_direct(ph, inod, vaddr) != 0) {
+            (*direct)++;
+            if ((ret = segment_read(ph, inod, start, vaddr)) < 0)
+                return ret;
+            start = vaddr + PAGE_SIZE;
+            continue;
+        }
         if ((ret = (int)page_map((char *)vaddr, -1)) < 0)
             return ret;
     }
-
-    if (ph->filesz != 0) {
-        ret = vfs_read(inod, (void *)ph->vaddr, ph->filesz, ph->offset);
-        if (ret != ph->filesz) {
-            if (ret >= 0)
-                ret = -EIO;
-            return ret;
-        }
-    }
+    if ((ret = segment_read(ph, inod, start, vaddr)) < 0)
+        return ret;
 
     if (ph->memsz - ph->filesz > 0)
         memset((void *)(ph->vaddr + ph->filesz), 0, ph->memsz - ph->filesz);
@@ -145,8 +195,11 @@ int sys_execve(const char *path, const char *const argv[],
     struct dentry *dent;
     struct inode *inod;
     unsigned int i, off;
+    int direct = 0;
     uint32_t pgdir;
     void *ustack;
+    const char *name;
+    char comm[TASK_COMM_LEN];
 
     if (current->arch.ifr == NULL || argv == NULL)
         return -EINVAL;
@@ -156,6 +209,16 @@ int sys_execve(const char *path, const char *const argv[],
         return -ENOENT;
     inod = dent->inod;
 
+    /* The executable file name, for process listings */
+    for (name = path; *path != '\0'; path++) {
+        if (*path == '/' && path[1] != '\0')
+            name = path + 1;
+    }
+    for (i = 0; i < sizeof(comm) - 1 && name[i] != '\0' &&
+         name[i] != '/'; i++)
+        comm[i] = name[i];
+    comm[i] = '\0';
+
     if (vfs_read(inod, &eh, sizeof(eh), 0) != sizeof(eh) ||
             eh.magic != ELF_MAGIC) {
         dput(dent);
@@ -184,6 +247,10 @@ int sys_execve(const char *path, const char *const argv[],
         goto bad;
     memcpy((char *)KVBASE-ARG_MAX, ustack, ARG_MAX);
 
+    /* Clocks readable without syscalls */
+    if ((ret = timepage_map()) < 0)
+        goto bad;
+
     /* Release user stack copy */
     kfree(ustack, ARG_MAX);
 
@@ -200,7 +267,7 @@ int sys_execve(const char *path, const char *const argv[],
         }
 
         if (ph.type == ELF_PROG_TYPE_LOAD) {
-            ret = segment_init(&ph, inod);
+            ret = segment_init(&ph, inod, &direct);
             if (ret < 0)
                 goto bad;
         }
@@ -214,9 +281,15 @@ int sys_execve(const char *path, const char *const argv[],
     page_dir_del(current->arch.pgdir);
     current->arch.pgdir = pgdir;
 
+    /* The old text is gone, pin the new one if directly mapped */
+    if (current->exe != NULL)
+        vfs_text_put(current->exe);
+    current->exe = (direct != 0) ? vfs_text_get(dent) : NULL;
+
     /* We assume that ARG_MAX is lass than PAGE_SIZE */
     current->arch.ifr->usr_esp = KVBASE-ARG_MAX;
     current->arch.ifr->eip = eh.entry;
+    memcpy(current->comm, comm, sizeof(comm));
 
     /*
      * Eventually close files with O_CLOEXEC flag enabled
@@ -20,6 +20,7 @@
 #include "sys.h"
 #include "fs/vfs.h"
 #include "proc.h"
+#include "arch/x86/paging.h"
 #include <errno.h>
 
 int sys_fstat(int fd, struct stat *buf)
@@ -32,6 +33,8 @@ int sys_fstat(int fd, struct stat *buf)
     inod = current->fds[fd].fil->dent->inod;
     if (inod == NULL)
         return -ENOENT;
+    if (page_user_writable(buf, sizeof(*buf)) < 0)
+        return -EFAULT;
 
     buf->st_dev = inod->sb->dev;
     buf->st_ino = inod->ino;
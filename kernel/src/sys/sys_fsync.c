@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "fs/vfs.h"
+#include "fs/buf.h"
+#include "proc.h"
+#include <errno.h>
+#include <limits.h>
+
+/*
+ * Blocks are not tracked per file, thus all the dirty blocks of the
+ * file system device are written.
+ */
+int sys_fsync(int fd)
+{
+    const struct inode *inod;
+
+    if (fd < 0 || fd >= OPEN_MAX || current->fds[fd].fil == NULL)
+        return -EBADF;
+
+    inod = current->fds[fd].fil->dent->inod;
+    if (!S_ISREG(inod->mode) && !S_ISDIR(inod->mode))
+        return -EINVAL;
+    return (buf_sync(inod->sb->dev) == 0) ? 0 : -EIO;
+}
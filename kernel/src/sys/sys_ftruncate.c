@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "fs/vfs.h"
+#include "proc.h"
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+
+int sys_ftruncate(int fd, off_t length)
+{
+    struct file *fil;
+
+    if (fd < 0 || fd >= OPEN_MAX || current->fds[fd].fil == NULL)
+        return -EBADF;
+    if (length < 0)
+        return -EINVAL;
+
+    fil = current->fds[fd].fil;
+    if ((fil->flags & O_ACCMODE) == O_RDONLY)
+        return -EBADF;
+
+    return vfs_truncate(fil->dent->inod, length);
+}
@@ -19,6 +19,7 @@
 
 #include "sys.h"
 #include "proc.h"
+#include "arch/x86/paging.h"
 #include "fs/vfs.h" /* follow_up() */
 #include <errno.h>
 #include <string.h>
@@ -28,6 +29,8 @@ int sys_getcwd(char *buf, size_t size)
 {
     if (buf == NULL)
         return -EINVAL;
+    if (page_user_writable(buf, size) < 0)
+        return -EFAULT;
 
     return dentry_path(current->cwd, buf, size);
 }
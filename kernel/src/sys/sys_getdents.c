@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "fs/vfs.h"
+#include "proc.h"
+#include "arch/x86/paging.h"
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+
+int sys_getdents(int fd, struct dirent *dirp, unsigned int count)
+{
+    int n;
+    struct file *fil;
+
+    if (fd < 0 || fd >= OPEN_MAX || current->fds[fd].fil == NULL)
+        return -EBADF;
+
+    fil = current->fds[fd].fil;
+    if (!S_ISDIR(fil->dent->inod->mode))
+        return -ENOTDIR;
+
+    if (page_user_writable(dirp, count) < 0)
+        return -EFAULT;
+    count /= sizeof(struct dirent);
+    if (count == 0)
+        return -EINVAL;
+
+    n = vfs_getdents(fil->dent, &fil->off, dirp, count);
+    if (n > 0)
+        n *= sizeof(struct dirent);
+    return n;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "proc.h"
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <errno.h>
+
+/*
+ * Returns the highest priority (lowest nice value) of the processes
+ * selected by which and who. A zero who selects the calling process,
+ * process group or user.
+ * The result is biased as '20 - nice' to be never negative.
+ */
+int sys_getpriority(int which, id_t who)
+{
+    const struct task *t = current;
+    int nice = SCHED_NICE_MAX + 1;
+
+    if (which != PRIO_PROCESS && which != PRIO_PGRP && which != PRIO_USER)
+        return -EINVAL;
+    if (who == 0) {
+        if (which == PRIO_PROCESS)
+            who = current->pid;
+        else if (which == PRIO_PGRP)
+            who = current->pgid;
+        else
+            who = current->uid;
+    }
+
+    do {
+        if (t != &ktask && t->state != TASK_ZOMBIE &&
+            ((which == PRIO_PROCESS && t->pid == (pid_t)who) ||
+             (which == PRIO_PGRP && t->pgid == (pid_t)who) ||
+             (which == PRIO_USER && t->uid == (uid_t)who))) {
+            if (t->nice < nice)
+                nice = t->nice;
+        }
+        t = list_container(t->tasks.next, struct task, tasks);
+    } while (t != current);
+
+    if (nice > SCHED_NICE_MAX)
+        return -ESRCH;
+    return 20 - nice;
+}
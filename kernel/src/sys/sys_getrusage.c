@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "proc.h"
+#include "arch/x86/paging.h"
+#include "arch/x86/tsc.h"
+#include <sys/resource.h>
+#include <errno.h>
+
+static void timeval_set(struct timeval *tv, uint64_t cycles)
+{
+    uint64_t usecs = tsc_to_usecs(cycles);
+
+    tv->tv_sec = (time_t)(usecs / 1000000);
+    tv->tv_usec = (long)(usecs % 1000000);
+}
+
+int sys_getrusage(int who, struct rusage *usage)
+{
+    if (usage == NULL || page_user_writable(usage, sizeof(*usage)) < 0)
+        return -EFAULT;
+
+    memset(usage, 0, sizeof(*usage));
+    if (who == RUSAGE_SELF) {
+        timeval_set(&usage->ru_utime, current->utime);
+        timeval_set(&usage->ru_stime, current->stime);
+        usage->ru_minflt = current->faults;
+        usage->ru_nvcsw = current->nvcsw;
+        usage->ru_nivcsw = current->nivcsw;
+    } else if (who == RUSAGE_CHILDREN) {
+        timeval_set(&usage->ru_utime, current->cutime);
+        timeval_set(&usage->ru_stime, current->cstime);
+    } else {
+        return -EINVAL;
+    }
+    return 0;
+}
@@ -20,11 +20,17 @@
 #include "sys.h"
 #include "proc.h"
 #include "mm/frame.h"
+#include "fs/buf.h"
+#include "driver/blkdev.h"
+#include "arch/x86/pci.h"
 
 
 int sys_info(void)
 {
     frame_dump();
     proc_dump();
+    buf_dump();
+    blk_dump();
+    pci_dump();
     return 0;
 }
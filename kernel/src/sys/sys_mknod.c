@@ -25,38 +25,11 @@
 #include <string.h>
 
 
-static void split_path(const char *filepath, char *parent, char *name)
-{
-    int i, k;
-
-    i = strlen(filepath);
-    while (i > 0) {
-        i--;
-        if (filepath[i] == '/')
-            break;
-    }
-    if (i > 0) {
-        k = (*filepath == '/') ? 1 : 0;
-        strncpy(parent, filepath, i);
-        strcpy(name, filepath + i + k);
-    } else {
-        parent[i++] = '/';
-        if (filepath[i] != '\0') {
-            strcpy(name, filepath + i);
-        } else {
-            name[0] = '.';
-            name[1] = '\0';
-        }
-    }
-    parent[i] = '\0';
-}
-
-
 int sys_mknod(const char *pathname, mode_t mode, dev_t dev)
 {
     int res;
     struct dentry *dent;
-    const struct dentry *dnew;
+    struct dentry *dnew;
     char parent[PATH_MAX];
     char name[NAME_MAX];
 
@@ -66,21 +39,25 @@ int sys_mknod(const char *pathname, mode_t mode, dev_t dev)
         return -EEXIST;
     }
 
-    split_path(pathname, parent, name);
+    res = path_split(pathname, parent, name);
+    if (res < 0)
+        return res;
 
     dent = named(parent);
     if (dent == NULL)
-        return -1;
+        return -ENOENT;
 
-    res = vfs_mknod(dent->inod, mode, dev);
+    res = vfs_mknod(dent->inod, name, mode, dev);
 
     /*
-     * Create a dentry and keep a reference to it.
+     * Create the dentry, it stays cached after the reference is released.
      */
     if (res == 0) {
         dnew = dget(dent, name);
         if (dnew == NULL)
             res = -1;
+        else
+            dput(dnew);
     }
     dput(dent);
     return res;
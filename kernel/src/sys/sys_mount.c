@@ -20,6 +20,7 @@
 #include "sys.h"
 #include "fs/vfs.h"
 #include "fs/devfs/devfs.h"
+#include "fs/tmpfs/tmpfs.h"
 #include "proc.h"
 #include <errno.h>
 #include <sys/stat.h>
@@ -30,15 +31,34 @@ int sys_mount(const char *source, const char *target,
               const void *data)
 {
     struct dentry *dst, *src;
+    struct super_block *sb;
+    int ret;
 
     dst = named(target);
     if (dst == NULL)
         return -ENOENT;
 
-    if (strcmp(fs_type, "dev") == 0)
+    if (strcmp(fs_type, "dev") == 0) {
         src = devfs_sb_get()->root;
-    else
+    } else if (strcmp(fs_type, "tmpfs") == 0) {
+        /* Checked first, an instance can't be released */
+        ret = tmpfs_options(NULL, (const char *)data);
+        if (ret < 0)
+            return ret;
+        /* A new instance for each mount, the source is ignored */
+        sb = vfs_super_create(0, fs_type);
+        if (sb == NULL)
+            return -ENOMEM;
+        tmpfs_options(sb, (const char *)data);
+        src = sb->root;
+    } else if (strcmp(fs_type, "proc") == 0) {
+        sb = vfs_super_create(0, fs_type);
+        if (sb == NULL)
+            return -ENOMEM;
+        src = sb->root;
+    } else {
         src = named(source);
+    }
 
     return do_mount(dst, src);
 }
@@ -20,48 +20,84 @@
 #include "sys.h"
 #include "proc.h"
 #include "timer.h"
+#include "hrtimer.h"
+#include "arch/x86/paging.h"
 #include <unistd.h>
 #include <errno.h>
 
 
+struct sleeper {
+    struct task *task;
+    int         expired;
+};
+
 static void sleep_timer_handler(void *data)
 {
-    struct task *t = (struct task *)data;
+    struct sleeper *sl = (struct sleeper *)data;
 
-    t->state = TASK_RUNNING;
+    sl->expired = 1;
+    sched_wakeup(sl->task);
 }
 
+/*
+ * Whole ticks are slept on the timer wheel, the last (sub) ticks with a
+ * high resolution timer. Without the high resolution hardware the
+ * sleep is rounded up to the next tick.
+ */
 int sys_nanosleep(const struct timespec *req, struct timespec *rem)
 {
-    unsigned long ms, when, now;
+    uint64_t now, deadline, left;
     struct timer_event tm;
+    struct hrtimer_event hr;
+    struct sleeper sl;
+    int hires = hrtimer_available();
 
     if ((long)req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec > 999999999)
         return -EINVAL;
+    if (page_user_writable(rem, sizeof(*rem)) < 0)
+        return -EFAULT;
 
-    current->state = TASK_SLEEPING;
+    now = timer_monotonic();
+    deadline = now + (uint64_t)req->tv_sec * NSECS_PER_SEC + req->tv_nsec;
 
-    ms   = (unsigned long)req->tv_sec * 1000 +
-           (unsigned long)req->tv_nsec / 1000000;
-    when = timer_ticks + msecs_to_ticks(ms);
-    timer_event_init(&tm, sleep_timer_handler, current, when);
+    sl.task = current;
+    sl.expired = 1;
+    timer_event_init(&tm, sleep_timer_handler, &sl, 0);
+    hrtimer_event_init(&hr, sleep_timer_handler, &sl, deadline);
 
     /* Do this after the timer initialization but before queue insertion */
     list_insert_before(&current->timers, &tm.plink);
 
-    timer_event_add(&tm);
+    while (now < deadline) {
+        left = deadline - now;
+        if (hires && left <= 2 * NSECS_PER_TICK) {
+            hrtimer_event_add(&hr);
+        } else {
+            left = hires ? left / NSECS_PER_TICK - 1 :
+                           (left + NSECS_PER_TICK - 1) / NSECS_PER_TICK;
+            timer_event_mod(&tm, (unsigned long)timer_ticks + left);
+        }
+        sl.expired = 0;
+        current->state = TASK_SLEEPING;
+        scheduler();
 
-    scheduler();
+        /* In case of an early wakeup we are still linked */
+        timer_event_del(&tm);
+        hrtimer_event_del(&hr);
+        if (sl.expired == 0 || !hires)
+            break;
+        now = timer_monotonic();
+    }
 
-    list_delete(&tm.link); /* in case of an early wakeup we are still linked */
     list_delete(&tm.plink);
 
-    now = timer_ticks;
-    if (now < when) {
-        ms = ticks_to_msecs(when - now);
-        rem->tv_sec  = (time_t)(ms / 1000);
-        rem->tv_nsec = (long)  (ms % 1000) * 1000000;
-        return -EINTR; /* Early wakeup */
+    if (sl.expired == 0) {
+        left = deadline - timer_monotonic();
+        if ((int64_t)left > 0) {
+            rem->tv_sec  = (time_t)(left / NSECS_PER_SEC);
+            rem->tv_nsec = (long)  (left % NSECS_PER_SEC);
+            return -EINTR; /* Early wakeup */
+        }
     }
 
     rem->tv_sec = 0;
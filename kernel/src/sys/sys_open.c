@@ -28,7 +28,7 @@
 
 int sys_open(const char *pathname, int flags, mode_t mode)
 {
-    int fdn;
+    int fdn, res;
     struct file *fil;
     struct dentry *dent;
 
@@ -36,9 +36,27 @@ int sys_open(const char *pathname, int flags, mode_t mode)
         return -EINVAL;
 
     dent = named(pathname);
+    if (dent != NULL && (flags & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) {
+        dput(dent);
+        return -EEXIST;
+    }
+    if (dent == NULL && (flags & O_CREAT) != 0) {
+        res = sys_mknod(pathname, S_IFREG | (mode & 0777), 0);
+        if (res < 0 && (res != -EEXIST || (flags & O_EXCL) != 0))
+            return res;
+        dent = named(pathname);
+    }
     if (dent == NULL)
         return -ENOENT;
 
+    if ((flags & O_TRUNC) != 0 && S_ISREG(dent->inod->mode)) {
+        res = vfs_truncate(dent->inod, 0);
+        if (res < 0) {
+            dput(dent);
+            return res;
+        }
+    }
+
     if (current->pid == current->pgid &&
         (flags & O_NOCTTY) == 0 &&
         strcmp(pathname, "/dev/tty") == 0) {
@@ -20,9 +20,13 @@
 
 #include "sys.h"
 #include "ipc/pipe.h"
+#include "arch/x86/paging.h"
+#include <errno.h>
 
 
 int sys_pipe(int pipefd[2])
 {
+    if (page_user_writable(pipefd, 2 * sizeof(int)) < 0)
+        return -EFAULT;
     return pipe_create(pipefd);
 }
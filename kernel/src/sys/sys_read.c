@@ -21,6 +21,7 @@
 #include "dev.h"
 #include "fs/vfs.h"
 #include "proc.h"
+#include "arch/x86/paging.h"
 #include <stddef.h>
 #include <errno.h>
 #include <limits.h>
@@ -35,21 +36,28 @@ ssize_t sys_read(int fd, void *buf, size_t count)
         return -EBADF;
 
     fil = current->fds[fd].fil;
+    if (page_user_writable(buf, count) < 0)
+        return -EFAULT;
 
     switch (fil->dent->inod->mode & S_IFMT) {
+    case S_IFREG:
+        vfs_readahead(fil, count);
+        n = vfs_read(fil->dent->inod, buf, count, fil->off);
+        break;
     case S_IFBLK:
     case S_IFCHR:
-    case S_IFREG:
     case S_IFIFO:
     case S_IFSOCK:
         n = vfs_read(fil->dent->inod, buf, count, fil->off);
         break;
     case S_IFDIR:
-        n = fil->off/sizeof(struct dirent);
-        n = vfs_readdir(fil->dent, n, (struct dirent *)buf);
-        if (n == 0)
+        /* One entry at a time, the offset is the directory cursor */
+        if (count < sizeof(struct dirent))
+            return -EINVAL;
+        n = vfs_getdents(fil->dent, &fil->off, (struct dirent *)buf, 1);
+        if (n > 0)
             n = sizeof(struct dirent);
-        break;
+        return n;
     default:
         n = -1;
         break;
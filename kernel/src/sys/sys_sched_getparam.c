@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "proc.h"
+#include "arch/x86/paging.h"
+#include <sys/types.h>
+#include <sched.h>
+#include <errno.h>
+
+/*
+ * Gets the real-time priority of the process specified by pid (zero for
+ * the calling process). Time sharing processes have a zero priority.
+ */
+int sys_sched_getparam(pid_t pid, struct sched_param *param)
+{
+    const struct task *t;
+
+    if (param == NULL)
+        return -EINVAL;
+    if (page_user_writable(param, sizeof(*param)) < 0)
+        return -EFAULT;
+    t = (pid == 0) ? current : task_find(pid);
+    if (t == NULL || t->state == TASK_ZOMBIE)
+        return -ESRCH;
+    param->sched_priority = t->rt_priority;
+    return 0;
+}
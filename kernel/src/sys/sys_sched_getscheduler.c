@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "proc.h"
+#include <sys/types.h>
+#include <errno.h>
+
+/*
+ * Returns the scheduling policy of the process specified by pid (zero
+ * for the calling process).
+ */
+int sys_sched_getscheduler(pid_t pid)
+{
+    const struct task *t;
+
+    t = (pid == 0) ? current : task_find(pid);
+    if (t == NULL || t->state == TASK_ZOMBIE)
+        return -ESRCH;
+    return t->policy;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "proc.h"
+#include <sys/types.h>
+#include <sched.h>
+#include <errno.h>
+
+/*
+ * Sets the scheduling policy and the real-time priority of the process
+ * specified by pid (zero for the calling process).
+ * Only the super user can select a real-time policy.
+ */
+int sys_sched_setscheduler(pid_t pid, int policy,
+                           const struct sched_param *param)
+{
+    struct task *t;
+    int prio;
+
+    if (param == NULL)
+        return -EINVAL;
+    prio = param->sched_priority;
+    if (policy == SCHED_OTHER) {
+        if (prio != 0)
+            return -EINVAL;
+    } else if (policy == SCHED_FIFO || policy == SCHED_RR) {
+        if (prio < SCHED_RT_PRIO_MIN || prio > SCHED_RT_PRIO_MAX)
+            return -EINVAL;
+    } else {
+        return -EINVAL;
+    }
+
+    t = (pid == 0) ? current : task_find(pid);
+    if (t == NULL || t == &ktask || t->state == TASK_ZOMBIE)
+        return -ESRCH;
+    if (current->euid != 0 && current->euid != t->uid)
+        return -EPERM;
+    if (current->euid != 0 && policy != SCHED_OTHER)
+        return -EPERM;
+
+    sched_policy_set(t, policy, prio);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "proc.h"
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <errno.h>
+
+/*
+ * Sets the nice value of the processes selected by which and who.
+ * A zero who selects the calling process, process group or user.
+ * Values out of range are clamped. Only the super user can lower the
+ * nice value or change processes owned by other users.
+ */
+int sys_setpriority(int which, id_t who, int prio)
+{
+    struct task *t = current;
+    int found = 0, ret = 0;
+
+    if (which != PRIO_PROCESS && which != PRIO_PGRP && which != PRIO_USER)
+        return -EINVAL;
+    if (who == 0) {
+        if (which == PRIO_PROCESS)
+            who = current->pid;
+        else if (which == PRIO_PGRP)
+            who = current->pgid;
+        else
+            who = current->uid;
+    }
+    if (prio < SCHED_NICE_MIN)
+        prio = SCHED_NICE_MIN;
+    else if (prio > SCHED_NICE_MAX)
+        prio = SCHED_NICE_MAX;
+
+    do {
+        if (t != &ktask && t->state != TASK_ZOMBIE &&
+            ((which == PRIO_PROCESS && t->pid == (pid_t)who) ||
+             (which == PRIO_PGRP && t->pgid == (pid_t)who) ||
+             (which == PRIO_USER && t->uid == (uid_t)who))) {
+            found = 1;
+            if (current->euid != 0 && current->euid != t->uid)
+                ret = -EPERM;
+            else if (current->euid != 0 && prio < t->nice)
+                ret = -EACCES;
+            else
+                sched_nice_set(t, prio);
+        }
+        t = list_container(t->tasks.next, struct task, tasks);
+    } while (t != current);
+
+    return (found != 0) ? ret : -ESRCH;
+}
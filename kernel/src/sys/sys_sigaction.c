@@ -19,6 +19,7 @@
 
 #include "sys.h"
 #include "proc.h"
+#include "arch/x86/paging.h"
 #include <errno.h>
 
 int sys_sigaction(int sig, const struct sigaction *act,
@@ -31,6 +32,8 @@ int sys_sigaction(int sig, const struct sigaction *act,
     if (sig == SIGSTOP || sig == SIGKILL)
         return 0;
 
+    if (oact != NULL && page_user_writable(oact, sizeof(*oact)) < 0)
+        return -EFAULT;
     if (oact != NULL)
         *oact = current->signals[sig-1];
     current->signals[sig-1] = *act;
@@ -19,6 +19,7 @@
 
 #include "sys.h"
 #include "proc.h"
+#include "arch/x86/paging.h"
 #include <errno.h>
 
 int sys_sigprocmask(int how, const sigset_t *set, sigset_t *oset)
@@ -26,6 +27,8 @@ int sys_sigprocmask(int how, const sigset_t *set, sigset_t *oset)
     int sig;
     int res = 0;
 
+    if (oset != NULL && page_user_writable(oset, sizeof(*oset)) < 0)
+        return -EFAULT;
     if (oset != NULL)
         memcpy(oset, &current->sigmask, sizeof(sigset_t));
 
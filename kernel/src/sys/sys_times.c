@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "proc.h"
+#include "timer.h"
+#include <sys/times.h>
+
+/*
+ * Fills the process and waited children CPU times, if buf is not NULL.
+ * Returns the elapsed clock ticks since boot.
+ */
+unsigned int sys_times(struct tms *buf)
+{
+    if (buf != NULL) {
+        buf->tms_utime = sched_acct_ticks(current->utime);
+        buf->tms_stime = sched_acct_ticks(current->stime);
+        buf->tms_cutime = sched_acct_ticks(current->cutime);
+        buf->tms_cstime = sched_acct_ticks(current->cstime);
+    }
+    return (unsigned int)timer_ticks;
+}
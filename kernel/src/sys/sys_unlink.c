@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "sys.h"
+#include "fs/vfs.h"
+#include <limits.h>
+#include <errno.h>
+#include <string.h>
+
+int sys_unlink(const char *pathname)
+{
+    int res;
+    struct dentry *dir;
+    char parent[PATH_MAX];
+    char name[NAME_MAX];
+
+    if (pathname == NULL)
+        return -EINVAL;
+
+    res = path_split(pathname, parent, name);
+    if (res < 0)
+        return res;
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+        return -EINVAL;
+
+    dir = named(parent);
+    if (dir == NULL)
+        return -ENOENT;
+
+    res = vfs_unlink(dir, name);
+    dput(dir);
+    return res;
+}
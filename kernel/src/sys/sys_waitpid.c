@@ -20,6 +20,7 @@
 #include "sys.h"
 #include "proc.h"
 #include "util.h"
+#include "arch/x86/paging.h"
 #include <sys/wait.h>
 
 /*
@@ -32,6 +33,9 @@ pid_t sys_waitpid(pid_t pid, int *wstatus, int options)
     int havekids;
     int retry;
 
+    if (wstatus != NULL && page_user_writable(wstatus, sizeof(int)) < 0)
+        return -EFAULT;
+
     spinlock_lock(&current->chld_exit.lock);
 
     do {
@@ -47,6 +51,8 @@ pid_t sys_waitpid(pid_t pid, int *wstatus, int options)
                     pid = t->pid;
                     if (wstatus != NULL)
                         *wstatus = t->exit_code;
+                    current->cutime += t->utime + t->cutime;
+                    current->cstime += t->stime + t->cstime;
                     /* resources already released by the sys_exit */
                     list_delete(&t->tasks);
                     list_delete(&t->children);
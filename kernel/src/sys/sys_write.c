@@ -37,6 +37,9 @@ ssize_t sys_write(int fd, const void *buf, size_t count)
 
     fil = current->fds[fd].fil;
 
+    if ((fil->flags & O_APPEND) != 0 && S_ISREG(fil->dent->inod->mode))
+        fil->off = fil->dent->inod->size;
+
     switch (fil->dent->inod->mode & S_IFMT) {
     case S_IFBLK:
     case S_IFCHR:
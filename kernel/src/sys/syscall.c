@@ -24,7 +24,7 @@
 #include <unistd.h>
 
 
-#define SYSCALLS_NUM    (__NR_info + 1)
+#define SYSCALLS_NUM    (__NR_clock_gettime + 1)
 
 static const void *syscalls[SYSCALLS_NUM] = {
     [__NR_exit]         = sys_exit,
@@ -64,6 +64,19 @@ static const void *syscalls[SYSCALLS_NUM] = {
     [__NR_setgid]       = sys_setgid,
     [__NR_clock]        = sys_clock,
     [__NR_info]         = sys_info,
+    [__NR_getdents]     = sys_getdents,
+    [__NR_unlink]       = sys_unlink,
+    [__NR_sync]         = sys_sync,
+    [__NR_fsync]        = sys_fsync,
+    [__NR_ftruncate]    = sys_ftruncate,
+    [__NR_getpriority]  = sys_getpriority,
+    [__NR_setpriority]  = sys_setpriority,
+    [__NR_sched_setscheduler] = sys_sched_setscheduler,
+    [__NR_sched_getscheduler] = sys_sched_getscheduler,
+    [__NR_sched_getparam]     = sys_sched_getparam,
+    [__NR_times]        = sys_times,
+    [__NR_getrusage]    = sys_getrusage,
+    [__NR_clock_gettime] = sys_clock_gettime,
 };
 
 
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "timepage.h"
+#include "timer.h"
+#include "panic.h"
+#include "mm/frame.h"
+#include "arch/x86/paging.h"
+#include <string.h>
+
+struct time_page *timepage;
+
+static uint32_t timepage_phys;
+
+int timepage_map(void)
+{
+    int ret;
+
+    if (timepage == NULL)
+        return 0;
+    ret = (int)page_map_shared((void *)TIME_PAGE_ADDR, timepage_phys);
+    return (ret < 0) ? ret : 0;
+}
+
+void timepage_init(uint32_t khz, uint64_t boot_cycles)
+{
+    /* Low memory, thus directly accessible by the kernel */
+    timepage_phys = (uint32_t)frame_alloc(0, ZONE_LOW);
+    if (timepage_phys == 0)
+        panic("Unable to allocate the time page");
+    timepage = (struct time_page *)phys_to_virt((void *)timepage_phys);
+    memset(timepage, 0, PAGE_SIZE);
+    timepage->cycles_khz = khz;
+    timepage->boot_cycles = boot_cycles;
+    timepage->realtime_base = timer_realtime_base;
+    timepage->ticks = timer_ticks;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_TIMEPAGE_H_
+#define BEEOS_TIMEPAGE_H_
+
+#include <sys/timepage.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Kernel mapping of the time page */
+extern struct time_page *timepage;
+
+/* Begin a time page update, the readers retry until the end. */
+static inline void timepage_write_begin(void)
+{
+    timepage->seq++;
+    asm volatile("" : : : "memory");
+}
+
+/* End a time page update. */
+static inline void timepage_write_end(void)
+{
+    asm volatile("" : : : "memory");
+    timepage->seq++;
+}
+
+/**
+ * Publish the clock ticks.
+ *
+ * @param ticks     Clock ticks since system startup.
+ */
+static inline void timepage_ticks_set(clock_t ticks)
+{
+    if (timepage == NULL)
+        return;
+    timepage_write_begin();
+    timepage->ticks = ticks;
+    timepage_write_end();
+}
+
+/**
+ * Publish the CPU time of the process that is going to run.
+ *
+ * @param cycles    CPU time, in cycles.
+ * @param stamp     Cycles count when the CPU time was taken.
+ */
+static inline void timepage_cpu_set(uint64_t cycles, uint64_t stamp)
+{
+    if (timepage == NULL)
+        return;
+    timepage_write_begin();
+    timepage->cpu_cycles = cycles;
+    timepage->cpu_stamp = stamp;
+    timepage_write_end();
+}
+
+/**
+ * Map the time page, read-only, in the current process user space.
+ *
+ * @return  Zero on success, a negative error code on failure.
+ */
+int timepage_map(void);
+
+/**
+ * Allocate and initialize the time page.
+ * Called once the cycles counter is calibrated.
+ *
+ * @param khz           Cycles frequency, zero if unknown.
+ * @param boot_cycles   Cycles count at system startup.
+ */
+void timepage_init(uint32_t khz, uint64_t boot_cycles);
+
+#endif /* BEEOS_TIMEPAGE_H_ */
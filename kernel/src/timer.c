@@ -18,32 +18,136 @@
  */
 
 #include "timer.h"
+#include "hrtimer.h"
+#include "timepage.h"
 #include "proc.h"
 
 clock_t timer_ticks = 0;
 
-/* Timer events queue. */
-static struct list_link timer_events;
+time_t timer_realtime_base = 0;
+
+/*
+ * Hierarchical timer wheel.
+ * The first level has a slot for each of the next TVR_SIZE ticks, every
+ * slot of the next levels covers the whole span of the previous level.
+ * When the first level wraps around, the events of the next slot of the
+ * second level are redistributed (cascaded) to the lower levels, and so
+ * on. Add, delete and per tick processing are constant time.
+ */
+#define TVN_BITS    6
+#define TVR_BITS    8
+#define TVN_SIZE    (1 << TVN_BITS)
+#define TVR_SIZE    (1 << TVR_BITS)
+#define TVN_MASK    (TVN_SIZE - 1)
+#define TVR_MASK    (TVR_SIZE - 1)
+#define TVN_LEVELS  4
+
+/* Index of an expiration time within the n-th upper level */
+#define TVN_INDEX(expires, n) \
+    (((expires) >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+static struct list_link tv_root[TVR_SIZE];
+static struct list_link tv_levels[TVN_LEVELS][TVN_SIZE];
+
+/* Next tick to process */
+static unsigned long wheel_ticks;
+
+/* Next load average sample */
+static clock_t load_next;
+
+/* The periodic tick is stopped */
+static int idle_nohz;
 
 /**
  * Architecture dependent timer initialization.
  */
 void timer_arch_init(void);
 
+/**
+ * Program the timer to fire once after the given ticks.
+ * Returns the programmed ticks, may be less than requested.
+ */
+unsigned int timer_arch_oneshot(unsigned int ticks);
 
-void timer_event_add(struct timer_event *tm)
+/**
+ * Restore the periodic tick after a one-shot programming.
+ * Returns the elapsed ticks not accounted by a timer interrupt.
+ */
+unsigned int timer_arch_periodic(void);
+
+
+static void wheel_insert(struct timer_event *tm)
 {
-    const struct timer_event *e;
-    struct list_link *curr;
+    unsigned long expires = tm->expires;
+    unsigned long idx = expires - wheel_ticks;
+    struct list_link *vec;
 
-    curr = timer_events.next;
-    while (curr != &timer_events) {
-        e = list_container(curr, struct timer_event, link);
-        if (e->expires > tm->expires)
-            break;
-        curr = curr->next;
+    if ((long)idx < 0) {
+        /* Already expired, fire with the next processed tick */
+        vec = &tv_root[wheel_ticks & TVR_MASK];
+    } else if (idx < TVR_SIZE) {
+        vec = &tv_root[expires & TVR_MASK];
+    } else if (idx < (1UL << (TVR_BITS + TVN_BITS))) {
+        vec = &tv_levels[0][TVN_INDEX(expires, 0)];
+    } else if (idx < (1UL << (TVR_BITS + 2 * TVN_BITS))) {
+        vec = &tv_levels[1][TVN_INDEX(expires, 1)];
+    } else if (idx < (1UL << (TVR_BITS + 3 * TVN_BITS))) {
+        vec = &tv_levels[2][TVN_INDEX(expires, 2)];
+    } else {
+        vec = &tv_levels[3][TVN_INDEX(expires, 3)];
+    }
+    list_insert_before(vec, &tm->link);
+}
+
+/*
+ * Move all the entries of a list to another (empty) list head.
+ */
+static void list_move_all(struct list_link *from, struct list_link *to)
+{
+    list_init(to);
+    if (!list_empty(from)) {
+        list_merge(to, from);
+        list_delete(from);
+    }
+}
+
+/*
+ * Redistribute the events of a slot of the n-th upper level.
+ * Returns the slot index, zero means that the level wrapped around.
+ */
+static unsigned int cascade(int n)
+{
+    unsigned int index = TVN_INDEX(wheel_ticks, n);
+    struct list_link work;
+    struct timer_event *tm;
+
+    list_move_all(&tv_levels[n][index], &work);
+    while (!list_empty(&work)) {
+        tm = list_container(work.next, struct timer_event, link);
+        list_delete(&tm->link);
+        wheel_insert(tm);
     }
-    list_insert_before(curr, &tm->link);
+    return index;
+}
+
+/*
+ * Tick of the next pending event, or of the next cascade.
+ */
+static unsigned long wheel_next_event(void)
+{
+    unsigned long t = wheel_ticks;
+
+    do {
+        if (!list_empty(&tv_root[t & TVR_MASK]))
+            break;
+        t++;
+    } while ((t & TVR_MASK) != 0);
+    return t;
+}
+
+void timer_event_add(struct timer_event *tm)
+{
+    wheel_insert(tm);
 }
 
 void timer_event_del(struct timer_event *tm)
@@ -53,8 +157,9 @@ void timer_event_del(struct timer_event *tm)
 
 void timer_event_mod(struct timer_event *tm, unsigned long expires)
 {
+    list_delete(&tm->link);
     tm->expires = expires;
-    timer_event_add(tm);
+    wheel_insert(tm);
 }
 
 void timer_event_init(struct timer_event *tm, timer_event_t *fn,
@@ -70,23 +175,76 @@ void timer_event_init(struct timer_event *tm, timer_event_t *fn,
 void timer_update(void)
 {
     struct timer_event *tm;
-    struct list_link *curr = timer_events.next;
+    struct list_link work;
+    unsigned int index;
+    int n;
 
-    while (curr != &timer_events) {
-        tm = list_container(curr, struct timer_event, link);
-        curr = curr->next;
-        if (tm->expires <= timer_ticks) {
+    timepage_ticks_set(timer_ticks);
+
+    /* Process all the ticks up to the current one */
+    while ((long)((unsigned long)timer_ticks - wheel_ticks) >= 0) {
+        index = wheel_ticks & TVR_MASK;
+        if (index == 0) {
+            for (n = 0; n < TVN_LEVELS && cascade(n) == 0; n++)
+                ;
+        }
+        list_move_all(&tv_root[index], &work);
+        /* Events re-added by the handlers go to the next tick */
+        wheel_ticks++;
+        while (!list_empty(&work)) {
+            tm = list_container(work.next, struct timer_event, link);
             list_delete(&tm->link);
             tm->func(tm->data);
         }
     }
 
-    if (current->counter-- <= 0)
-        need_resched = 1;
+    if (timer_ticks >= load_next) {
+        load_next = timer_ticks + LOAD_FREQ_SECS * CLOCKS_PER_SEC;
+        sched_load_update();
+    }
+
+    /* No one-shot hardware, the high resolution timers run with the tick */
+    if (!hrtimer_available())
+        hrtimer_update();
+
+    sched_tick();
+}
+
+void timer_idle_enter(void)
+{
+#ifdef TIMER_NOHZ
+    unsigned long now = (unsigned long)timer_ticks;
+    unsigned long next;
+
+    next = wheel_next_event();
+    if ((long)((unsigned long)load_next - next) < 0)
+        next = (unsigned long)load_next;
+    if ((long)(next - now) <= 1)
+        return; /* Keep ticking */
+    timer_arch_oneshot(next - now);
+    idle_nohz = 1;
+#endif
+}
+
+void timer_idle_exit(void)
+{
+    if (idle_nohz == 0)
+        return;
+    idle_nohz = 0;
+    timer_ticks += timer_arch_periodic();
 }
 
 void timer_init(void)
 {
-    list_init(&timer_events);
+    int i, n;
+
+    for (i = 0; i < TVR_SIZE; i++)
+        list_init(&tv_root[i]);
+    for (n = 0; n < TVN_LEVELS; n++) {
+        for (i = 0; i < TVN_SIZE; i++)
+            list_init(&tv_levels[n][i]);
+    }
+    wheel_ticks = (unsigned long)timer_ticks;
     timer_arch_init();
+    hrtimer_init();
 }
@@ -25,9 +25,22 @@
 #include <time.h>
 
 
+/*
+ * Dynamic tick: when idle the periodic tick is stopped and the timer is
+ * programmed for the next pending event (comment out to disable).
+ */
+#define TIMER_NOHZ
+
 /* Clock ticks since system startup. */
 extern clock_t timer_ticks;
 
+/* Wall clock time at system startup, seconds since the Epoch. */
+extern time_t timer_realtime_base;
+
+/** Nanoseconds per second and per clock tick. */
+#define NSECS_PER_SEC   1000000000ULL
+#define NSECS_PER_TICK  (NSECS_PER_SEC / CLOCKS_PER_SEC)
+
 /** Converts milliseconds to clock ticks. */
 #define msecs_to_ticks(msecs) \
         (((unsigned long)(msecs) + (1000L / CLOCKS_PER_SEC) - 1) / (1000L / CLOCKS_PER_SEC))
@@ -61,7 +74,8 @@ void timer_event_init(struct timer_event *tm, timer_event_t *fn,
 
 /**
  * Adds a timer event to the timers queue.
- * The event will be fired after the delay specified with the init function.
+ * The event will be fired at the expiration time specified with the init
+ * function.
  *
  * @param tm        Timer event context.
  */
@@ -76,16 +90,25 @@ void timer_event_add(struct timer_event *tm);
 void timer_event_del(struct timer_event *tm);
 
 /**
- * Adds a timer queue to the timers queue.
- * This function also specifies the expration time in ticks.
- * If the expration time is less than or equal the current 'timer_ticks'
- * value the event is immediatelly executed.
+ * Changes the expiration time of a timer event, (re)adding it to the
+ * timers queue.
+ * If the expiration time is less than or equal the current 'timer_ticks'
+ * value the event fires with the next tick.
  *
  * @param tm        Timer event structure.
  * @param expires   Event expiration time, in system ticks.
  */
 void timer_event_mod(struct timer_event *tm, unsigned long expires);
 
+/**
+ * Monotonic clock.
+ * Backed by the calibrated time stamp counter, if any, else by the
+ * clock ticks.
+ *
+ * @return  Nanoseconds since system startup.
+ */
+uint64_t timer_monotonic(void);
+
 /**
  * Initialize the timer event queue.
  */
@@ -98,4 +121,19 @@ void timer_init(void);
  */
 void timer_update(void);
 
+/**
+ * Enter the idle state.
+ * With TIMER_NOHZ the periodic tick is replaced by a one-shot timer
+ * expiring with the next pending timer event. To be called with the
+ * interrupts disabled, just before halting the processor.
+ */
+void timer_idle_enter(void);
+
+/**
+ * Leave the idle state.
+ * Restores the periodic tick and brings 'timer_ticks' up to date.
+ * Called at every interrupt, does nothing if not idle.
+ */
+void timer_idle_exit(void);
+
 #endif /* BEEOS_TIMER_H_ */
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef _ARCH_X86_TIMEPAGE_H_
+#define _ARCH_X86_TIMEPAGE_H_
+
+#include <stdint.h>
+
+/** Time page user virtual address, just below the user code. */
+#define TIME_PAGE_ADDR  0x07FFF000
+
+/**
+ * Read the time stamp counter, the time page cycles source.
+ */
+static inline uint64_t time_page_cycles(void)
+{
+    uint32_t lo, hi;
+
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#endif /* _ARCH_X86_TIMEPAGE_H_ */
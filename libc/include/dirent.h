@@ -29,9 +29,14 @@ struct dirent {
     char    d_name[NAME_MAX+1];     /** Directory name */
 };
 
+/** Number of entries fetched by a single getdents call. */
+#define DIR_BUF_ENTRIES 16
+
 typedef struct DIR {
     int    fdn;          /** Directory file descriptor */
-    struct dirent dent;  /** Last directory entry */
+    int    cur;          /** Next entry within the buffer */
+    int    num;          /** Number of valid entries within the buffer */
+    struct dirent dents[DIR_BUF_ENTRIES];  /** Directory entries buffer */
 } DIR;
 
 DIR *opendir(const char *name);
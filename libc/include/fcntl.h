@@ -29,6 +29,7 @@
 #define O_WRONLY        01       /**< Write access */
 #define O_RDWR          02       /**< Read/write access */
 #define O_CREAT         0100     /**< Create if not exists (not fcntl) */
+#define O_EXCL          0200     /**< Fail if O_CREAT and exists (not fcntl) */
 #define O_TRUNC         01000    /**< Truncate if exists (not fcntl) */
 #define O_APPEND        02000    /**< Append if exists */
 #define O_NONBLOCK      04000    /**< Open in non blocking mode (read/write) */
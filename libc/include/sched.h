@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_SCHED_H_
+#define BEEOS_SCHED_H_
+
+#include <unistd.h>
+
+/* Scheduling policies */
+#define SCHED_OTHER     0   /* Time sharing, nice based */
+#define SCHED_FIFO      1   /* Real-time, first in first out */
+#define SCHED_RR        2   /* Real-time, round robin */
+
+/* Real-time static priorities range, higher values run first */
+#define SCHED_RT_PRIO_MIN   1
+#define SCHED_RT_PRIO_MAX   99
+
+struct sched_param {
+    int sched_priority;     /* Zero for SCHED_OTHER */
+};
+
+static inline int sched_setscheduler(pid_t pid, int policy,
+                                     const struct sched_param *param)
+{
+    return syscall(__NR_sched_setscheduler, pid, policy, param);
+}
+
+static inline int sched_getscheduler(pid_t pid)
+{
+    return syscall(__NR_sched_getscheduler, pid);
+}
+
+static inline int sched_getparam(pid_t pid, struct sched_param *param)
+{
+    return syscall(__NR_sched_getparam, pid, param);
+}
+
+static inline int sched_get_priority_max(int policy)
+{
+    return (policy == SCHED_OTHER) ? 0 : SCHED_RT_PRIO_MAX;
+}
+
+static inline int sched_get_priority_min(int policy)
+{
+    return (policy == SCHED_OTHER) ? 0 : SCHED_RT_PRIO_MIN;
+}
+
+#endif /* BEEOS_SCHED_H_ */
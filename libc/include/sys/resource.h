@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_SYS_RESOURCE_H_
+#define BEEOS_SYS_RESOURCE_H_
+
+#include <unistd.h>
+#include <sys/time.h>
+
+/* Values for the 'which' argument of getpriority and setpriority */
+#define PRIO_PROCESS    0
+#define PRIO_PGRP       1
+#define PRIO_USER       2
+
+/* Values for the 'who' argument of getrusage */
+#define RUSAGE_SELF     0
+#define RUSAGE_CHILDREN (-1)
+
+struct rusage {
+    struct timeval  ru_utime;   /**> User CPU time */
+    struct timeval  ru_stime;   /**> System CPU time */
+    long            ru_minflt;  /**> Page faults */
+    long            ru_nvcsw;   /**> Voluntary context switches */
+    long            ru_nivcsw;  /**> Involuntary context switches */
+};
+
+/*
+ * The kernel returns '20 - nice' to never return a negative value,
+ * otherwise indistinguishable from an error.
+ */
+static inline int getpriority(int which, id_t who)
+{
+    int ret;
+
+    ret = syscall(__NR_getpriority, which, who);
+    return (ret < 0) ? ret : 20 - ret;
+}
+
+static inline int setpriority(int which, id_t who, int prio)
+{
+    return syscall(__NR_setpriority, which, who, prio);
+}
+
+/*
+ * For RUSAGE_CHILDREN only the CPU times of the terminated and waited
+ * children are reported.
+ */
+static inline int getrusage(int who, struct rusage *usage)
+{
+    return syscall(__NR_getrusage, who, usage);
+}
+
+#endif /* BEEOS_SYS_RESOURCE_H_ */
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_SYS_TIMEPAGE_H_
+#define BEEOS_SYS_TIMEPAGE_H_
+
+#include <arch/x86/timepage.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Time data page.
+ * Maintained by the kernel and mapped read-only at TIME_PAGE_ADDR in
+ * every process, allows to read the clocks without a syscall.
+ * The sequence counter is odd while the kernel is updating the page,
+ * a reader retries if the counter changed while reading.
+ */
+struct time_page {
+    volatile uint32_t seq;      /**< Sequence counter */
+    uint32_t cycles_khz;        /**< Cycles frequency, zero if unknown */
+    uint64_t boot_cycles;       /**< Cycles count at system startup */
+    time_t   realtime_base;     /**< Wall clock time at system startup */
+    clock_t  ticks;             /**< Clock ticks since system startup */
+    uint64_t cpu_cycles;        /**< Current process CPU time at cpu_stamp */
+    uint64_t cpu_stamp;         /**< Cycles count of the last CPU time update */
+};
+
+#endif /* BEEOS_SYS_TIMEPAGE_H_ */
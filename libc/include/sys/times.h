@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef BEEOS_SYS_TIMES_H_
+#define BEEOS_SYS_TIMES_H_
+
+#include <unistd.h>
+#include <time.h>
+
+/* Process times in clock ticks */
+struct tms {
+    clock_t tms_utime;      /**> User CPU time */
+    clock_t tms_stime;      /**> System CPU time */
+    clock_t tms_cutime;     /**> User CPU time of terminated children */
+    clock_t tms_cstime;     /**> System CPU time of terminated children */
+};
+
+/*
+ * Returns the elapsed clock ticks since boot.
+ * The buffer may be NULL to get only the elapsed time.
+ */
+static inline clock_t times(struct tms *buf)
+{
+    return (clock_t)(unsigned int)syscall(__NR_times, buf);
+}
+
+#endif /* BEEOS_SYS_TIMES_H_ */
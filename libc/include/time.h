@@ -30,6 +30,28 @@ struct timespec {
 
 #define CLOCKS_PER_SEC ((clock_t) 100)
 
+typedef int clockid_t;
+
+#define CLOCK_REALTIME  0   /**> Wall clock time, since the Epoch */
+#define CLOCK_MONOTONIC 1   /**> Time since system startup */
+
 clock_t clock(void);
 
+/**
+ * Get the time of a clock, with nanoseconds resolution.
+ *
+ * @param id    Clock identifier.
+ * @param ts    Time value.
+ * @return      Zero on success, -1 on error.
+ */
+int clock_gettime(clockid_t id, struct timespec *ts);
+
+/**
+ * Get the wall clock time.
+ *
+ * @param t     If not NULL, also stores the time here.
+ * @return      Seconds since the Epoch.
+ */
+time_t time(time_t *t);
+
 #endif /* _TIME_H_ */
@@ -65,6 +65,19 @@
 #define __NR_clock          38
 /* Custom info syscall */
 #define __NR_info           39
+#define __NR_getdents       40
+#define __NR_unlink         41
+#define __NR_sync           42
+#define __NR_fsync          43
+#define __NR_ftruncate      44
+#define __NR_getpriority    45
+#define __NR_setpriority    46
+#define __NR_sched_setscheduler 47
+#define __NR_sched_getscheduler 48
+#define __NR_sched_getparam     49
+#define __NR_times          50
+#define __NR_getrusage      51
+#define __NR_clock_gettime  52
 
 
 #define STDIN_FILENO        0
@@ -112,6 +125,35 @@ static inline ssize_t write(int fd, const void *buf, size_t count)
     return syscall(__NR_write, fd, buf, count);
 }
 
+/*
+ * Reads as many directory entries (struct dirent) as fit in 'count' bytes.
+ * Returns the number of bytes read, 0 at the end of the directory.
+ */
+static inline int getdents(int fd, void *dirp, unsigned int count)
+{
+    return syscall(__NR_getdents, fd, dirp, count);
+}
+
+static inline int unlink(const char *pathname)
+{
+    return syscall(__NR_unlink, pathname);
+}
+
+static inline void sync(void)
+{
+    syscall(__NR_sync);
+}
+
+static inline int fsync(int fd)
+{
+    return syscall(__NR_fsync, fd);
+}
+
+static inline int ftruncate(int fd, off_t length)
+{
+    return syscall(__NR_ftruncate, fd, length);
+}
+
 static inline int mknod(const char *pathname, mode_t mode, dev_t dev)
 {
     return syscall(__NR_mknod, pathname, mode, dev);
@@ -250,6 +292,8 @@ int access(const char *path, int amode);
 
 int pause(void);
 
+int nice(int inc);
+
 int gethostname(char *name, size_t len);
 
 static inline unsigned int alarm(unsigned int seconds)
@@ -57,7 +57,8 @@ DIR *opendir(const char *name)
     }
 
     dirp->fdn = fdn;
-    memset(&dirp->dent, 0, sizeof(dirp->dent));
+    dirp->cur = 0;
+    dirp->num = 0;
 
     return dirp;
 }
@@ -24,13 +24,20 @@
 
 struct dirent *readdir(DIR *dirp)
 {
+    int n;
+
     if (dirp == NULL || dirp->fdn < 0) {
         errno = EBADF;
         return NULL;
     }
 
-    if (read(dirp->fdn, &dirp->dent, sizeof(dirp->dent)) != sizeof(dirp->dent))
-        return NULL;
+    if (dirp->cur == dirp->num) {
+        n = getdents(dirp->fdn, dirp->dents, sizeof(dirp->dents));
+        if (n <= 0)
+            return NULL;    /* End of directory or errno already set */
+        dirp->cur = 0;
+        dirp->num = n / sizeof(struct dirent);
+    }
 
-    return &dirp->dent;
+    return &dirp->dents[dirp->cur++];
 }
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include <dirent.h>
+#include <stddef.h>
+#include <unistd.h>
+
+void rewinddir(DIR *dirp)
+{
+    if (dirp == NULL || dirp->fdn < 0)
+        return;
+    lseek(dirp->fdn, 0, SEEK_SET);
+    dirp->cur = 0;
+    dirp->num = 0;
+}
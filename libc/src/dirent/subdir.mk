@@ -1,4 +1,5 @@
 local_sources := closedir.c \
 				 DIR.c \
 				 opendir.c \
-				 readdir.c
+				 readdir.c \
+				 rewinddir.c
@@ -17,10 +17,20 @@
  * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
  */
 
+#include "timepage.h"
 #include <time.h>
 #include <unistd.h>
 
+/* Process CPU time, the cycles since the last update are of the caller */
 clock_t clock(void)
 {
-    return syscall(__NR_clock);
+    struct time_page tp;
+    uint64_t now, usecs;
+
+    __timepage_read(&tp, &now);
+    if (tp.cycles_khz == 0)
+        return syscall(__NR_clock);
+    usecs = __timepage_nsecs(&tp, tp.cpu_cycles + (now - tp.cpu_stamp)) /
+            1000;
+    return (clock_t)(usecs / (1000000 / CLOCKS_PER_SEC));
 }
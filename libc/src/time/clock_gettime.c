@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2015-2018, BeeOS Authors. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "timepage.h"
+#include <time.h>
+#include <unistd.h>
+
+#define NSECS_PER_SEC   1000000000ULL
+
+int clock_gettime(clockid_t id, struct timespec *ts)
+{
+    struct time_page tp;
+    uint64_t now, nsecs;
+
+    if (id != CLOCK_REALTIME && id != CLOCK_MONOTONIC)
+        return syscall(__NR_clock_gettime, id, ts);
+
+    __timepage_read(&tp, &now);
+    if (tp.cycles_khz != 0)
+        nsecs = __timepage_nsecs(&tp, now - tp.boot_cycles);
+    else
+        nsecs = (uint64_t)tp.ticks * (NSECS_PER_SEC / CLOCKS_PER_SEC);
+
+    ts->tv_sec = (time_t)(nsecs / NSECS_PER_SEC);
+    ts->tv_nsec = (long)(nsecs % NSECS_PER_SEC);
+    if (id == CLOCK_REALTIME)
+        ts->tv_sec += tp.realtime_base;
+    return 0;
+}
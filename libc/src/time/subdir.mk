@@ -1 +1,4 @@
-local_sources := clock.c
+local_sources := clock.c \
+				 clock_gettime.c \
+				 time.c \
+				 timepage.c
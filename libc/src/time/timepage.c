@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2015-2018, BeeOS Authors. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#include "timepage.h"
+
+#define barrier()   asm volatile("" : : : "memory")
+
+void __timepage_read(struct time_page *tp, uint64_t *now)
+{
+    const struct time_page *kp = (const struct time_page *)TIME_PAGE_ADDR;
+    uint32_t seq;
+
+    do {
+        while (((seq = kp->seq) & 1) != 0)
+            ;
+        barrier();
+        tp->cycles_khz = kp->cycles_khz;
+        tp->boot_cycles = kp->boot_cycles;
+        tp->realtime_base = kp->realtime_base;
+        tp->ticks = kp->ticks;
+        tp->cpu_cycles = kp->cpu_cycles;
+        tp->cpu_stamp = kp->cpu_stamp;
+        *now = time_page_cycles();
+        barrier();
+    } while (kp->seq != seq);
+    tp->seq = seq;
+}
+
+/* Split to not overflow, the remainder is less than the frequency */
+uint64_t __timepage_nsecs(const struct time_page *tp, uint64_t cycles)
+{
+    uint32_t khz = tp->cycles_khz;
+
+    if (khz == 0)
+        return 0;
+    return (cycles / khz) * 1000000 + (cycles % khz) * 1000000 / khz;
+}
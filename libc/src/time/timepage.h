@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2015-2018, BeeOS Authors. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+#ifndef _TIME_TIMEPAGE_H_
+#define _TIME_TIMEPAGE_H_
+
+#include <sys/timepage.h>
+
+/*
+ * Consistent copy of the kernel time page.
+ * Also returns the cycles count taken within the same snapshot.
+ */
+void __timepage_read(struct time_page *tp, uint64_t *now);
+
+/* Cycles to nanoseconds, zero if the frequency is unknown */
+uint64_t __timepage_nsecs(const struct time_page *tp, uint64_t cycles);
+
+#endif /* _TIME_TIMEPAGE_H_ */
@@ -5,5 +5,6 @@ local_sources := environ.c \
 				 execvpe.c \
 				 access.c \
 				 pause.c \
-				 gethostname.c
+				 gethostname.c \
+				 nice.c
 
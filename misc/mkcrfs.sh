@@ -0,0 +1,34 @@
+#!/bin/sh
+
+# Compressed read-only root filesystem image (no root privileges needed)
+
+# Root source
+ROOT_SRC=../user/build/x86
+
+rm -rf crfs_root
+mkdir -p crfs_root
+
+# Copy the sysroot in the destination
+cp -r sysroot/* crfs_root/
+mkdir -p crfs_root/dev
+mkdir -p crfs_root/etc
+mkdir -p crfs_root/home
+mkdir -p crfs_root/tmp
+mkdir -p crfs_root/proc
+cp ../README.md crfs_root/home/README
+cp ../TODO crfs_root/home/TODO
+
+# Create destination directories
+DIRS=`find $ROOT_SRC/* -type d | sed "s|$ROOT_SRC|crfs_root|g"`
+mkdir -p $DIRS
+
+# Copy the files
+SRC_FILES=`find $ROOT_SRC -perm /a+x -type f`
+for f in $SRC_FILES; do
+    d=`echo $f | sed "s|$ROOT_SRC|crfs_root|g"`
+    cp $f $d
+done
+
+# Build the image
+make -C ../user/mkinitrd
+../user/mkinitrd/mkinitrd crfs_root disk.img
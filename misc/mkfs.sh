@@ -6,8 +6,12 @@ ROOT_SRC=../user/build/x86
 umount /dev/loop0
 losetup -d /dev/loop0
 
+# Image size in MiB (optional argument). A larger image, e.g. to hold
+# the readahead test file, is meant to be used as IDE disk (qemu.sh -h).
+SIZE=${1:-1}
+
 # Create the image and make the filesystem
-dd if=/dev/zero of=disk.img bs=1M count=1
+dd if=/dev/zero of=disk.img bs=1M count=$SIZE
 mkfs.ext2 disk.img
 
 # Setup loopback device and mount to a temporary directory
@@ -22,6 +26,8 @@ cp -r sysroot/* tmp/
 mkdir -p tmp/dev
 mkdir -p tmp/etc
 mkdir -p tmp/home
+mkdir -p tmp/tmp
+mkdir -p tmp/proc
 cp ../README.md tmp/home/README
 cp ../TODO tmp/home/TODO
 
@@ -7,9 +7,11 @@ ARCH="x86"
 MEM=12
 KERN="../kernel/build/$ARCH/kernel"
 
-while getopts "da:m:k:" opt; do
+while getopts "da:m:k:h:v:" opt; do
     case "$opt" in
         k) KERN=$OPTARG ;;
+        h) DISK=$OPTARG ;;
+        v) VDISK=$OPTARG ;;
         d) EXTRA="-S -s" ;;
         a) ARCH=$OPTARG ;;
         m) MEM=$OPTARG ;;
@@ -41,6 +43,16 @@ echo "kernel:" $KERN
 
 EXTRA="$EXTRA -initrd disk.img -serial stdio"
 
+# Optional IDE disk, mounted as root in place of the initrd
+if [ -n "$DISK" ]; then
+    EXTRA="$EXTRA -drive file=$DISK,format=raw,if=ide"
+fi
+
+# Optional virtio disk
+if [ -n "$VDISK" ]; then
+    EXTRA="$EXTRA -drive file=$VDISK,format=raw,if=virtio"
+fi
+
 #echo $QEMU -kernel $KERN -m $MEM $ARCH_OPTS $EXTRA
 
 $QEMU -kernel $KERN -m $MEM $ARCH_OPTS $EXTRA &
@@ -17,65 +17,394 @@
  * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
  */
 
-#include "fs/initrd.h"
+/*
+ * Host side compressed read-only file system (crfs) image builder.
+ *
+ * Usage: mkinitrd <root directory> [image]
+ *
+ * Regular files are split in blocks compressed independently with LZ4,
+ * blocks that don't shrink are stored as they are.
+ */
+
+#include "fs/crfs/crfs_fs.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/sysmacros.h>
+
+#define ALIGN_UP(x, a)  (((x) + (a) - 1) & ~((a) - 1))
+
+/* Source tree node, the inode number is the index plus one */
+struct node {
+    char        *path;
+    char        *name;
+    struct stat st;
+    uint32_t    parent;     /* parent inode number */
+    uint32_t    *children;  /* children inode numbers (directories) */
+    uint32_t    nchildren;
+};
 
-static const char *basenam(const char *path)
+static struct node *nodes;
+static uint32_t nnodes;
+
+static uint8_t *img;
+static size_t img_len;
+static size_t img_cap;
+
+/* Statistics */
+static size_t raw_bytes;
+static size_t zip_bytes;
+static unsigned int zip_blocks;
+static unsigned int raw_blocks;
+
+
+static void *xmalloc(size_t size)
 {
-    char *name;
+    void *ptr = malloc(size);
 
-    return (name = strrchr(path, '/')) ? name+1 : path;
+    if (ptr == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    return ptr;
 }
 
-int main(int argc, char *argv[])
+static void *xrealloc(void *ptr, size_t size)
+{
+    ptr = realloc(ptr, size);
+    if (ptr == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+/*
+ * Append data to the image, returns its offset.
+ */
+static size_t img_put(const void *data, size_t n)
+{
+    size_t off = img_len;
+
+    if (img_len + n > img_cap) {
+        img_cap = ALIGN_UP(img_len + n, 1 << 20);
+        img = xrealloc(img, img_cap);
+    }
+    memcpy(img + img_len, data, n);
+    img_len += n;
+    return off;
+}
+
+
+/******************************************************************************
+ *  LZ4 block compression
+ ******************************************************************************/
+
+#define HASH_BITS       12
+#define MIN_MATCH       4
+#define LAST_LITERALS   5   /* the last bytes are always literals */
+#define MF_LIMIT        12  /* no match starts within the last bytes */
+
+static uint32_t hash4(const uint8_t *p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static size_t put_len(uint8_t *dst, size_t len)
+{
+    size_t n = 0;
+
+    while (len >= 255) {
+        dst[n++] = 255;
+        len -= 255;
+    }
+    dst[n++] = len;
+    return n;
+}
+
+static size_t put_literals(uint8_t *dst, const uint8_t *src, size_t lit,
+                           size_t mlen, int last)
+{
+    size_t n = 0;
+
+    dst[n++] = ((lit < 15 ? lit : 15) << 4) |
+               (last ? 0 : (mlen < 15 ? mlen : 15));
+    if (lit >= 15)
+        n += put_len(dst + n, lit - 15);
+    memcpy(dst + n, src, lit);
+    return n + lit;
+}
+
+/*
+ * Greedy compressor. The destination must hold at least
+ * 'n + n / 255 + 16' bytes.
+ */
+static size_t lz4_compress(const uint8_t *src, size_t n, uint8_t *dst)
+{
+    int32_t table[1 << HASH_BITS];
+    size_t ip = 0, anchor = 0, op = 0;
+    size_t len, mlen;
+    uint32_t h;
+    int32_t ref;
+
+    memset(table, 0xff, sizeof(table));
+    while (n > MF_LIMIT && ip < n - MF_LIMIT) {
+        h = hash4(src + ip);
+        ref = table[h];
+        table[h] = ip;
+        if (ref < 0 || ip - ref > 0xffff ||
+            memcmp(src + ref, src + ip, MIN_MATCH) != 0) {
+            ip++;
+            continue;
+        }
+        len = MIN_MATCH;
+        while (ip + len < n - LAST_LITERALS && src[ref + len] == src[ip + len])
+            len++;
+        mlen = len - MIN_MATCH;
+        op += put_literals(dst + op, src + anchor, ip - anchor, mlen, 0);
+        dst[op++] = (ip - ref) & 0xff;
+        dst[op++] = (ip - ref) >> 8;
+        if (mlen >= 15)
+            op += put_len(dst + op, mlen - 15);
+        ip += len;
+        anchor = ip;
+    }
+    op += put_literals(dst + op, src + anchor, n - anchor, 0, 1);
+    return op;
+}
+
+
+/******************************************************************************
+ *  Source tree scan
+ ******************************************************************************/
+
+static int name_cmp(const void *a, const void *b)
 {
-    char *buf;
-    uint32_t nfiles = argc-1;
-    char **names = &argv[1];
-    size_t off = sizeof(struct initrd_header)
-        + (nfiles-1)*sizeof(struct initrd_file_header);
-    struct initrd_file_header *headers = 
-        malloc(nfiles*sizeof(struct initrd_file_header));
-    FILE *fpr, *fpw;
-    int i, j = 0;
-
-    for (i = 0; i < nfiles; i++) {
-        fpr = fopen(names[i], "r");
-        if (fpr == NULL) {
-            printf("Error: file not found: %s\n", names[i]);
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static uint32_t scan(const char *path, const char *name, uint32_t parent)
+{
+    struct node *nd;
+    DIR *dir;
+    struct dirent *de;
+    struct stat st;
+    char **names = NULL;
+    size_t n = 0, i;
+    char *sub;
+    uint32_t ino, child;
+
+    nodes = xrealloc(nodes, (nnodes + 1) * sizeof(*nodes));
+    nd = &nodes[nnodes++];
+    ino = nnodes;
+    memset(nd, 0, sizeof(*nd));
+    nd->path = strdup(path);
+    nd->name = strdup(name);
+    nd->parent = (parent != 0) ? parent : ino;
+    if (lstat(path, &nd->st) < 0) {
+        perror(path);
+        exit(1);
+    }
+    if (!S_ISDIR(nd->st.st_mode))
+        return ino;
+
+    dir = opendir(path);
+    if (dir == NULL) {
+        perror(path);
+        exit(1);
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        if (strlen(de->d_name) > 255)
             continue;
+        names = xrealloc(names, (n + 1) * sizeof(*names));
+        names[n++] = strdup(de->d_name);
+    }
+    closedir(dir);
+    /* Sorted for reproducible images */
+    qsort(names, n, sizeof(*names), name_cmp);
+
+    for (i = 0; i < n; i++) {
+        sub = xmalloc(strlen(path) + strlen(names[i]) + 2);
+        sprintf(sub, "%s/%s", path, names[i]);
+        if (lstat(sub, &st) == 0 &&
+            (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode) ||
+             S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode))) {
+            child = scan(sub, names[i], ino);
+            nd = &nodes[ino - 1];   /* the array may have been moved */
+            nd->children = xrealloc(nd->children,
+                                    (nd->nchildren + 1) * sizeof(uint32_t));
+            nd->children[nd->nchildren++] = child;
+        } else {
+            printf("Skipping %s (unsupported file type)\n", sub);
         }
-        fseek(fpr, 0, SEEK_END);
-        headers[j].length = ftell(fpr);
-        strncpy(headers[j].name, basenam(names[i]), sizeof(headers[j].name));
-        headers[j].offset = off;
-        fclose(fpr);
-        off += headers[j].length;
-        j++;
+        free(sub);
+        free(names[i]);
     }
-    nfiles = j;
-
-    fpw = fopen("initrd", "w");
-    fwrite(&nfiles, sizeof(uint32_t), 1, fpw);
-    fwrite(headers, sizeof(struct initrd_file_header), nfiles, fpw);
-
-    for (i = 0; i < nfiles; i++) {
-        buf = malloc(headers[i].length);
-        printf("%-2d %-10s offset = %8d, size = %8d\n", i, headers[i].name,
-                headers[i].offset, headers[i].length);
-        fpr = fopen(names[i], "r");
-        fread(buf, 1, headers[i].length, fpr);
-        fwrite(buf, 1, headers[i].length, fpw);
-        fclose(fpr);
-        free(buf);
+    free(names);
+    return ino;
+}
+
+
+/******************************************************************************
+ *  Image layout
+ ******************************************************************************/
+
+static void put_dirent(uint32_t ino, const char *name)
+{
+    uint8_t hdr[CRFS_DIRENT_HDR_SIZE];
+    size_t len = strlen(name);
+
+    hdr[0] = ino & 0xff;
+    hdr[1] = (ino >> 8) & 0xff;
+    hdr[2] = (ino >> 16) & 0xff;
+    hdr[3] = ino >> 24;
+    hdr[4] = len;
+    img_put(hdr, sizeof(hdr));
+    img_put(name, len);
+}
+
+/*
+ * Store the directory entries, returns the data size.
+ */
+static size_t put_dir(const struct node *nd)
+{
+    size_t start = img_len;
+    uint32_t i;
+
+    put_dirent(nd - nodes + 1, ".");
+    put_dirent(nd->parent, "..");
+    for (i = 0; i < nd->nchildren; i++)
+        put_dirent(nd->children[i], nodes[nd->children[i] - 1].name);
+    return img_len - start;
+}
+
+/*
+ * Store the file blocks table and data, returns the file size.
+ */
+static size_t put_file(const struct node *nd)
+{
+    static uint8_t raw[CRFS_BLOCK_SIZE];
+    static uint8_t zip[2 * CRFS_BLOCK_SIZE];
+    uint32_t *tab;
+    size_t nblocks, tab_off, size, i, n, zn;
+    FILE *fp;
+
+    size = nd->st.st_size;
+    nblocks = (size + CRFS_BLOCK_SIZE - 1) / CRFS_BLOCK_SIZE;
+    tab = xmalloc((nblocks + 1) * sizeof(uint32_t));
+    tab_off = img_put(tab, (nblocks + 1) * sizeof(uint32_t));
+
+    fp = fopen(nd->path, "rb");
+    if (fp == NULL) {
+        perror(nd->path);
+        exit(1);
+    }
+    for (i = 0; i < nblocks; i++) {
+        n = size - i * CRFS_BLOCK_SIZE;
+        if (n > CRFS_BLOCK_SIZE)
+            n = CRFS_BLOCK_SIZE;
+        if (fread(raw, 1, n, fp) != n) {
+            fprintf(stderr, "Error: reading %s\n", nd->path);
+            exit(1);
+        }
+        zn = lz4_compress(raw, n, zip);
+        if (zn < n) {
+            tab[i] = img_put(zip, zn);
+            zip_blocks++;
+        } else {
+            tab[i] = img_put(raw, n);
+            raw_blocks++;
+        }
+    }
+    tab[nblocks] = img_len;
+    fclose(fp);
+
+    memcpy(img + tab_off, tab, (nblocks + 1) * sizeof(uint32_t));
+    free(tab);
+    raw_bytes += size;
+    zip_bytes += img_len - tab_off;
+    return size;
+}
+
+int main(int argc, char *argv[])
+{
+    struct crfs_disk_super sb;
+    struct crfs_disk_inode *itable;
+    const struct node *nd;
+    const char *out = "initrd";
+    static const uint8_t pad[CRFS_BLOCK_SIZE];
+    FILE *fp;
+    uint32_t i;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <root directory> [image]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 3)
+        out = argv[2];
+
+    scan(argv[1], "/", 0);
+    if (nnodes > 0xffff) {
+        fprintf(stderr, "Error: too many files (%u)\n", nnodes);
+        return 1;
     }
 
-    printf("initrd total size %d\n", ftell(fpw));
+    /* Super block and inode table, filled at the end */
+    memset(&sb, 0, sizeof(sb));
+    img_put(&sb, sizeof(sb));
+    itable = xmalloc(nnodes * sizeof(*itable));
+    memset(itable, 0, nnodes * sizeof(*itable));
+    sb.itable = img_put(itable, nnodes * sizeof(*itable));
 
-    fclose(fpw);
-    free(headers);
+    for (i = 0; i < nnodes; i++) {
+        nd = &nodes[i];
+        itable[i].mode = nd->st.st_mode;
+        itable[i].uid = nd->st.st_uid;
+        itable[i].gid = nd->st.st_gid;
+        itable[i].mtime = nd->st.st_mtime;
+        if (S_ISDIR(nd->st.st_mode)) {
+            itable[i].offset = img_len;
+            itable[i].size = put_dir(nd);
+        } else if (S_ISREG(nd->st.st_mode)) {
+            itable[i].offset = img_len;
+            itable[i].size = put_file(nd);
+        } else {
+            /* BeeOS device numbers are (major << 8) | minor */
+            itable[i].offset = (major(nd->st.st_rdev) << 8) |
+                               minor(nd->st.st_rdev);
+        }
+    }
+
+    /* The image is read by the kernel in whole blocks */
+    img_put(pad, ALIGN_UP(img_len, CRFS_BLOCK_SIZE) - img_len);
+
+    sb.magic = CRFS_MAGIC;
+    sb.size = img_len;
+    sb.block_size = CRFS_BLOCK_SIZE;
+    sb.ninodes = nnodes;
+    sb.raw_size = raw_bytes;
+    memcpy(img, &sb, sizeof(sb));
+    memcpy(img + sb.itable, itable, nnodes * sizeof(*itable));
+    free(itable);
+
+    fp = fopen(out, "wb");
+    if (fp == NULL || fwrite(img, 1, img_len, fp) != img_len) {
+        perror(out);
+        return 1;
+    }
+    fclose(fp);
 
+    printf("%u inodes, %u compressed blocks, %u stored blocks\n",
+           nnodes, zip_blocks, raw_blocks);
+    printf("files data %lu -> %lu bytes, image %lu bytes\n",
+           (unsigned long)raw_bytes, (unsigned long)zip_bytes,
+           (unsigned long)img_len);
     return 0;
 }
@@ -20,30 +20,37 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define DENTS_NUM   32
 
 int main(int argc, char *argv[])
 {
-    int i;
-    struct dirent *entry;
-    DIR *dirp;
+    int i, j, n;
+    int fd;
+    struct dirent dents[DENTS_NUM];
     const char *dirname = ".";
 
     if (argc > 1)
         dirname = argv[1];
 
-    if ((dirp = opendir(dirname)) == NULL)
+    if ((fd = open(dirname, O_RDONLY, 0)) < 0)
         return -1;
 
     i = 0;
-    while ((entry = readdir(dirp)) != NULL) {
-        printf("%-10s ", entry->d_name);
-        if (++i == 7) {
-            printf("\n");
-            i = 0;
+    while ((n = getdents(fd, dents, sizeof(dents))) > 0) {
+        n /= sizeof(struct dirent);
+        for (j = 0; j < n; j++) {
+            printf("%-10s ", dents[j].d_name);
+            if (++i == 7) {
+                printf("\n");
+                i = 0;
+            }
         }
     }
     if (i != 0)
         printf("\n");
-    closedir(dirp);
-    return 0;
+    close(fd);
+    return (n < 0) ? -1 : 0;
 }
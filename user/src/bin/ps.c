@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Report a snapshot of the current processes, read from the /proc
+ * per process 'stat' files.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <time.h>
+
+#define STAT_FIELDS 11
+
+static int stat_read(const char *pid, char *line, size_t size,
+                     char *field[STAT_FIELDS])
+{
+    char path[32];
+    FILE *fp;
+    int i;
+
+    snprintf(path, sizeof(path), "/proc/%s/stat", pid);
+    if ((fp = fopen(path, "r")) == NULL)
+        return -1;  /* Process gone */
+    if (fgets(line, size, fp) == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    field[0] = strtok(line, " \n");
+    for (i = 1; i < STAT_FIELDS && field[i - 1] != NULL; i++)
+        field[i] = strtok(NULL, (i < STAT_FIELDS - 1) ? " \n" : "\n");
+    return (i == STAT_FIELDS && field[i - 1] != NULL) ? 0 : -1;
+}
+
+int main(void)
+{
+    DIR *dir;
+    struct dirent *ent;
+    char line[128];
+    char *f[STAT_FIELDS];
+    unsigned int ticks;
+
+    if ((dir = opendir("/proc")) == NULL) {
+        perror("ps");
+        return 1;
+    }
+    printf("  PID  PPID S   RSS  FAULTS FDS     TIME CMD\n");
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] < '0' || ent->d_name[0] > '9')
+            continue;
+        if (stat_read(ent->d_name, line, sizeof(line), f) < 0)
+            continue;
+        ticks = atoi(f[5]);
+        printf("%5s %5s %s %5u %7s %3s %5u.%02u %s\n",
+               f[0], f[2], f[1], atoi(f[7]) * 4, f[8], f[9],
+               ticks / CLOCKS_PER_SEC,
+               (ticks % CLOCKS_PER_SEC) * 100 / CLOCKS_PER_SEC, f[10]);
+    }
+    closedir(dir);
+    return 0;
+}
@@ -4,4 +4,7 @@ local_sources := ls.c \
 				 echo.c \
 				 pwd.c \
 				 kill.c \
-				 env.c
+				 env.c \
+				 ps.c \
+				 top.c \
+				 time.c
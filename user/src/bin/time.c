@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Run a command and report its elapsed, user and system times.
+ * Usage: time command [args...]
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/times.h>
+#include <sys/resource.h>
+
+static void tv_print(const char *label, const struct timeval *tv)
+{
+    fprintf(stderr, "%s %u.%03us\n", label, (unsigned int)tv->tv_sec,
+            (unsigned int)tv->tv_usec / 1000);
+}
+
+int main(int argc, char *argv[])
+{
+    struct rusage ru;
+    struct timeval real;
+    clock_t start;
+    pid_t pid;
+    int status;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: time command [args...]\n");
+        return 1;
+    }
+
+    start = times(NULL);
+    pid = fork();
+    if (pid < 0) {
+        perror("time");
+        return 1;
+    }
+    if (pid == 0) {
+        execvpe(argv[1], &argv[1], environ);
+        perror(argv[1]);
+        return 127;
+    }
+    waitpid(pid, &status, 0);
+
+    start = times(NULL) - start;
+    real.tv_sec = start / CLOCKS_PER_SEC;
+    real.tv_usec = (start % CLOCKS_PER_SEC) * (1000000 / CLOCKS_PER_SEC);
+    tv_print("real", &real);
+    if (getrusage(RUSAGE_CHILDREN, &ru) == 0) {
+        tv_print("user", &ru.ru_utime);
+        tv_print("sys ", &ru.ru_stime);
+    }
+    return 0;
+}
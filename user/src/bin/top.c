@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Periodically display the system load, memory usage and the CPU usage
+ * of each process over the last interval.
+ * Usage: top [interval_seconds [iterations]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+
+#define MAX_PROCS   64
+
+struct proc_sample {
+    int             pid;
+    unsigned int    usage;
+    unsigned int    rss;
+    char            state[2];
+    char            comm[16];
+};
+
+static struct proc_sample prev[MAX_PROCS];
+static struct proc_sample curr[MAX_PROCS];
+static int nprev;
+
+static void file_print(const char *path, const char *prefix)
+{
+    char line[80];
+    FILE *fp;
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return;
+    while (fgets(line, sizeof(line), fp) != NULL)
+        printf("%s%s", prefix, line);
+    fclose(fp);
+}
+
+static int sample_read(const char *pid, struct proc_sample *s)
+{
+    char path[32], line[128];
+    char *tok;
+    FILE *fp;
+    int i;
+
+    snprintf(path, sizeof(path), "/proc/%s/stat", pid);
+    if ((fp = fopen(path, "r")) == NULL)
+        return -1;
+    tok = fgets(line, sizeof(line), fp);
+    fclose(fp);
+    if (tok == NULL)
+        return -1;
+
+    /* pid state ppid pgid uid usage brk rss faults fds comm */
+    tok = strtok(line, " \n");
+    for (i = 0; tok != NULL && i < 11; i++) {
+        switch (i) {
+        case 0:
+            s->pid = atoi(tok);
+            break;
+        case 1:
+            s->state[0] = tok[0];
+            s->state[1] = '\0';
+            break;
+        case 5:
+            s->usage = atoi(tok);
+            break;
+        case 7:
+            s->rss = atoi(tok) * 4;
+            break;
+        case 10:
+            strncpy(s->comm, tok, sizeof(s->comm) - 1);
+            s->comm[sizeof(s->comm) - 1] = '\0';
+            break;
+        }
+        tok = strtok(NULL, (i < 9) ? " \n" : "\n");
+    }
+    return (i == 11) ? 0 : -1;
+}
+
+static int samples_read(void)
+{
+    DIR *dir;
+    struct dirent *ent;
+    int n = 0;
+
+    if ((dir = opendir("/proc")) == NULL)
+        return -1;
+    while (n < MAX_PROCS && (ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] < '0' || ent->d_name[0] > '9')
+            continue;
+        if (sample_read(ent->d_name, &curr[n]) == 0)
+            n++;
+    }
+    closedir(dir);
+    return n;
+}
+
+static unsigned int usage_prev(int pid)
+{
+    int i;
+
+    for (i = 0; i < nprev; i++) {
+        if (prev[i].pid == pid)
+            return prev[i].usage;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int interval = 2, delta;
+    int iterations = -1;
+    int i, n;
+
+    if (argc > 1)
+        interval = atoi(argv[1]);
+    if (argc > 2)
+        iterations = atoi(argv[2]);
+    if (interval == 0)
+        interval = 1;
+
+    while (iterations != 0) {
+        if ((n = samples_read()) < 0) {
+            perror("top");
+            return 1;
+        }
+        printf("\033[H\033[J");
+        file_print("/proc/uptime", "uptime:  ");
+        file_print("/proc/loadavg", "load:    ");
+        file_print("/proc/meminfo", "");
+        printf("\n  PID S   RSS  %%CPU CMD\n");
+        for (i = 0; i < n; i++) {
+            delta = curr[i].usage - usage_prev(curr[i].pid);
+            printf("%5d %s %5u %5u %s\n", curr[i].pid, curr[i].state,
+                   curr[i].rss,
+                   delta * 100 / (interval * CLOCKS_PER_SEC), curr[i].comm);
+        }
+        memcpy(prev, curr, n * sizeof(*curr));
+        nprev = n;
+        if (iterations > 0)
+            iterations--;
+        if (iterations != 0)
+            sleep(interval);
+    }
+    return 0;
+}
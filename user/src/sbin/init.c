@@ -55,6 +55,9 @@ static const struct dev_desc devs[] = {
     { "/dev/random",  S_IFCHR, makedev(0x01, 0x08) },
     { "/dev/urandom", S_IFCHR, makedev(0x01, 0x09) },
     { "/dev/initrd",  S_IFBLK, makedev(0x01, 0xFA) },
+    { "/dev/hda",     S_IFBLK, makedev(0x03, 0x00) },
+    { "/dev/hdb",     S_IFBLK, makedev(0x03, 0x40) },
+    { "/dev/vda",     S_IFBLK, makedev(0xFD, 0x00) },
 };
 #define NDEVS (sizeof(devs)/sizeof(*devs))
 
@@ -72,6 +75,27 @@ void dev_init(void)
     }
 }
 
+/* Scratch memory file system, if the mount point is there */
+void tmp_init(void)
+{
+    struct stat st;
+
+    if (stat("/tmp", &st) < 0)
+        return;
+    if (mount("tmpfs", "/tmp", "tmpfs", 0, NULL) < 0)
+        perror("mount of tmpfs failure");
+}
+
+void proc_init(void)
+{
+    struct stat st;
+
+    if (stat("/proc", &st) < 0)
+        return;
+    if (mount("proc", "/proc", "proc", 0, NULL) < 0)
+        perror("mount of proc failure");
+}
+
 
 /* Before fork */
 void env_init(void)
@@ -154,6 +178,8 @@ int main(int argc, char *argv[])
 
     env_init();
     dev_init();
+    tmp_init();
+    proc_init();
 
     for (i = 0; i < NTTY; i++) {
         if ((sh_pid[i] = spawn_shell(i + 1)) < 0)
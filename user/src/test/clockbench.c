@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Clock read cost.
+ * Compares the clocks read from the time page against the same reads
+ * done with a syscall, also checks that the monotonic clock never goes
+ * back.
+ * Usage: clockbench [iterations]
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ITERATIONS_DEFAULT  100000
+
+static long long nsecs(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return nsecs(&ts);
+}
+
+static void report(const char *label, long long ns, int n)
+{
+    printf("%-24s %6u ns/call\n", label, (unsigned int)(ns / n));
+}
+
+int main(int argc, char *argv[])
+{
+    struct timespec ts;
+    long long start, prev, curr;
+    int i, n = ITERATIONS_DEFAULT, back = 0;
+
+    if (argc > 1)
+        n = atoi(argv[1]);
+    if (n <= 0)
+        return 1;
+
+    start = now_ns();
+    prev = start;
+    for (i = 0; i < n; i++) {
+        curr = now_ns();
+        if (curr < prev)
+            back++;
+        prev = curr;
+    }
+    report("clock_gettime", now_ns() - start, n);
+
+    start = now_ns();
+    for (i = 0; i < n; i++)
+        syscall(__NR_clock_gettime, CLOCK_MONOTONIC, &ts);
+    report("clock_gettime (syscall)", now_ns() - start, n);
+
+    start = now_ns();
+    for (i = 0; i < n; i++)
+        clock();
+    report("clock", now_ns() - start, n);
+
+    start = now_ns();
+    for (i = 0; i < n; i++)
+        syscall(__NR_clock);
+    report("clock (syscall)", now_ns() - start, n);
+
+    printf("CPU time %u ticks (syscall %u), monotonic went back %d times\n",
+           (unsigned int)clock(), (unsigned int)syscall(__NR_clock), back);
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Block device read throughput test.
+ * Reads a disk sequentially with large requests, then reads random
+ * 4 KiB blocks. The device defaults to the first IDE disk.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+
+#define DEV_PATH        "/dev/hda"
+#define SEQ_CHUNK       65536
+#define SEQ_MAX_KB      16384
+#define RND_CHUNK       4096
+#define RND_READS       1024
+
+static char buf[SEQ_CHUNK];
+
+static void report(const char *name, unsigned long bytes, unsigned int ops,
+                   clock_t ticks)
+{
+    printf("%s: %u KiB, %u reads in %u ticks", name,
+           (unsigned int)(bytes / 1024), ops, (unsigned int)ticks);
+    if (ticks != 0)
+        printf(" (%u KiB/s, %u IOPS)",
+               (unsigned int)((bytes / 1024) * CLOCKS_PER_SEC / ticks),
+               (unsigned int)(ops * CLOCKS_PER_SEC / ticks));
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = (argc > 1) ? argv[1] : DEV_PATH;
+    int fd;
+    ssize_t n;
+    unsigned long total = 0;
+    unsigned long blocks;
+    unsigned long seed = 12345;
+    unsigned int i, ops = 0;
+    clock_t ticks;
+
+    fd = open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Error opening %s\n", path);
+        return 1;
+    }
+
+    ticks = clock();
+    while (total < SEQ_MAX_KB * 1024UL &&
+           (n = read(fd, buf, SEQ_CHUNK)) > 0) {
+        total += n;
+        ops++;
+    }
+    ticks = clock() - ticks;
+    report("sequential", total, ops, ticks);
+
+    /* Random reads within the range read so far */
+    blocks = total / RND_CHUNK;
+    if (blocks == 0) {
+        close(fd);
+        return 1;
+    }
+    total = 0;
+    ticks = clock();
+    for (i = 0; i < RND_READS; i++) {
+        seed = seed * 1103515245 + 12345;
+        lseek(fd, (off_t)(((seed >> 16) % blocks) * RND_CHUNK), SEEK_SET);
+        n = read(fd, buf, RND_CHUNK);
+        if (n <= 0)
+            break;
+        total += n;
+    }
+    ticks = clock() - ticks;
+    report("random", total, i, ticks);
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Sleep precision test.
+ * Sleeps repeatedly for periods below and above the clock tick and
+ * measures the oversleep with the monotonic clock.
+ * Usage: hrsleep [samples]
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SAMPLES_DEFAULT     20
+
+static const unsigned int periods_us[] = {
+    20, 50, 100, 500, 1000, 5000, 15000, 50000
+};
+
+static long long elapsed_ns(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1000000000LL + (b->tv_nsec - a->tv_nsec);
+}
+
+static void measure(unsigned int us, int samples)
+{
+    struct timespec start, end;
+    long long late, max = 0, total = 0;
+    int i;
+
+    for (i = 0; i < samples; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        usleep(us);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        late = elapsed_ns(&start, &end) - us * 1000LL;
+        if (late < 0) {
+            printf("%u us: woken %u ns early\n", us, (unsigned int)-late);
+            late = 0;
+        }
+        total += late;
+        if (late > max)
+            max = late;
+    }
+    printf("%6u us: avg late %6u us, max %6u us\n", us,
+           (unsigned int)(total / samples / 1000),
+           (unsigned int)(max / 1000));
+}
+
+int main(int argc, char *argv[])
+{
+    struct timespec ts;
+    unsigned int i;
+    int samples = SAMPLES_DEFAULT;
+
+    if (argc > 1)
+        samples = atoi(argv[1]);
+    if (samples <= 0)
+        return 1;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    printf("Realtime: %u s since the Epoch\n", (unsigned int)ts.tv_sec);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    printf("Uptime:   %u.%09u s\n", (unsigned int)ts.tv_sec,
+           (unsigned int)ts.tv_nsec);
+
+    for (i = 0; i < sizeof(periods_us) / sizeof(*periods_us); i++)
+        measure(periods_us[i], samples);
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Interrupt rate measurement.
+ * Samples /proc/interrupts before and after sleeping for a period, with
+ * nothing else running this gives the interrupt rate of an idle system
+ * (about 100 timer interrupts per second without the dynamic tick).
+ * Usage: irqrate [seconds]
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINES_MAX   24
+
+struct irq_line {
+    char            name[8];
+    unsigned long   count;
+};
+
+static int sample(struct irq_line *lines)
+{
+    char buf[64];
+    char *name, *count;
+    FILE *fp;
+    int n = 0;
+
+    if ((fp = fopen("/proc/interrupts", "r")) == NULL)
+        return -1;
+    while (n < LINES_MAX && fgets(buf, sizeof(buf), fp) != NULL) {
+        name = strtok(buf, " \n");
+        count = strtok(NULL, " \n");
+        if (name == NULL || count == NULL)
+            continue;
+        strncpy(lines[n].name, name, sizeof(lines[n].name) - 1);
+        lines[n].name[sizeof(lines[n].name) - 1] = '\0';
+        lines[n].count = (unsigned long)atol(count);
+        n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    struct irq_line before[LINES_MAX], after[LINES_MAX];
+    unsigned int secs = 10;
+    unsigned long delta;
+    int i, j, nb, na;
+
+    if (argc > 1)
+        secs = atoi(argv[1]);
+    if (secs == 0)
+        secs = 1;
+
+    if ((nb = sample(before)) < 0) {
+        perror("/proc/interrupts");
+        return 1;
+    }
+    sleep(secs);
+    na = sample(after);
+
+    printf("Interrupts per second over %u seconds\n", secs);
+    for (i = 0; i < na; i++) {
+        delta = after[i].count;
+        for (j = 0; j < nb; j++) {
+            if (strcmp(before[j].name, after[i].name) == 0) {
+                delta -= before[j].count;
+                break;
+            }
+        }
+        printf("%-6s %lu.%02lu\n", after[i].name, delta / secs,
+               (delta % secs) * 100 / secs);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Ramdisk read throughput test.
+ * Reads the whole initrd device with different request sizes.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+
+#define DEV_PATH    "/dev/initrd"
+#define PASSES      4
+
+static char buf[65536];
+
+static const size_t chunks[] = { 512, 4096, 65536 };
+
+int main(void)
+{
+    int fd, pass;
+    unsigned int i;
+    ssize_t n;
+    unsigned long total;
+    clock_t ticks;
+
+    fd = open(DEV_PATH, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Error opening %s\n", DEV_PATH);
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        total = 0;
+        ticks = clock();
+        for (pass = 0; pass < PASSES; pass++) {
+            lseek(fd, 0, SEEK_SET);
+            while ((n = read(fd, buf, chunks[i])) > 0)
+                total += n;
+        }
+        ticks = clock() - ticks;
+        printf("chunk %u: %u KiB in %u ticks", (unsigned int)chunks[i],
+               (unsigned int)(total / 1024), (unsigned int)ticks);
+        if (ticks != 0)
+            printf(" (%u KiB/s)", (unsigned int)((total / 1024) *
+                   CLOCKS_PER_SEC / ticks));
+        printf("\n");
+    }
+
+    close(fd);
+    return 0;
+}
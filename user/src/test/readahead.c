@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Sequential read benchmark.
+ * Reads a file with small (512 bytes) read calls, first sequentially
+ * (readahead enabled) and then seeking before every read (readahead
+ * disabled). Without a file argument a test file is created first.
+ * The default 1 MiB root image can't hold it, run from a larger disk
+ * (mkfs.sh 4, then qemu.sh -h disk.img) or pass a file on one.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <time.h>
+
+#define CHUNK_SIZE      512
+#define FILE_SIZE_KB    2048
+#define TEST_FILE       "/readahead.dat"
+
+static char buf[4096];
+
+static int create_file(const char *path, unsigned int size_kb)
+{
+    int fd;
+    unsigned int i;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    for (i = 0; i < sizeof(buf); i++)
+        buf[i] = (char)i;
+    for (i = 0; i < size_kb / 4; i++) {
+        if (write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+static clock_t read_file(const char *path, int seek, unsigned long *total)
+{
+    int fd;
+    ssize_t n;
+    off_t off = 0;
+    clock_t start;
+
+    fd = open(path, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+    *total = 0;
+    start = clock();
+    while (1) {
+        /* Seeking to the current position defeats the sequential detection */
+        if (seek != 0)
+            lseek(fd, off, SEEK_SET);
+        n = read(fd, buf, CHUNK_SIZE);
+        if (n <= 0)
+            break;
+        off += n;
+        *total += n;
+    }
+    start = clock() - start;
+    close(fd);
+    return start;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = TEST_FILE;
+    unsigned long total;
+    clock_t ticks;
+
+    if (argc > 1) {
+        path = argv[1];
+    } else if (create_file(path, FILE_SIZE_KB) < 0) {
+        printf("Error creating %s\n", path);
+        return 1;
+    }
+
+    ticks = read_file(path, 0, &total);
+    if (ticks < 0) {
+        printf("Error opening %s\n", path);
+        return 1;
+    }
+    printf("sequential: %u bytes, %u ticks\n", (unsigned int)total,
+           (unsigned int)ticks);
+
+    ticks = read_file(path, 1, &total);
+    printf("seeking:    %u bytes, %u ticks\n", (unsigned int)total,
+           (unsigned int)ticks);
+
+    syscall(__NR_info);
+
+    if (argc <= 1)
+        unlink(path);
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Wakeup latency test.
+ * A process repeatedly sleeps for a short period while some CPU bound
+ * processes keep the system busy, the delay between the expected wakeup
+ * and the actual run is measured. The test runs first with the time
+ * sharing policy and then with SCHED_FIFO (super user only).
+ * Usage: rtlatency [spinners]
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/times.h>
+
+#define SPINNERS_DEFAULT    4
+#define SAMPLES             50
+#define SLEEP_MS            30
+
+static void measure(const char *label)
+{
+    clock_t start, late, max = 0, total = 0;
+    int i;
+
+    for (i = 0; i < SAMPLES; i++) {
+        start = times(NULL);
+        usleep(SLEEP_MS * 1000);
+        late = times(NULL) - start - SLEEP_MS * CLOCKS_PER_SEC / 1000;
+        if (late < 0)
+            late = 0;
+        total += late;
+        if (late > max)
+            max = late;
+    }
+    printf("%-6s: avg %u ms, max %u ms\n", label,
+           (unsigned int)(total * 1000 / CLOCKS_PER_SEC / SAMPLES),
+           (unsigned int)(max * 1000 / CLOCKS_PER_SEC));
+}
+
+int main(int argc, char *argv[])
+{
+    struct sched_param param;
+    pid_t *spinners;
+    int i, n = SPINNERS_DEFAULT, status;
+
+    if (argc > 1)
+        n = atoi(argv[1]);
+    spinners = malloc(n * sizeof(*spinners));
+    if (spinners == NULL)
+        return 1;
+    for (i = 0; i < n; i++) {
+        spinners[i] = fork();
+        if (spinners[i] < 0)
+            break;
+        if (spinners[i] == 0) {
+            while (1)
+                ;
+        }
+    }
+    n = i;
+    printf("%d CPU bound processes started\n", n);
+
+    measure("OTHER");
+
+    param.sched_priority = 50;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) < 0) {
+        perror("sched_setscheduler");
+    } else {
+        measure("FIFO");
+        param.sched_priority = 0;
+        sched_setscheduler(0, SCHED_OTHER, &param);
+    }
+
+    for (i = 0; i < n; i++)
+        kill(spinners[i], SIGTERM);
+    for (i = 0; i < n; i++)
+        waitpid(spinners[i], &status, 0);
+    free(spinners);
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Scheduler benchmark.
+ * Measures the context switch cost with a pipe ping-pong between two
+ * processes, first alone and then with many sleeping processes around
+ * (default 500). Then two CPU bound processes with different nice
+ * values compete for a few seconds, reporting their share of work.
+ * Usage: schedbench [sleepers]
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/times.h>
+#include <sys/resource.h>
+
+#define SLEEPERS_DEFAULT    500
+#define ROUNDS              5000
+#define SPIN_SECONDS        3
+
+static pid_t *sleepers;
+
+static int sleepers_start(int n)
+{
+    int i;
+
+    sleepers = malloc(n * sizeof(*sleepers));
+    if (sleepers == NULL)
+        return 0;
+    for (i = 0; i < n; i++) {
+        sleepers[i] = fork();
+        if (sleepers[i] < 0)
+            break;
+        if (sleepers[i] == 0) {
+            while (1)
+                pause();
+        }
+    }
+    return i;
+}
+
+static void sleepers_stop(int n)
+{
+    int i, status;
+
+    for (i = 0; i < n; i++)
+        kill(sleepers[i], SIGTERM);
+    for (i = 0; i < n; i++)
+        waitpid(sleepers[i], &status, 0);
+    free(sleepers);
+}
+
+/*
+ * Returns the ticks spent for ROUNDS round trips (two switches each).
+ */
+static clock_t pingpong(void)
+{
+    int p2c[2], c2p[2];
+    int i, status;
+    char c = 0;
+    clock_t start;
+    pid_t pid;
+
+    if (pipe(p2c) < 0 || pipe(c2p) < 0)
+        return -1;
+    pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        while (read(p2c[0], &c, 1) == 1 && c != 0)
+            write(c2p[1], &c, 1);
+        exit(0);
+    }
+
+    start = times(NULL);
+    for (i = 0; i < ROUNDS; i++) {
+        c = 1;
+        write(p2c[1], &c, 1);
+        read(c2p[0], &c, 1);
+    }
+    start = times(NULL) - start;
+
+    c = 0;
+    write(p2c[1], &c, 1);
+    waitpid(pid, &status, 0);
+    close(p2c[0]);
+    close(p2c[1]);
+    close(c2p[0]);
+    close(c2p[1]);
+    return start;
+}
+
+static void pingpong_report(const char *label)
+{
+    clock_t ticks;
+    unsigned int usecs;
+
+    ticks = pingpong();
+    if (ticks < 0) {
+        printf("%s: ping-pong failure\n", label);
+        return;
+    }
+    usecs = (unsigned int)(ticks * (1000000 / CLOCKS_PER_SEC) /
+                           (2 * ROUNDS));
+    printf("%s: %d round trips, %u ticks, ~%u us per switch\n", label,
+           ROUNDS, (unsigned int)ticks, usecs);
+}
+
+struct spin_result {
+    int             nice;
+    unsigned long   count;
+};
+
+static pid_t spinner(int nice_val, int fd)
+{
+    struct spin_result res;
+    clock_t end;
+    pid_t pid;
+
+    pid = fork();
+    if (pid == 0) {
+        setpriority(PRIO_PROCESS, 0, nice_val);
+        res.nice = nice_val;
+        res.count = 0;
+        end = times(NULL) + SPIN_SECONDS * CLOCKS_PER_SEC;
+        while (times(NULL) < end)
+            res.count++;
+        write(fd, &res, sizeof(res));
+        exit(0);
+    }
+    return pid;
+}
+
+static void nice_report(void)
+{
+    struct spin_result res;
+    int fds[2], i, status;
+
+    if (pipe(fds) < 0)
+        return;
+    spinner(0, fds[1]);
+    spinner(10, fds[1]);
+    for (i = 0; i < 2; i++) {
+        wait(&status);
+        if (read(fds[0], &res, sizeof(res)) == sizeof(res))
+            printf("nice %2d: %lu loops in %d seconds\n", res.nice,
+                   res.count, SPIN_SECONDS);
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(int argc, char *argv[])
+{
+    int n = SLEEPERS_DEFAULT, started;
+
+    if (argc > 1)
+        n = atoi(argv[1]);
+
+    pingpong_report("idle system");
+
+    started = sleepers_start(n);
+    printf("%d sleeping processes started\n", started);
+    pingpong_report("with sleepers");
+    sleepers_stop(started);
+
+    nice_report();
+    return 0;
+}
@@ -14,6 +14,16 @@ local_sources := dump.c \
 				 serial.c \
 				 initadopt.c \
 				 pgrp.c \
-				 atexit.c
+				 atexit.c \
+				 readahead.c \
+				 ramdisk.c \
+				 disk.c \
+				 tmpfs.c \
+				 schedbench.c \
+				 rtlatency.c \
+				 timerstress.c \
+				 irqrate.c \
+				 hrsleep.c \
+				 clockbench.c
 
 dirs := cp03 cp08
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * Timer events stress test.
+ * Starts thousands of processes sleeping concurrently for different
+ * periods (from a few milliseconds to several seconds), each one exits
+ * with its wakeup lateness in clock ticks. Early wakeups are errors.
+ * Usage: timerstress [processes]
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/times.h>
+
+#define PROCS_DEFAULT   2000
+#define SLEEP_MAX_MS    8000
+
+/* Deterministic spread of the sleep periods */
+static unsigned int sleep_ms(int i)
+{
+    return (unsigned int)(i * 7919) % SLEEP_MAX_MS + 10;
+}
+
+static int sleeper(int i)
+{
+    clock_t start, elapsed, expected;
+
+    expected = sleep_ms(i) * CLOCKS_PER_SEC / 1000;
+    start = times(NULL);
+    usleep(sleep_ms(i) * 1000);
+    elapsed = times(NULL) - start;
+    if (elapsed + 1 < expected)
+        return 255;     /* Early */
+    elapsed -= expected;
+    return (elapsed < 254) ? (int)elapsed : 254;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = PROCS_DEFAULT, i, started, status;
+    int early = 0, max = 0;
+    unsigned long total = 0;
+    clock_t start;
+    pid_t pid;
+
+    if (argc > 1)
+        n = atoi(argv[1]);
+
+    start = times(NULL);
+    for (i = 0; i < n; i++) {
+        pid = fork();
+        if (pid < 0)
+            break;
+        if (pid == 0)
+            exit(sleeper(i));
+    }
+    started = i;
+    printf("%d sleeping processes started in %u ticks\n", started,
+           (unsigned int)(times(NULL) - start));
+
+    for (i = 0; i < started; i++) {
+        if (wait(&status) < 0)
+            break;
+        if (status == 255) {
+            early++;
+        } else {
+            total += status;
+            if (status > max)
+                max = status;
+        }
+    }
+    printf("lateness: avg %lu ticks, max %d ticks, %d early wakeups\n",
+           (started > early) ? total / (started - early) : 0, max, early);
+    printf("total time: %u ticks\n", (unsigned int)(times(NULL) - start));
+    return (early == 0) ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2015-2018, Davide Galassi. All rights reserved.
+ *
+ * This file is part of the BeeOS software.
+ *
+ * BeeOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with BeeOS; if not, see <http://www.gnu/licenses/>.
+ */
+
+/*
+ * tmpfs test.
+ * Mounts a tmpfs instance with a small size limit on a directory
+ * (default /tmp) and checks files creation, write, truncate, unlink,
+ * directories and the size limit. Then measures the write and read
+ * throughput.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+
+#define MNT_DIR         "/tmp"
+#define SIZE_LIMIT_KB   256
+#define BENCH_ROUNDS    64
+
+static char buf[4096];
+static char path[128];
+static char path2[128];
+
+static int fail(const char *what)
+{
+    printf("FAIL: %s (%s)\n", what, strerror(errno));
+    return 1;
+}
+
+static long file_write(const char *name, unsigned int size_kb)
+{
+    int fd;
+    unsigned int i;
+    long total = 0;
+    ssize_t n;
+
+    fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    for (i = 0; i < size_kb / 4; i++) {
+        n = write(fd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        total += n;
+    }
+    close(fd);
+    return total;
+}
+
+static long file_read(const char *name)
+{
+    int fd;
+    long total = 0;
+    ssize_t n;
+
+    fd = open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        total += n;
+    close(fd);
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = (argc > 1) ? argv[1] : MNT_DIR;
+    struct stat st;
+    clock_t ticks;
+    long n;
+    int fd, i;
+
+    if (mount("tmpfs", dir, "tmpfs", 0, "size=256k") < 0)
+        return fail("mount");
+    memset(buf, 'x', sizeof(buf));
+
+    /* Create, write, truncate */
+    snprintf(path, sizeof(path), "%s/file", dir);
+    if (file_write(path, 16) != 16 * 1024)
+        return fail("write");
+    fd = open(path, O_RDWR, 0);
+    if (fd < 0 || ftruncate(fd, 1000) < 0)
+        return fail("truncate");
+    close(fd);
+    if (stat(path, &st) < 0 || st.st_size != 1000 || file_read(path) != 1000)
+        return fail("truncated size");
+
+    /* Directories */
+    snprintf(path2, sizeof(path2), "%s/dir", dir);
+    if (mknod(path2, S_IFDIR | 0755, 0) < 0)
+        return fail("mkdir");
+    snprintf(path2, sizeof(path2), "%s/dir/file", dir);
+    if (file_write(path2, 4) != 4096)
+        return fail("write in directory");
+    snprintf(path2, sizeof(path2), "%s/dir", dir);
+    if (unlink(path2) == 0 || errno != ENOTEMPTY)
+        return fail("non empty directory removed");
+    snprintf(path2, sizeof(path2), "%s/dir/file", dir);
+    if (unlink(path2) < 0)
+        return fail("unlink in directory");
+    snprintf(path2, sizeof(path2), "%s/dir", dir);
+    if (unlink(path2) < 0)
+        return fail("empty directory unlink");
+
+    /* Size limit */
+    snprintf(path2, sizeof(path2), "%s/big", dir);
+    n = file_write(path2, 2 * SIZE_LIMIT_KB);
+    if (n < 0 || n > SIZE_LIMIT_KB * 1024)
+        return fail("size limit");
+    printf("size limit: %ld KiB written of %d KiB requested\n",
+           n / 1024, 2 * SIZE_LIMIT_KB);
+    if (unlink(path2) < 0 || unlink(path) < 0)
+        return fail("unlink");
+    if (stat(path, &st) == 0)
+        return fail("unlinked file still there");
+
+    /* Throughput, the space is released by every truncation */
+    ticks = clock();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        file_write(path, 128);
+    ticks = clock() - ticks;
+    printf("write: %d KiB, %u ticks\n", BENCH_ROUNDS * 128,
+           (unsigned int)ticks);
+    ticks = clock();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        file_read(path);
+    ticks = clock() - ticks;
+    printf("read:  %d KiB, %u ticks\n", BENCH_ROUNDS * 128,
+           (unsigned int)ticks);
+    unlink(path);
+
+    printf("PASS\n");
+    return 0;
+}